@@ -0,0 +1,142 @@
+/**
+ * @file allocbench.cc
+ *
+ * Time-stamp: <2026-10-18 05:08:44 +0800 by kerwin>
+ *
+ * Benchmark of rendering: heap allocations and time per rendered year,
+ * counted by replacing the global operator new.
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "../include/debug.h"
+#include "../include/calendar.h"
+#include "../include/texsink.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#ifdef DEBUG
+std::ofstream MY_ERR;
+#endif
+
+namespace {
+	const int FIRST_YEAR=1901;
+	///< first year rendered
+	const int LAST_YEAR=2099;
+	///< last year rendered
+	const int ROUNDS=5;
+	///< times the range is rendered after the warm up round
+
+	std::atomic<unsigned long> allocations(0);
+	///< calls to operator new so far
+
+	/**
+	 * @brief sink throwing everything away
+	 */
+	class NullSink : public TexSink {
+	  public:
+		void write(char const*, std::size_t) {}
+		using TexSink::write;
+	};
+
+	/**
+	 * @brief render every year of the range once
+	 *
+	 * Only rendering is counted: each Calendar is built before the count
+	 * is read.
+	 *
+	 * @param[out] render time spent rendering, milliseconds
+	 *
+	 * @return allocations made while rendering
+	 */
+	unsigned long
+	renderRange(double& render)
+	{
+		NullSink sink;
+		unsigned long count=0;
+		render=0;
+		for (int year=FIRST_YEAR; year<=LAST_YEAR; year++) {
+			Calendar c(year);
+			unsigned long const before=allocations;
+			std::chrono::steady_clock::time_point start=
+				std::chrono::steady_clock::now();
+			c.writeFullYearTex(sink);
+			render+=std::chrono::duration<double,std::milli>(
+				std::chrono::steady_clock::now()-start).count();
+			count+=allocations-before;
+		}
+		return count;
+	}
+}
+
+/**
+ * @brief counting replacement of the global operator new
+ *
+ * @param size bytes wanted
+ *
+ * @return the memory
+ */
+void*
+operator new(std::size_t size)
+{
+	allocations++;
+	void* p=std::malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+/**
+ * @brief release memory from the counting operator new
+ *
+ * @param p the memory
+ */
+void
+operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+/**
+ * @brief release memory from the counting operator new
+ *
+ * @param p the memory
+ */
+void
+operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+/**
+ * @brief render 1901--2099 repeatedly into a null sink
+ *
+ * The first round warms up the per-thread buffers and shared tables and
+ * is reported on its own.  Run from the top directory, so the data files
+ * are found.
+ *
+ * @return 0
+ */
+int
+main()
+{
+	int const years=LAST_YEAR-FIRST_YEAR+1;
+	double ms;
+	unsigned long count=renderRange(ms);
+	std::cout << std::fixed << std::setprecision(1)
+			  << "first round: " << (double)count/years
+			  << " allocations/year, " << ms*1e3/years << " us/year"
+			  << std::endl;
+	count=0;
+	double total=0;
+	for (int r=0; r<ROUNDS; r++) {
+		count+=renderRange(ms);
+		total+=ms;
+	}
+	std::cout << "next " << ROUNDS << " rounds: "
+			  << (double)count/(years*ROUNDS) << " allocations/year, "
+			  << total*1e3/(years*ROUNDS) << " us/year" << std::endl;
+	return 0;
+}
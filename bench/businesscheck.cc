@@ -0,0 +1,179 @@
+/**
+ * @file businesscheck.cc
+ *
+ * Time-stamp: <2026-10-18 05:40:12 +0800 by kerwin>
+ *
+ * Checks BusinessCalendar against a day by day walk on random queries,
+ * and that queries reaching outside 1901--2099 throw.
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "../include/debug.h"
+#include "../include/businesscalendar.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#ifdef DEBUG
+std::ofstream MY_ERR;
+#endif
+
+namespace {
+	const unsigned int QUERIES=200000;
+	///< random queries of each kind
+	const int MAX_OFFSET=500;
+	///< largest number of business days added
+
+	/**
+	 * @brief business day test by hand, from the weekday and the data
+	 *
+	 * @param data public holidays
+	 * @param mjd the day
+	 *
+	 * @retval true if mjd is Monday to Friday and not a public holiday
+	 * @retval false otherwise
+	 */
+	bool
+	isBusiness(CalendarData const& data, int mjd)
+	{
+		Date const d(mjd);
+		return (d.getDayOfWeek()!=Date::DOW_SATURDAY) &&
+			(d.getDayOfWeek()!=Date::DOW_SUNDAY) && !data.isPublicHoliday(d);
+	}
+
+	/**
+	 * @brief add business days by walking a day at a time
+	 *
+	 * @param data public holidays
+	 * @param mjd start date
+	 * @param n business days to move, may be negative
+	 * @param[out] res MJD of the result
+	 *
+	 * @retval true if the result is within 1901--2099
+	 * @retval false if the walk left the range
+	 */
+	bool
+	walkAdd(CalendarData const& data, int mjd, int n, int& res)
+	{
+		int const step=(n<0) ? -1 : 1;
+		for (; n; n-=step) {
+			do {
+				mjd+=step;
+				if (!DayBitmap::covers(mjd)) return false;
+			} while (!isBusiness(data,mjd));
+		}
+		res=mjd;
+		return true;
+	}
+
+	/**
+	 * @brief check that a query throws
+	 *
+	 * @param name printed if it does not
+	 * @param query the query
+	 *
+	 * @return 0 if it threw INVALID_PARAM, else 1
+	 */
+	template <typename F>
+	unsigned int
+	expectThrow(char const* name, F query)
+	{
+		try {
+			query();
+		}
+		catch (BeautyException&) {
+			return 0;
+		}
+		std::cerr << name << ": no exception" << std::endl;
+		return 1;
+	}
+}
+
+/**
+ * @brief run the random and out of range queries
+ *
+ * Run from the top directory, so the data files are found.
+ *
+ * @return 0 if every query agrees, else 1
+ */
+int
+main()
+{
+	std::shared_ptr<const CalendarData> data=CalendarData::getDefault();
+	Calendar cal(2012);
+	BusinessCalendar const b(cal);
+	std::mt19937 random(2012);
+	std::uniform_int_distribution<int> day(DayBitmap::firstMJD(),
+										   DayBitmap::lastMJD());
+	std::uniform_int_distribution<int> offset(-MAX_OFFSET,MAX_OFFSET);
+	unsigned int bad=0;
+	std::chrono::steady_clock::time_point start=
+		std::chrono::steady_clock::now();
+
+	for (unsigned int q=0; q<QUERIES; q++) {
+		int const mjd=day(random), n=offset(random);
+		int expected=mjd;
+		bool const inside=walkAdd(*data,mjd,n,expected);
+		try {
+			int const got=b.addBusinessDays(Date(mjd),n).getMJD();
+			if (!inside || (got!=expected)) {
+				std::cerr << "addBusinessDays(" << mjd << "," << n << ") gave "
+						  << got << std::endl;
+				bad++;
+			}
+		}
+		catch (BeautyException&) {
+			if (inside) {
+				std::cerr << "addBusinessDays(" << mjd << "," << n
+						  << ") threw" << std::endl;
+				bad++;
+			}
+		}
+
+		int const other=mjd+offset(random)*2;
+		if (!DayBitmap::covers(other)) continue;
+		int count=0;
+		for (int i=std::min(mjd,other); i<std::max(mjd,other); i++) {
+			if (isBusiness(*data,i)) count++;
+		}
+		if (other<mjd) count=-count;
+		if (b.countBusinessDays(Date(mjd),Date(other))!=count) {
+			std::cerr << "countBusinessDays(" << mjd << "," << other
+					  << ") wrong" << std::endl;
+			bad++;
+		}
+	}
+	double const ms=std::chrono::duration<double,std::milli>(
+		std::chrono::steady_clock::now()-start).count();
+
+	Date const before(1850,1,1), after(2150,1,1);
+	bad+=expectThrow("addBusinessDays(1850-01-01,1)",
+					 [&]() { b.addBusinessDays(before,1); });
+	bad+=expectThrow("addBusinessDays(2150-01-01,-1)",
+					 [&]() { b.addBusinessDays(after,-1); });
+	bad+=expectThrow("addBusinessDays(2099-12-31,1)",
+					 [&]() { b.addBusinessDays(Date(2099,12,31),1); });
+	bad+=expectThrow("countBusinessDays(1850-01-01,1901-01-10)",
+					 [&]() { b.countBusinessDays(before,Date(1901,1,10)); });
+	bad+=expectThrow("countBusinessDays(2099-12-25,2150-01-01)",
+					 [&]() { b.countBusinessDays(Date(2099,12,25),after); });
+	bad+=expectThrow("nextBusinessDay(1850-01-01)",
+					 [&]() { b.nextBusinessDay(before); });
+	bad+=expectThrow("previousBusinessDay(2150-01-01)",
+					 [&]() { b.previousBusinessDay(after); });
+	int const mjd[2]={Date(2012,1,2).getMJD(),before.getMJD()};
+	int const n[2]={1,1};
+	int res[2];
+	bad+=expectThrow("addBusinessDays(int*,...) with 1850-01-01",
+					 [&]() { b.addBusinessDays(mjd,n,2,res); });
+	if (b.countBusinessDays(Date(2099,12,25),Date(2100,1,1))!=5) {
+		std::cerr << "countBusinessDays to 2100-01-01 wrong" << std::endl;
+		bad++;
+	}
+
+	std::cout << QUERIES << " random queries of each kind in " << std::fixed
+			  << std::setprecision(1) << ms << " ms, "
+			  << (bad ? "FAILED" : "all agree") << std::endl;
+	return bad ? 1 : 0;
+}
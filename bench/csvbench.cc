@@ -0,0 +1,169 @@
+/**
+ * @file csvbench.cc
+ *
+ * Time-stamp: <2026-10-18 04:31:05 +0800 by kerwin>
+ *
+ * Benchmark of the CSV readers, readSolarCSV() and readPublicHolidayCSV(),
+ * in MB/s.
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "../include/debug.h"
+#include "../include/date.h"
+#include "../include/calendarfile.h"
+#include "../include/daybitmap.h"
+#include "../include/internedstring.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#ifdef DEBUG
+std::ofstream MY_ERR;
+#endif
+
+namespace {
+	const int FIRST_YEAR=1200;
+	///< first year of the generated feeds
+	const int LAST_YEAR=2999;
+	///< last year of the generated feeds
+	const int ROUNDS=3;
+	///< reads of each feed; the best is reported
+
+	/**
+	 * @brief which reader is timed
+	 */
+	enum Reader {
+		READ_SOLAR,		///< readSolarCSV()
+		READ_HOLIDAY,	///< readPublicHolidayCSV() into a HolidayList
+		READ_BITMAP		///< readPublicHolidayCSV() into a DayBitmap and
+						///< interned names, as CalendarData loads it
+	};
+
+	/// holiday descriptions cycled through, some with blanks and commas
+	const char* const NAME[]={
+		"New Year's Day","清明節","Labour Day","The day following Christmas",
+		"中秋節翌日","Holiday, in lieu"
+	};
+
+	/**
+	 * @brief write a feed with a line for every day of FIRST_YEAR to
+	 * LAST_YEAR, in date order
+	 *
+	 * @param path file written
+	 * @param holiday true for year,month,day,description lines, false for
+	 * year,month,day,hour,minute lines
+	 *
+	 * @return size of the file in bytes
+	 */
+	std::size_t
+	writeFeed(std::string const& path, bool holiday)
+	{
+		std::ostringstream s;
+		unsigned int n=0;
+		for (int mjd=mjdFromGregorian(FIRST_YEAR,1,1);
+			 mjd<=mjdFromGregorian(LAST_YEAR,12,31); mjd++, n++) {
+			int year;
+			unsigned int month, day;
+			gregorianFromMJD(mjd,year,month,day);
+			s << year << ',' << month << ',' << day << ',';
+			if (holiday) {
+				s << NAME[n%(sizeof(NAME)/sizeof(NAME[0]))] << '\n';
+			}
+			else {
+				s << n*7%24 << ',' << n*13%60 << '\n';
+			}
+		}
+		std::string const text=s.str();
+		std::ofstream out(path.c_str(),std::ios::binary);
+		out.write(text.data(),text.size());
+		if (!out) {
+			std::cerr << "cannot write " << path << std::endl;
+			std::exit(1);
+		}
+		return text.size();
+	}
+
+	/**
+	 * @brief time reading a feed
+	 *
+	 * @param name printed before the result
+	 * @param path feed read
+	 * @param bytes size of the feed
+	 * @param reader reader used
+	 *
+	 * @retval true if every line parsed
+	 * @retval false otherwise
+	 */
+	bool
+	report(char const* name, std::string const& path, std::size_t bytes,
+		   Reader reader)
+	{
+		double best=0;
+		std::size_t records=0;
+		unsigned long bad=0;
+		for (int r=0; r<ROUNDS; r++) {
+			SolarList solar;
+			HolidayList holidays;
+			DayBitmap days;
+			std::vector<InternedString> names;
+			std::chrono::steady_clock::time_point start=
+				std::chrono::steady_clock::now();
+			std::ifstream in(path.c_str(),std::ios::binary);
+			switch(reader){
+				case READ_SOLAR:
+					bad=readSolarCSV(in,solar);
+					records=solar.size();
+					break;
+				case READ_HOLIDAY:
+					bad=readPublicHolidayCSV(in,holidays);
+					records=holidays.size();
+					break;
+				case READ_BITMAP:
+					bad=readPublicHolidayCSV(in,days,names);
+					records=days.count();
+					break;
+			}
+			double s=std::chrono::duration<double>(
+				std::chrono::steady_clock::now()-start).count();
+			if (!r || s<best) best=s;
+		}
+		std::cout << std::setw(14) << name << ": " << records << " kept, "
+				  << std::fixed << std::setprecision(1) << bytes/1e6
+				  << " MB in " << std::setprecision(1) << best*1e3
+				  << " ms, " << std::setprecision(0) << bytes/1e6/best
+				  << " MB/s" << std::endl;
+		return !bad;
+	}
+}
+
+/**
+ * @brief time the CSV readers on generated feeds
+ *
+ * The feeds, a line for every day of 1200--2999, are written to the
+ * directory named by TMPDIR, /tmp by default, and removed afterwards.
+ * Times include building the sorted lists, as the readers do.  The
+ * holiday bitmap keeps only 1901--2099, but every line is parsed.
+ *
+ * @return 0, or 1 if a feed did not parse cleanly
+ */
+int
+main()
+{
+	char const* dir=std::getenv("TMPDIR");
+	std::string const base=std::string(dir ? dir : "/tmp")+"/csvbench-";
+	std::string const solarPath=base+"solar.csv";
+	std::string const holidayPath=base+"holiday.csv";
+	std::size_t const solarBytes=writeFeed(solarPath,false);
+	std::size_t const holidayBytes=writeFeed(holidayPath,true);
+	bool ok=report("solar",solarPath,solarBytes,READ_SOLAR);
+	ok=report("holidays",holidayPath,holidayBytes,READ_HOLIDAY) && ok;
+	ok=report("holiday bitmap",holidayPath,holidayBytes,READ_BITMAP) && ok;
+	std::remove(solarPath.c_str());
+	std::remove(holidayPath.c_str());
+	return ok ? 0 : 1;
+}
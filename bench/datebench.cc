@@ -0,0 +1,130 @@
+/**
+ * @file datebench.cc
+ *
+ * Time-stamp: <2026-10-18 04:12:40 +0800 by kerwin>
+ *
+ * Benchmark of the Date conversions: the individual getters against
+ * Date::decode(), per day.
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "../include/debug.h"
+#include "../include/date.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#ifdef DEBUG
+std::ofstream MY_ERR;
+#endif
+
+namespace {
+	const int ROUNDS=20;
+	///< times every day of the range is converted
+
+	/**
+	 * @brief convert every day of a range with the individual getters
+	 *
+	 * Two dates half the range apart are converted in turn, as a month
+	 * page does with the day and its neighbours, so no getter can live
+	 * off the previous call.
+	 *
+	 * @param first MJD of the first day
+	 * @param last MJD of the last day
+	 *
+	 * @return sum of the fields, so the work is not optimised away
+	 */
+	unsigned long
+	getters(int first, int last)
+	{
+		unsigned long sum=0;
+		int half=(last-first+1)/2;
+		for (int mjd=first; mjd<first+half; mjd++) {
+			Date const d[2]={Date(mjd,Date::CALTYPE_MJD),
+							 Date(mjd+half,Date::CALTYPE_MJD)};
+			for (unsigned int i=0; i<2; i++) {
+				sum+=d[i].getGregorianYear()+d[i].getGregorianMonth()+
+					d[i].getGregorianDay()+d[i].getChineseMonth()+
+					d[i].getChineseDay()+d[i].getDayOfYear();
+			}
+		}
+		return sum;
+	}
+
+	/**
+	 * @brief convert every day of a range with Date::decode()
+	 *
+	 * Same order as getters().
+	 *
+	 * @param first MJD of the first day
+	 * @param last MJD of the last day
+	 *
+	 * @return sum of the fields, so the work is not optimised away
+	 */
+	unsigned long
+	decoded(int first, int last)
+	{
+		unsigned long sum=0;
+		int half=(last-first+1)/2;
+		for (int mjd=first; mjd<first+half; mjd++) {
+			Date const d[2]={Date(mjd,Date::CALTYPE_MJD),
+							 Date(mjd+half,Date::CALTYPE_MJD)};
+			for (unsigned int i=0; i<2; i++) {
+				DateFields const f=d[i].decode();
+				sum+=f.gregorianYear+f.gregorianMonth+f.gregorianDay+
+					f.chineseMonth+f.chineseDay+f.dayOfYear;
+			}
+		}
+		return sum;
+	}
+
+	/**
+	 * @brief time one way of converting, in ns per day
+	 *
+	 * @param name printed before the result
+	 * @param convert getters or decoded
+	 * @param first MJD of the first day
+	 * @param last MJD of the last day
+	 */
+	void
+	report(char const* name, unsigned long (*convert)(int, int),
+		   int first, int last)
+	{
+		unsigned long sum=convert(first,last);	// warm up, builds tables
+		std::chrono::steady_clock::time_point start=
+			std::chrono::steady_clock::now();
+		for (int r=0; r<ROUNDS; r++) sum+=convert(first,last);
+		double ns=std::chrono::duration<double,std::nano>(
+			std::chrono::steady_clock::now()-start).count();
+		long days=(long)ROUNDS*((last-first+1)/2*2);
+		std::cout << std::setw(10) << name << ": " << std::fixed
+				  << std::setprecision(1) << ns/days << " ns/day"
+				  << " (checksum " << sum%1000 << ")" << std::endl;
+	}
+}
+
+/**
+ * @brief time Date conversions of 2001--2050 and 1700--1749
+ *
+ * Gregorian y/m/d, Chinese m/d and day of year are read for every day,
+ * once through the getters and once through Date::decode().
+ *
+ * @return 0
+ */
+int
+main()
+{
+	struct {
+		char const* name;
+		int first, last;
+	} const range[]={
+		{"2001-2050",mjdFromGregorian(2001,1,1),mjdFromGregorian(2050,12,31)},
+		{"1700-1749",mjdFromGregorian(1700,1,1),mjdFromGregorian(1749,12,31)}
+	};
+	for (unsigned int i=0; i<sizeof(range)/sizeof(range[0]); i++) {
+		std::cout << range[i].name << std::endl;
+		report("getters",getters,range[i].first,range[i].last);
+		report("decode()",decoded,range[i].first,range[i].last);
+	}
+	return 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file lunationcheck.cc
+ *
+ * Time-stamp: <2026-10-18 06:54:20 +0800 by kerwin>
+ *
+ * Checks LunationEngine against the lunar table of Date, and the Chinese
+ * calendar of Date over the whole range the engine supports.
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "../include/debug.h"
+#include "../include/date.h"
+#include "../include/lunation.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#ifdef DEBUG
+std::ofstream MY_ERR;
+#endif
+
+namespace {
+	const int TABLE_FIRST_YEAR=1901;
+	///< first year of the lunar table
+	const int TABLE_LAST_YEAR=2099;
+	///< last year of the lunar table
+	const int EXCEPTION[]={1906,1989,2025,2057,2089,2097};
+	///< years where the engine is known to differ from the table, see
+	///< LunationEngine
+
+	/**
+	 * @brief milliseconds since a time point
+	 *
+	 * @param start the time point
+	 *
+	 * @return elapsed time
+	 */
+	double
+	since(std::chrono::steady_clock::time_point const& start)
+	{
+		return std::chrono::duration<double,std::milli>(
+			std::chrono::steady_clock::now()-start).count();
+	}
+
+	/**
+	 * @brief check if a year is a known exception
+	 *
+	 * @param year Gregorian year
+	 *
+	 * @retval true if year is in EXCEPTION
+	 * @retval false otherwise
+	 */
+	bool
+	isException(int year)
+	{
+		int const* end=EXCEPTION+sizeof(EXCEPTION)/sizeof(EXCEPTION[0]);
+		return std::find(EXCEPTION,end,year)!=end;
+	}
+
+	/**
+	 * @brief compare the engine with the table year by year
+	 *
+	 * Each year the engine works out is packed as the table is, see
+	 * Date::getLunarCalendarData().
+	 *
+	 * @return number of years differing, known exceptions not counted
+	 */
+	unsigned int
+	compareTable()
+	{
+		unsigned int bad=0, known=0;
+		for (int year=TABLE_FIRST_YEAR; year<=TABLE_LAST_YEAR; year++) {
+			int newYear;
+			unsigned int leap, longMonths;
+			LunationEngine::getChineseYear(year,newYear,leap,longMonths);
+			unsigned long const table=Date::getLunarCalendarData(year);
+			int const base=mjdFromGregorian(1+50*((year-1)/50),1,0);
+			unsigned long const engine=((unsigned long)leap<<28)|
+				((unsigned long)longMonths<<15)|(unsigned long)(newYear-base);
+			if (engine==table) {
+				if (isException(year)) {
+					std::cout << year << ": known exception now agrees"
+							  << std::endl;
+				}
+				continue;
+			}
+			bool const expected=isException(year);
+			(expected ? std::cout : std::cerr)
+				<< year << ": engine " << std::hex << engine << ", table "
+				<< table << std::dec
+				<< (((engine ^ table) & 0x7FFF) ? ", New Year" : "")
+				<< (((engine ^ table)>>28) ? ", leap month" : "")
+				<< ((((engine ^ table)>>15) & 0x1FFF) ? ", month lengths" : "")
+				<< (expected ? " (known)" : "") << std::endl;
+			if (expected) {
+				known++;
+			}
+			else {
+				bad++;
+			}
+		}
+		std::cout << TABLE_LAST_YEAR-TABLE_FIRST_YEAR+1 << " years against"
+				  << " the table, " << known << " known exception(s), "
+				  << bad << " other difference(s)" << std::endl;
+		return bad;
+	}
+
+	/**
+	 * @brief walk every day of the engine's range
+	 *
+	 * Each day must follow the one before in the Chinese calendar, be
+	 * given back by mjdFromChinese(), and decode the same through
+	 * Date::decode().
+	 *
+	 * @return number of bad days
+	 */
+	unsigned int
+	walkRange()
+	{
+		int const first=mjdFromGregorian(LunationEngine::FIRST_YEAR,1,1);
+		int const last=mjdFromGregorian(LunationEngine::LAST_YEAR,12,31);
+		unsigned int bad=0;
+		int lastYear=0;
+		unsigned int lastMonth=0, lastDay=0;
+		for (int mjd=first; mjd<=last; mjd++) {
+			int year;
+			unsigned int month, day;
+			chineseFromMJD(mjd,year,month,day);
+			bool ok=(mjdFromChinese(year,month,day)==mjd);
+			DateFields const f=Date(mjd,Date::CALTYPE_MJD).decode();
+			ok=ok && (f.chineseYear==year) && (f.chineseMonth==month) &&
+				(f.chineseDay==day);
+			if (mjd>first) {
+				if (day==1) {
+					ok=ok && ((lastDay==29) || (lastDay==30)) &&
+						((month==1) ? (year==lastYear+1) : (year==lastYear));
+				}
+				else {
+					ok=ok && (year==lastYear) && (month==lastMonth) &&
+						(day==lastDay+1);
+				}
+			}
+			if (!ok) {
+				std::cerr << "MJD " << mjd << ": " << year << "/" << month
+						  << "/" << day << " after " << lastYear << "/"
+						  << lastMonth << "/" << lastDay << std::endl;
+				bad++;
+			}
+			lastYear=year;
+			lastMonth=month;
+			lastDay=day;
+		}
+		std::cout << last-first+1 << " days of " << LunationEngine::FIRST_YEAR
+				  << "--" << LunationEngine::LAST_YEAR << ", " << bad
+				  << " bad" << std::endl;
+		return bad;
+	}
+}
+
+/**
+ * @brief time a century, compare with the table, walk the whole range
+ *
+ * The century is timed first, while Date has kept nothing of it.
+ *
+ * @return 0 if the only differences from the table are the known
+ * exceptions and every day of the range is good, else 1
+ */
+int
+main()
+{
+	std::chrono::steady_clock::time_point start=
+		std::chrono::steady_clock::now();
+	for (int year=2100; year<2200; year++) Date::getLunarCalendarData(year);
+	std::cout << "2100--2199 worked out in " << std::fixed
+			  << std::setprecision(1) << since(start) << " ms" << std::endl;
+
+	unsigned int bad=compareTable();
+	bad+=walkRange();
+	std::cout << (bad ? "FAILED" : "all agree") << std::endl;
+	return bad ? 1 : 0;
+}
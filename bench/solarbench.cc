@@ -0,0 +1,180 @@
+/**
+ * @file solarbench.cc
+ *
+ * Time-stamp: <2026-10-18 06:31:48 +0800 by kerwin>
+ *
+ * Benchmark of SolarTermEngine: time to fill 1901--2099, and how far the
+ * engine is from solar.dat.
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "../include/debug.h"
+#include "../include/solarterm.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#ifdef DEBUG
+std::ofstream MY_ERR;
+#endif
+
+namespace {
+	const int FIRST_YEAR=1901;
+	///< first year filled in
+	const int LAST_YEAR=2099;
+	///< last year filled in
+
+	/**
+	 * @brief milliseconds since a time point
+	 *
+	 * @param start the time point
+	 *
+	 * @return elapsed time
+	 */
+	double
+	since(std::chrono::steady_clock::time_point const& start)
+	{
+		return std::chrono::duration<double,std::milli>(
+			std::chrono::steady_clock::now()-start).count();
+	}
+
+	/**
+	 * @brief minutes from one solar term to another
+	 *
+	 * @param a MJD and time of the first
+	 * @param b MJD and time of the second
+	 *
+	 * @return b less a, in minutes
+	 */
+	long
+	minutes(SolarList::value_type const& a, SolarList::value_type const& b)
+	{
+		return (long)(b.first-a.first)*24*60+
+			(long)b.second.minute-(long)a.second.minute;
+	}
+
+	/**
+	 * @brief check the terms worked out for 1901--2099
+	 *
+	 * They must ascend, be numbered 0 to 23 in turn, and each number must
+	 * be the one SolarTermEngine::getTerm() gives for the date.
+	 *
+	 * @param solar fill() of an empty list over the years
+	 *
+	 * @return number of bad terms
+	 */
+	unsigned int
+	checkOrder(SolarList const& solar)
+	{
+		unsigned int bad=0;
+		std::size_t const expected=
+			(std::size_t)SolarTermEngine::TERMS*(LAST_YEAR-FIRST_YEAR+1);
+		if (solar.size()!=expected) {
+			std::cerr << solar.size() << " terms, expected " << expected
+					  << std::endl;
+			bad++;
+		}
+		for (std::size_t i=0; i<solar.size(); i++) {
+			if ((i && (minutes(solar[i-1],solar[i])<=0)) ||
+				(solar[i].second.term!=i%SolarTermEngine::TERMS) ||
+				(SolarTermEngine::getTerm(solar[i].first)!=
+				 solar[i].second.term)) {
+				std::cerr << "term " << i << " on MJD " << solar[i].first
+						  << " out of order or misnumbered" << std::endl;
+				bad++;
+			}
+		}
+		return bad;
+	}
+
+	/**
+	 * @brief compare the engine with the terms of a CSV file
+	 *
+	 * Every term of the file has a term of the engine within a week, so
+	 * a fill() of the file over its years adds nothing and numbers every
+	 * term; the engine's instant is then looked up by number.
+	 *
+	 * @param path the CSV file
+	 *
+	 * @return number of terms more than a minute off
+	 */
+	unsigned int
+	compareFile(char const* path)
+	{
+		std::ifstream in(path);
+		SolarList solar;
+		if (!in || readSolarCSV(in,solar) || solar.empty()) {
+			std::cerr << "cannot read " << path << std::endl;
+			return 1;
+		}
+		int const first=Date(solar.front().first).getGregorianYear();
+		int const last=Date(solar.back().first).getGregorianYear();
+		unsigned int bad=0;
+		if (SolarTermEngine::fill(solar,first,last)) {
+			std::cerr << path << " misses terms of " << first << "--" << last
+					  << std::endl;
+			bad++;
+		}
+		unsigned int exact=0, close=0;
+		for (std::size_t i=0; i<solar.size(); i++) {
+			Date const d(solar[i].first);
+			DateTime const t=SolarTermEngine::getInstant(
+				d.getGregorianYear(),solar[i].second.term);
+			SolarTime const engine={t.getMinuteOfDay(),solar[i].second.term};
+			long const off=minutes(solar[i],
+								   std::make_pair(t.getDate().getMJD(),engine));
+			if (!off) {
+				exact++;
+			}
+			else if (std::labs(off)==1) {
+				close++;
+			}
+			else {
+				std::cerr << d.getGregorianYear() << "-"
+						  << d.getGregorianMonth() << "-"
+						  << d.getGregorianDay() << ": engine " << off
+						  << " minutes off" << std::endl;
+				bad++;
+			}
+		}
+		std::cout << path << ": " << solar.size() << " terms, " << exact
+				  << " exact, " << close << " a minute off" << std::endl;
+		return bad;
+	}
+}
+
+/**
+ * @brief time filling 1901--2099, then check the result and solar.dat
+ *
+ * The first fill works every year out; the second is served from the
+ * engine's cache.  Run from the top directory, so the data files are
+ * found.
+ *
+ * @return 0 if the terms are in order and within a minute of solar.dat,
+ * else 1
+ */
+int
+main()
+{
+	SolarList solar;
+	std::chrono::steady_clock::time_point start=
+		std::chrono::steady_clock::now();
+	SolarTermEngine::fill(solar,FIRST_YEAR,LAST_YEAR);
+	double const cold=since(start);
+	SolarList again;
+	start=std::chrono::steady_clock::now();
+	SolarTermEngine::fill(again,FIRST_YEAR,LAST_YEAR);
+	double const warm=since(start);
+	std::cout << "fill(" << FIRST_YEAR << "," << LAST_YEAR << "): "
+			  << solar.size() << " terms, " << std::fixed
+			  << std::setprecision(1) << cold << " ms, cached "
+			  << warm << " ms" << std::endl;
+
+	unsigned int bad=checkOrder(solar);
+	if (!bad) std::cout << "terms ascending and numbered in turn" << std::endl;
+	bad+=compareFile("solar.dat");
+	if (bad) std::cout << "FAILED" << std::endl;
+	return bad ? 1 : 0;
+}
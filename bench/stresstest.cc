@@ -0,0 +1,205 @@
+/**
+ * @file stresstest.cc
+ *
+ * Time-stamp: <2026-10-18 04:52:17 +0800 by kerwin>
+ *
+ * Renders many years at once from several threads, and checks the result
+ * is byte for byte what a serial run gives.
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "../include/debug.h"
+#include "../include/calendar.h"
+#include "../include/lunation.h"
+#include "../include/texsink.h"
+#include "../include/threadpool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef DEBUG
+std::ofstream MY_ERR;
+#endif
+
+namespace {
+	const int FIRST_YEAR=LunationEngine::FIRST_YEAR;
+	///< first year rendered
+	const int LAST_YEAR=LunationEngine::LAST_YEAR;
+	///< last year rendered
+	const int YEARS=LAST_YEAR-FIRST_YEAR+1;
+	///< number of years rendered
+
+	/**
+	 * @brief milliseconds since a time point
+	 *
+	 * @param start the time point
+	 *
+	 * @return elapsed time
+	 */
+	double
+	since(std::chrono::steady_clock::time_point const& start)
+	{
+		return std::chrono::duration<double,std::milli>(
+			std::chrono::steady_clock::now()-start).count();
+	}
+
+	/**
+	 * @brief render a year the way most callers do
+	 *
+	 * @param year year rendered
+	 *
+	 * @return the TeX code
+	 */
+	std::string
+	render(int year)
+	{
+		std::string res;
+		StringSink sink(res);
+		Calendar(year).writeFullYearTex(sink);
+		return res;
+	}
+
+	/**
+	 * @brief count the years whose output differs from the serial run
+	 *
+	 * @param name printed with each mismatch
+	 * @param expected serial output, indexed by year-FIRST_YEAR
+	 * @param got output to check, same indexing
+	 *
+	 * @return number of mismatching years
+	 */
+	unsigned int
+	compare(char const* name, std::vector<std::string> const& expected,
+			std::vector<std::string> const& got)
+	{
+		unsigned int bad=0;
+		for (int i=0; i<YEARS; i++) {
+			if (got[i]!=expected[i]) {
+				std::cerr << name << ": " << FIRST_YEAR+i << " differs"
+						  << std::endl;
+				bad++;
+			}
+		}
+		return bad;
+	}
+
+	/**
+	 * @brief render every year from several threads at once
+	 *
+	 * Each thread takes the next year from a shared counter and renders
+	 * it twice, once page by page through the by-value getters with two
+	 * Calendar objects interleaved, and once through writeFullYearTex();
+	 * the two must agree.
+	 *
+	 * @param threads number of threads
+	 * @param[out] res output, indexed by year-FIRST_YEAR
+	 *
+	 * @return number of years whose two renderings disagree
+	 */
+	unsigned int
+	renderThreads(unsigned int threads, std::vector<std::string>& res)
+	{
+		std::atomic<int> next(0);
+		std::atomic<unsigned int> bad(0);
+		std::vector<std::thread> worker;
+		for (unsigned int t=0; t<threads; t++) {
+			worker.push_back(std::thread([&]() {
+				for (int i=next++; i<YEARS; i=next++) {
+					int const other=FIRST_YEAR+(i+YEARS/2)%YEARS;
+					Calendar c(FIRST_YEAR+i), d(other);
+					std::string s=c.getTexPreamble();
+					for (unsigned int m=1; m<=12; m++) {
+						s+=c.getTexMonth(m);
+						d.getTexMonth(13-m);	// interleaved, thrown away
+					}
+					s+=c.getTexEnd();
+					res[i]=render(FIRST_YEAR+i);
+					if (s!=res[i]) bad++;
+				}
+			}));
+		}
+		for (unsigned int t=0; t<threads; t++) worker[t].join();
+		return bad;
+	}
+
+	/**
+	 * @brief render every year on a ThreadPool, as --years does
+	 *
+	 * Each year is a task, and spreads its months over the same pool.
+	 *
+	 * @param threads number of threads
+	 * @param[out] res output, indexed by year-FIRST_YEAR
+	 */
+	void
+	renderPool(unsigned int threads, std::vector<std::string>& res)
+	{
+		ThreadPool pool(threads);
+		for (int i=0; i<YEARS; i++) {
+			std::string* out=&res[i];
+			int const year=FIRST_YEAR+i;
+			pool.submit([out,year,&pool]() {
+					StringSink sink(*out);
+					Calendar(year).writeFullYearTex(sink,pool);
+				});
+		}
+		pool.wait();
+	}
+}
+
+/**
+ * @brief render every year serially, then concurrently, and compare
+ *
+ * The number of threads is the first argument, by default the larger of
+ * 4 and the number of hardware threads.  Run from the top directory, so
+ * the data files are found.
+ *
+ * @param argc number of arguments
+ * @param argv the arguments
+ *
+ * @return 0 if every concurrent rendering matches the serial one, else 1
+ */
+int
+main(int argc, char** argv)
+{
+	unsigned int threads=std::thread::hardware_concurrency();
+	if (threads<4) threads=4;
+	if (argc>1) threads=std::atoi(argv[1]);
+	if (!threads) {
+		std::cerr << "usage: " << argv[0] << " [threads]" << std::endl;
+		return 1;
+	}
+	CalendarData::getDefault();
+	render(2012);	// warm up the shared tables
+
+	std::vector<std::string> serial(YEARS), threaded(YEARS), pooled(YEARS);
+	std::chrono::steady_clock::time_point start=
+		std::chrono::steady_clock::now();
+	for (int i=0; i<YEARS; i++) serial[i]=render(FIRST_YEAR+i);
+	double const serialTime=since(start);
+
+	start=std::chrono::steady_clock::now();
+	unsigned int bad=renderThreads(threads,threaded);
+	double const threadTime=since(start);
+	if (bad) std::cerr << "threads: " << bad << " year(s) disagree"
+					   << " between getters and sink" << std::endl;
+	bad+=compare("threads",serial,threaded);
+
+	start=std::chrono::steady_clock::now();
+	renderPool(threads,pooled);
+	double const poolTime=since(start);
+	bad+=compare("pool",serial,pooled);
+
+	std::cout << std::fixed << std::setprecision(1) << YEARS << " years, "
+			  << threads << " thread(s)" << std::endl
+			  << "  serial:  " << serialTime << " ms" << std::endl
+			  << "  threads: " << threadTime << " ms, each year rendered"
+			  << " twice plus 12 interleaved pages" << std::endl
+			  << "  pool:    " << poolTime << " ms" << std::endl
+			  << (bad ? "FAILED" : "identical to serial run") << std::endl;
+	return bad ? 1 : 0;
+}
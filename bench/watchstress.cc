@@ -0,0 +1,254 @@
+/**
+ * @file watchstress.cc
+ *
+ * Time-stamp: <2026-10-18 06:02:37 +0800 by kerwin>
+ *
+ * Rewrites pubhol.dat under a CalendarWatcher while other threads keep
+ * rendering, and checks every rewrite is reloaded and published.
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "../include/debug.h"
+#include "../include/calendar.h"
+#include "../include/calendarwatcher.h"
+#include "../include/texsink.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#ifdef DEBUG
+std::ofstream MY_ERR;
+#endif
+
+namespace {
+	const unsigned int READERS=4;
+	///< threads rendering while the file is rewritten
+	const unsigned int REWRITES=10;
+	///< times pubhol.dat is rewritten
+	const int REWRITE_MS=200;
+	///< time between rewrites, well above the watcher's settle time
+	const int WAIT_MS=5000;
+	///< longest wait for the last reload
+
+	/**
+	 * @brief sink throwing everything away
+	 */
+	class NullSink : public TexSink {
+	  public:
+		void write(char const*, std::size_t) {}
+		using TexSink::write;
+	};
+
+	/**
+	 * @brief milliseconds since a time point
+	 *
+	 * @param start the time point
+	 *
+	 * @return elapsed time
+	 */
+	double
+	since(std::chrono::steady_clock::time_point const& start)
+	{
+		return std::chrono::duration<double,std::milli>(
+			std::chrono::steady_clock::now()-start).count();
+	}
+
+	/**
+	 * @brief read a whole file
+	 *
+	 * @param path file read
+	 *
+	 * @return its content
+	 */
+	std::string
+	slurp(std::string const& path)
+	{
+		std::ifstream in(path.c_str(),std::ios::binary);
+		std::ostringstream s;
+		s << in.rdbuf();
+		if (!in) {
+			std::cerr << "cannot read " << path << std::endl;
+			std::exit(1);
+		}
+		return s.str();
+	}
+
+	/**
+	 * @brief write a whole file
+	 *
+	 * @param path file written
+	 * @param text its content
+	 */
+	void
+	spill(std::string const& path, std::string const& text)
+	{
+		std::ofstream out(path.c_str(),std::ios::binary);
+		out.write(text.data(),text.size());
+		out.close();
+		if (!out) {
+			std::cerr << "cannot write " << path << std::endl;
+			std::exit(1);
+		}
+	}
+
+	/**
+	 * @brief description of the holiday added by a rewrite
+	 *
+	 * @param i number of the rewrite
+	 *
+	 * @return the description
+	 */
+	std::string
+	marker(unsigned int i)
+	{
+		std::ostringstream s;
+		s << "Rewrite " << i;
+		return s.str();
+	}
+}
+
+/**
+ * @brief rewrite pubhol.dat in a scratch directory while rendering
+ *
+ * solar.dat and pubhol.dat are copied to a directory made under TMPDIR,
+ * /tmp by default, which is watched.  Each rewrite adds a holiday on
+ * 2012-08-(i+1), alternately written in place and renamed over the file,
+ * so both events the watcher listens for are seen.  Readers render 2012
+ * after Calendar::refresh() all the while; the slowest render is
+ * reported.  Run from the top directory, so the data files are found.
+ *
+ * @return 0 if every rewrite was reloaded, published and seen, else 1
+ */
+int
+main()
+{
+	char const* tmp=std::getenv("TMPDIR");
+	std::string dir=std::string(tmp ? tmp : "/tmp")+"/watchstress-XXXXXX";
+	if (!mkdtemp(&dir[0])) {
+		std::cerr << "cannot make a directory in " << (tmp ? tmp : "/tmp")
+				  << std::endl;
+		return 1;
+	}
+	std::string const solar=dir+"/solar.dat", holiday=dir+"/pubhol.dat";
+	std::string const original=slurp("pubhol.dat");
+	spill(solar,slurp("solar.dat"));
+	spill(holiday,original);
+	CalendarData::publish(CalendarData::load(dir));
+	unsigned long const firstVersion=CalendarData::getDefault()->getVersion();
+	unsigned long const firstGeneration=CalendarData::getGeneration();
+
+	unsigned int bad=0;
+	std::atomic<bool> stop(false);
+	std::atomic<unsigned long> renders(0), failures(0), seen(0);
+	std::vector<double> slowest(READERS,0);
+	std::vector<std::thread> reader;
+	{
+		CalendarWatcher watcher(dir);
+		for (unsigned int t=0; t<READERS; t++) {
+			reader.push_back(std::thread([&,t]() {
+				Calendar c(2012);
+				NullSink sink;
+				while (!stop) {
+					std::chrono::steady_clock::time_point start=
+						std::chrono::steady_clock::now();
+					bool changed=false;
+					try {
+						changed=c.refresh();
+						c.writeFullYearTex(sink);
+					}
+					catch (...) {
+						failures++;
+					}
+					double const ms=since(start);
+					if (ms>slowest[t]) slowest[t]=ms;
+					if (changed) seen++;
+					renders++;
+				}
+			}));
+		}
+
+		std::string text=original;
+		for (unsigned int i=0; i<REWRITES; i++) {
+			std::this_thread::sleep_for(
+				std::chrono::milliseconds(REWRITE_MS));
+			std::ostringstream line;
+			line << "2012,8," << i+1 << ',' << marker(i) << '\n';
+			text+=line.str();
+			if (i & 1) {
+				spill(holiday+".new",text);
+				std::rename((holiday+".new").c_str(),holiday.c_str());
+			}
+			else {
+				spill(holiday,text);
+			}
+		}
+		std::chrono::steady_clock::time_point start=
+			std::chrono::steady_clock::now();
+		while ((watcher.getReloadCount()<REWRITES) && (since(start)<WAIT_MS)) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(REWRITE_MS));
+		stop=true;
+		for (unsigned int t=0; t<READERS; t++) reader[t].join();
+
+		unsigned long const reloads=watcher.getReloadCount();
+		unsigned long const generations=
+			CalendarData::getGeneration()-firstGeneration;
+		std::cout << REWRITES << " rewrites, " << reloads << " reload(s), "
+				  << generations << " publish(es)" << std::endl;
+		if (reloads!=REWRITES) {
+			std::cerr << "expected " << REWRITES << " reloads" << std::endl;
+			bad++;
+		}
+		if (generations!=reloads) {
+			std::cerr << "reloads and publishes disagree" << std::endl;
+			bad++;
+		}
+	}
+
+	std::shared_ptr<const CalendarData> last=CalendarData::getDefault();
+	if (last->getVersion()==firstVersion) {
+		std::cerr << "published version did not change" << std::endl;
+		bad++;
+	}
+	for (unsigned int i=0; i<REWRITES; i++) {
+		Date const d(2012,8,i+1);
+		if (!last->isPublicHoliday(d) ||
+			(last->getPublicHolidayName(d)!=marker(i))) {
+			std::cerr << "2012-08-" << i+1 << " missing from the last load"
+					  << std::endl;
+			bad++;
+		}
+	}
+	if (!seen) {
+		std::cerr << "no reader saw a new version" << std::endl;
+		bad++;
+	}
+	if (failures) {
+		std::cerr << failures << " render(s) threw" << std::endl;
+		bad++;
+	}
+	double worst=0;
+	for (unsigned int t=0; t<READERS; t++) {
+		if (slowest[t]>worst) worst=slowest[t];
+	}
+	std::cout << READERS << " reader(s), " << renders << " renders, "
+			  << seen << " version change(s) seen, slowest render "
+			  << std::fixed << std::setprecision(1) << worst << " ms"
+			  << std::endl << (bad ? "FAILED" : "every rewrite published")
+			  << std::endl;
+
+	std::remove(solar.c_str());
+	std::remove(holiday.c_str());
+	rmdir(dir.c_str());
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,224 @@
+/**
+ * @file businesscalendar.cc
+ *
+ * Time-stamp: <2026-10-17 14:26:40 +0800 by kerwin>
+ *
+ * Business day arithmetic over the public holidays of a Calendar
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "include/debug.h"
+#include "include/businesscalendar.h"
+
+namespace {
+	/**
+	 * @brief check if a day can be an end of a range of DayBitmap days
+	 *
+	 * @param mjd MJD of the day
+	 *
+	 * @retval true if 1901-01-01 <= mjd <= 2100-01-01
+	 * @retval false otherwise
+	 */
+	inline
+	bool
+	boundsRange(int mjd)
+	{
+		return (mjd>=DayBitmap::firstMJD()) && (mjd<=DayBitmap::lastMJD()+1);
+	}
+}
+
+/**
+ * @brief construct from the public holidays of a calendar
+ *
+ * @param cal calendar holding the public holidays
+ * @param weekend bit (1<<Date::DayOfWeek) set for each weekend day
+ */
+BusinessCalendar::BusinessCalendar(Calendar const& cal, unsigned int weekend)
+{
+#ifdef DEBUG
+	MY_ERR << "BusinessCalendar::BusinessCalendar((Calendar*)" << &cal
+		   << "," << weekend << ") called." << std::endl;
+#endif
+	build(cal.getPublicHolidays(),weekend);
+}
+
+/**
+ * @brief construct from a set of holidays
+ *
+ * @param holiday bitmap of public holidays
+ * @param weekend bit (1<<Date::DayOfWeek) set for each weekend day
+ */
+BusinessCalendar::BusinessCalendar(DayBitmap const& holiday,
+								   unsigned int weekend)
+{
+#ifdef DEBUG
+	MY_ERR << "BusinessCalendar::BusinessCalendar((DayBitmap*)" << &holiday
+		   << "," << weekend << ") called." << std::endl;
+#endif
+	build(holiday,weekend);
+}
+
+/**
+ * @brief fill the business day bitmap
+ *
+ * @param holiday bitmap of public holidays
+ * @param weekend bit (1<<Date::DayOfWeek) set for each weekend day
+ */
+void
+BusinessCalendar::build(DayBitmap const& holiday, unsigned int weekend)
+{
+	if (weekend & ~0x7Fu) {
+		throw INVALID_PARAM(weekend);
+	}
+	_nBusinessDay=DayBitmap::daysOfWeek(~weekend & 0x7Fu);
+	_nBusinessDay-=holiday;
+	_nBusinessDay.buildIndex();
+}
+
+/**
+ * @brief first business day after a date
+ *
+ * Throws INVALID_PARAM if d is outside 1901--2099.
+ *
+ * @param d a date
+ *
+ * @return first business day strictly after d
+ */
+Date
+BusinessCalendar::nextBusinessDay(Date const& d) const
+{
+	if (!DayBitmap::covers(d.getMJD())) {
+		throw INVALID_PARAM(d.getMJD());
+	}
+	Date res=d+1;
+	if (!_nBusinessDay.findNext(res)) {
+		throw Exception("Invalid parameter d --- no business day after it");
+	}
+	return res;
+}
+
+/**
+ * @brief last business day before a date
+ *
+ * Throws INVALID_PARAM if d is outside 1901--2099.
+ *
+ * @param d a date
+ *
+ * @return last business day strictly before d
+ */
+Date
+BusinessCalendar::previousBusinessDay(Date const& d) const
+{
+	if (!DayBitmap::covers(d.getMJD())) {
+		throw INVALID_PARAM(d.getMJD());
+	}
+	Date res=d-1;
+	if (!_nBusinessDay.findPrevious(res)) {
+		throw Exception("Invalid parameter d --- no business day before it");
+	}
+	return res;
+}
+
+/**
+ * @brief add business days to a MJD
+ *
+ * Throws INVALID_PARAM if mjd is outside 1901--2099, or the result would
+ * be.
+ *
+ * @param mjd start date, need not be a business day
+ * @param n number of business days to move, may be negative
+ *
+ * @return MJD of result
+ */
+int
+BusinessCalendar::addBusinessDaysMJD(int mjd, int n) const
+{
+	if (!DayBitmap::covers(mjd)) {
+		throw INVALID_PARAM(mjd);
+	}
+	if (n==0) return mjd;
+	// business days before mjd, plus mjd itself when moving forward
+	long k=_nBusinessDay.rank(Date(n>0 ? mjd+1 : mjd));
+	k+=(n>0) ? n-1 : n;
+	Date res;
+	if ((k<0) || !_nBusinessDay.select(k,res)) {
+		throw INVALID_PARAM(n);
+	}
+	return res.getMJD();
+}
+
+/**
+ * @brief add business days to a date
+ *
+ * The start date itself is never counted: adding 1 gives
+ * nextBusinessDay(d) and adding -1 gives previousBusinessDay(d), whether or
+ * not d is a business day.
+ *
+ * @param d start date
+ * @param n number of business days to move, may be negative
+ *
+ * @return the n-th business day after d, or the -n-th before if n<0, or
+ * d if n==0
+ */
+Date
+BusinessCalendar::addBusinessDays(Date const& d, int n) const
+{
+#ifdef DEBUG
+	MY_ERR << this << "->BusinessCalendar::addBusinessDays(Date(" << d.getYear()
+		   << "," << d.getMonth() << "," << d.getDay() << ")," << n
+		   << ") called." << std::endl;
+#endif
+	return Date(addBusinessDaysMJD(d.getMJD(),n));
+}
+
+/**
+ * @brief count business days between two dates
+ *
+ * Throws INVALID_PARAM unless both dates are within 1901-01-01 to
+ * 2100-01-01, so the range is within 1901--2099.
+ *
+ * @param first first day of range
+ * @param last  day after the end of range
+ *
+ * @return number of business days d with first <= d < last, negated if
+ * last is before first
+ */
+int
+BusinessCalendar::countBusinessDays(Date const& first, Date const& last) const
+{
+	if (!boundsRange(first.getMJD())) {
+		throw INVALID_PARAM(first.getMJD());
+	}
+	if (!boundsRange(last.getMJD())) {
+		throw INVALID_PARAM(last.getMJD());
+	}
+	if (last<first) return -(int)_nBusinessDay.count(last,first);
+	return _nBusinessDay.count(first,last);
+}
+
+/**
+ * @brief add business days to arrays of dates
+ *
+ * Same as addBusinessDays(Date(mjd[i]),offset[i]) for each i, and throws
+ * INVALID_PARAM in the same cases, leaving the results before the bad
+ * element written.
+ *
+ * @param[in] mjd array of n start dates as MJD
+ * @param[in] offset array of n business day offsets
+ * @param n number of elements
+ * @param[out] res array of n results as MJD, may alias mjd
+ */
+void
+BusinessCalendar::addBusinessDays(int const* mjd, int const* offset,
+								  std::size_t n, int* res) const
+{
+#ifdef DEBUG
+	MY_ERR << this << "->BusinessCalendar::addBusinessDays((int*)" << mjd
+		   << ",(int*)" << offset << "," << n << ",(int*)" << res
+		   << ") called." << std::endl;
+#endif
+	for (std::size_t i=0; i<n; i++) {
+		res[i]=addBusinessDaysMJD(mjd[i],offset[i]);
+	}
+}
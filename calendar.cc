@@ -10,11 +10,19 @@
 
 #include "include/debug.h"
 #include "include/calendar.h"
+#include "include/threadpool.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <map>
+#include <mutex>
 #include <sstream>
+#include <vector>
 
 
 // static initialisation
@@ -71,7 +79,300 @@ namespace {
 	const std::string LATEX_NEWLINE="\\\\";
 	const std::string LATEX_CJK_BEGIN="\\cjktext{";
 	const char LATEX_CJK_END='}';
-};
+
+	const unsigned char DAY_SOLAR=1;
+	///< day note flag: a solar term, shows its name and time
+	const unsigned char DAY_HOLIDAY=2;
+	///< day note flag: a public holiday, shows its description in red
+	const unsigned char DAY_CHINESE_MONTH=4;
+	///< day note flag: shows the Chinese month, unless a solar term
+	const unsigned char DAY_CHINESE_DAY=8;
+	///< day note flag: shows the Chinese day, unless a solar term
+
+	/**
+	 * @brief TeX preamble up to the small month cells, the same every year
+	 */
+	const char TEX_PREAMBLE_HEAD[]=
+			//usual preamble stuff
+		"\\documentclass[12pt]{article}\n"
+		"\\usepackage{color}\n"
+		"\\usepackage[math]{iwona}\n"
+		"\\usepackage{fix-cm}\n"
+		"\\usepackage{CJKutf8}\n"
+		"\\usepackage[landscape,pdftex,a4paper]{geometry}\n"
+		"%\\usepackage{garamond}\n"
+		"\\newenvironment{TChinese}{%\n"
+		"  \\CJKfamily{bsmi}%\n"
+		"  \\CJKtilde\n"
+		"  \\CJKnospace}{}\n"
+		"%\\usepackage[encapsulated]{CJK}\n"
+		"%\\usepackage{ucs}\n"
+		"%\\usepackage[utf8x]{inputenc}\n"
+		"\\newcommand{\\cjktext}[1]{\\begin{CJK}{UTF8}{bsmi}#1\\end{CJK}}\n"
+		"%\\usepackage{mathpazo}\n"
+			// colour definition
+		"\\definecolor{Red}{rgb}{1.0,0.0,0.0}\n"
+		"\\definecolor{Green}{rgb}{0.0,0.7,0.0}\n"
+		"\n"
+		"\\newcommand{\\holcol}{\\color{Red}}\n"
+		"\\newcommand{\\satcol}{\\color{Green}}\n"
+		"\n"
+			// lengths related
+		"\\hbadness 20000\n"
+		"\\hfuzz=1000pt\n"
+		"\\vbadness 20000\n"
+		"\\lineskip 0pt\n"
+		"\\marginparwidth 0pt\n"
+		"\\oddsidemargin  -1cm\n"
+		"\\evensidemargin -1cm\n"
+		"\\marginparsep   0pt\n"
+		"\\topmargin      0pt\n"
+		"\\textwidth      7.5in\n"
+		"\\textheight     9.5in\n"
+		"\\newlength{\\cellwidth}\n"
+		"\\newlength{\\cellheight}\n"
+		"\\newlength{\\boxwidth}\n"
+		"\\newlength{\\boxheight}\n"
+		"\\newlength{\\cellsize}\n"
+		"\\newcommand{\\myday}[1]{}\n"
+		"\\newcommand{\\caldate}[6]{}\n"
+		"\\newcommand{\\nocaldate}[6]{}\n"
+		"\\newcommand{\\calsmall}[6]{}\n"
+			// paper format
+		"%\n"
+		"\\special{landscape}{}% \n"
+		"\\textwidth 9.5in{}% \n"
+		"\\textheight 7in{}% \n"
+		"%\n"
+			// caldate, our building block
+		"\\def\\holidaymult{.08}{}% \n"
+		"\\fboxsep=0pt\n"
+		"\\long\\def\\caldate#1#2#3#4#5#6{%\n"
+		"    \\fbox{\\hbox to\\cellwidth{%\n"
+		"     \\vbox to\\cellheight{%\n"
+		"       \\hbox to\\cellwidth{%\n"
+		"          {\\hspace*{1mm}\\Large \\bf \\strut #2}\\hspace{.05\\cellwidth}%\n"
+		"          \\raisebox{\\holidaymult\\cellheight}%\n"
+		"                   {\\parbox[t]{.75\\cellwidth}{\\tiny \\raggedright %#4\n"
+		"}}}\n"
+		"       \\hbox to\\cellwidth{%\n"
+		"           \\hspace*{1mm}\\parbox[t]{.95\\cellwidth}{\\vspace*{-2ex}\\scriptsize \\raggedright {\\cjktext{#3}%\n"
+		"}}}\n"
+		"       \\hspace*{1mm}%\n"
+		"       \\hbox to\\cellwidth{#6\n"
+		"}%\n"
+		"       \\vfill%\n"
+		"       \\hbox to\\cellwidth{\\hfill \\tiny #5 \\hfill\n"
+		"}%\n"
+		"       \\vskip 1.4pt}%\n"
+		"     \\hskip -0.4pt}}}\n"
+		"{}%\n"
+			// special for saturdays and holidays
+		"\\newcommand{\\calpubd}[6]{\\caldate{#1}{\\holcol #2}{\\holcol #3}{#4}{#5}{#6}}%\n"
+		"\\newcommand{\\calsatd}[6]{\\caldate{#1}{\\satcol #2}{\\satcol #3}{#4}{#5}{#6}}%\n"
+			// myday, the heading row
+		"\\renewcommand{\\myday}[1]%\n"
+		"{\\makebox[\\cellwidth]{\\hfill\\large\\bf#1\\hfill}}\n"
+		"%\n"
+		"{}%\n"
+		"%\n"
+		"%%%%% Define months tabular here\n";
+
+	/**
+	 * @brief TeX preamble from begin document, the same every year
+	 */
+	const char TEX_PREAMBLE_TAIL[]=
+		"\\begin{document}{}%\n"
+		"%\n"
+		"\\pagestyle{empty}{}%\n"
+		"\\setlength{\\cellwidth}{24cm}%\n"
+		"\\setlength{\\cellwidth}{0.157143\\cellwidth}\n"
+		"\\setlength{\\cellheight}{18cm}%\n"
+		"\\setlength{\\cellheight}{0.20000\\cellheight}\n"
+		"\\ \\par{}%\n"
+		"\\vspace*{-3cm}%\n"
+		"\\def\\calmonth#1#2%\n"
+		"{\\begin{center}%\n"
+		"%\\Huge\\bf\\uppercase{#1} #2 \\\\[1cm]%\n"
+		"\\hspace*{1in}\\Huge{\\fontfamily{pzc}{\\slshape \\bfseries \\uppercase{#1}}}\\quad{\\fontfamily{cmfib}#2} \\\\[1cm]%\n"
+		"\\end{center}}%\n"
+		"\\vspace*{-1.5cm}%\n"
+		"%\n"
+		"{}%\n"
+		"%\n";
+
+	/**
+	 * @brief a table of C strings with their lengths
+	 */
+	class FragmentTable {
+	  public:
+		/**
+		 * @brief constructor
+		 * @param s table of NUL terminated strings
+		 */
+		template <std::size_t N>
+		FragmentTable(char const* const (&s)[N]) : _fragment(N) {
+			for (std::size_t i=0; i<N; i++) {
+				_fragment[i].text=s[i];
+				_fragment[i].size=std::strlen(s[i]);
+			}
+		}
+		/**
+		 * @brief get a string of the table
+		 * @param i index into the table
+		 * @return string i with its length
+		 */
+		TexFragment const& operator[](std::size_t i) const {
+			return _fragment[i];
+		}
+	  private:
+		std::vector<TexFragment> _fragment;
+		///< the strings with their lengths
+	};
+
+	const std::size_t SMALL_MONTH_CACHE_SIZE=4096;
+	///< small month tables kept, about 1kB each
+
+	/**
+	 * @brief small month tables already rendered
+	 *
+	 * Keyed by the CalendarData version and the month, so the last
+	 * December of one year is the December of the year before, and a
+	 * change of holidays gives new keys.  Cleared when full.
+	 */
+	class SmallMonthCache {
+	  public:
+		/**
+		 * @brief look up a table
+		 * @param version CalendarData::getVersion() of the holidays
+		 * @param year Gregorian year
+		 * @param month 1=January, ..., 12=December
+		 * @return the table, null if not rendered yet
+		 */
+		std::shared_ptr<const std::string>
+		find(unsigned long version, unsigned int year, unsigned int month) {
+			std::lock_guard<std::mutex> lock(_lock);
+			std::map<Key,std::shared_ptr<const std::string> >::const_iterator
+				i=_table.find(Key(version,year*16+month));
+			if (i==_table.end()) return std::shared_ptr<const std::string>();
+			return i->second;
+		}
+		/**
+		 * @brief keep a table
+		 * @param version CalendarData::getVersion() of the holidays
+		 * @param year Gregorian year
+		 * @param month 1=January, ..., 12=December
+		 * @param tex the table
+		 */
+		void
+		insert(unsigned long version, unsigned int year, unsigned int month,
+			   std::shared_ptr<const std::string> const& tex) {
+			std::lock_guard<std::mutex> lock(_lock);
+			if (_table.size()>=SMALL_MONTH_CACHE_SIZE) _table.clear();
+			_table[Key(version,year*16+month)]=tex;
+		}
+	  private:
+		typedef std::pair<unsigned long,unsigned int> Key;
+		///< version, year*16+month
+		std::mutex _lock;
+		///< guards _table
+		std::map<Key,std::shared_ptr<const std::string> > _table;
+		///< the tables
+	};
+
+	/**
+	 * @brief the small month tables of every calendar
+	 *
+	 * This function takes no argument.
+	 *
+	 * @return reference to the single SmallMonthCache
+	 */
+	SmallMonthCache&
+	smallMonthCache()
+	{
+		static SmallMonthCache s;
+		return s;
+	}
+
+	const char TEX_FORMAT_VERSION[]="calendar month page 2";
+	///< part of every FragmentKey, change when writeTexMonth() changes
+
+	const unsigned int YEAR_PARTS=14+12;
+	///< small month cells 0..13, then month pages 1..12
+
+	/**
+	 * @brief the pieces of one year rendered by a ThreadPool
+	 *
+	 * Parts are handed out by an atomic counter to whichever thread asks
+	 * first, the pool workers or the thread waiting for the year, so the
+	 * year is finished even if every worker is busy.
+	 */
+	struct YearParts {
+		Calendar const* calendar;
+		///< calendar rendered
+		std::string part[YEAR_PARTS];
+		///< rendered small month cells, then month pages
+		std::atomic<unsigned int> next;
+		///< first part not yet handed out
+		std::mutex lock;
+		///< guards done and error
+		std::condition_variable finished;
+		///< signalled when the last part is done
+		unsigned int done;
+		///< parts done
+		std::exception_ptr error;
+		///< first exception thrown by a part
+		YearParts(Calendar const* c) : calendar(c), next(0), done(0) {}
+	};
+
+	/**
+	 * @brief render the next part of a year not yet handed out
+	 *
+	 * @param job year being rendered
+	 *
+	 * @retval true if a part was rendered
+	 * @retval false if every part has been handed out
+	 */
+	bool
+	renderPart(YearParts& job)
+	{
+		unsigned int i=job.next++;
+		if (i>=YEAR_PARTS) return false;
+		std::exception_ptr error;
+		try {
+			StringSink sink(job.part[i]);
+			if (i<14) {
+				job.calendar->writeTexMonthSmall(sink,i);
+				sink.write("\n",1);
+			}
+			else {
+				job.calendar->writeTexMonth(sink,i-13);
+			}
+		}
+		catch (...) {
+			error=std::current_exception();
+		}
+		std::lock_guard<std::mutex> lock(job.lock);
+		if (error && !job.error) job.error=error;
+		if (++job.done==YEAR_PARTS) job.finished.notify_all();
+		return true;
+	}
+
+	/**
+	 * @brief free the rendered text of a finished year
+	 *
+	 * Every part must be done.
+	 *
+	 * @param job year rendered
+	 */
+	void
+	releaseParts(YearParts& job)
+	{
+		for (unsigned int i=0; i<YEAR_PARTS; i++) {
+			std::string().swap(job.part[i]);
+		}
+	}
+}
 
 // dynamic initialisation
 /**
@@ -88,10 +389,7 @@ Calendar::forcedInitialise()
 	MY_ERR << this << "->Calendar::forcedInitialised() called."
 		   << std::endl;
 #endif
-	std::ifstream isolar("solar.dat");
-	std::ifstream ipubhol("pubhol.dat");
-
-	setList(isolar,ipubhol);
+	if (!_data) _data=CalendarData::getDefault();
 
 	if(updateList()) return true;
 
@@ -133,7 +431,34 @@ Calendar::setList(std::ifstream& solar, std::ifstream& holiday)
 }
 
 /**
- * @brief Update the hashes of solar terms/chinese date/public holiday
+ * @brief set the solar terms and holidays from a compiled data file
+ *
+ * This method will call the updateList() method to update the hash.
+ *
+ * @param data an open compiled calendar data file
+ *
+ * @return true if initialisation is successful.
+ */
+bool
+Calendar::setList(CalendarFile const& data)
+{
+#ifdef DEBUG
+	MY_ERR << this << "->Calendar::setList((CalendarFile*)" << &data
+		   << ") called." << std::endl;
+#endif
+	initialised=false;
+
+	std::shared_ptr<CalendarData> d=std::make_shared<CalendarData>();
+	d->setList(data);
+	_data=d;
+
+	if(updateList()) initialised=true;
+
+	return true;
+}
+
+/**
+ * @brief Update the notes of solar terms/chinese date/public holiday
  *
  * This method takes no argument.
  *
@@ -146,13 +471,55 @@ Calendar::updateList()
 	MY_ERR << this << "->Calendar::updateList() called."
 		   << std::endl;
 #endif
-	// maybe split to generate
-	generateChineseSolar();
-	generateSolarPublicHoliday();
-	// if split merge back
+	generateDayNotes();
+	return true;
+}
+
+/**
+ * @brief switch to the latest default data
+ *
+ * Picks up data published by CalendarData::publish(), e.g. by a
+ * CalendarWatcher, and rebuilds the hashes.  Calendars are not shared
+ * between threads, so the owner calls this when convenient, e.g. before
+ * rendering.
+ *
+ * This method takes no argument.
+ *
+ * @retval true if the data changed
+ * @retval false if this calendar already had the latest default data
+ */
+bool
+Calendar::refresh()
+{
+#ifdef DEBUG
+	MY_ERR << this << "->Calendar::refresh() called." << std::endl;
+#endif
+	std::shared_ptr<const CalendarData> d=CalendarData::getDefault();
+	if (d==_data) return false;
+	_data=d;
+	updateList();
 	return true;
 }
 
+/**
+ * @brief keep rendered month pages in a cache directory
+ *
+ * writeTexMonth() then serves a page from the cache when none of its
+ * inputs changed, even in another run of the program.
+ *
+ * @param cache cache to use, may be shared between calendars and threads;
+ * null for none
+ */
+void
+Calendar::setFragmentCache(std::shared_ptr<FragmentCache> const& cache)
+{
+#ifdef DEBUG
+	MY_ERR << this << "->Calendar::setFragmentCache((FragmentCache*)"
+		   << cache.get() << ") called." << std::endl;
+#endif
+	_cache=cache;
+}
+
 /**
  * @brief check if a date is on the public holiday list
  *
@@ -169,7 +536,7 @@ Calendar::isPublicHoliday(Date const& d) const
 		   << d.getMonth() << "," << d.getDay() << ")) called."
 		   << std::endl;
 #endif
-	return (_nPublicHoliday.count(d));
+	return _data->isPublicHoliday(d);
 }
 
 /**
@@ -188,111 +555,227 @@ Calendar::isSolar(Date const& d) const
 		   << d.getMonth() << "," << d.getDay() << ")) called."
 		   << std::endl;
 #endif
-	return (_nSolar.count(d));
+	return _data->isSolar(d);
 }
 
 /**
- * @brief populate the Chinese-SolarTerm hash
+ * @brief work out what every day of the year shows
  *
  * This function takes no argument
  *
  * This function has no return value
  */
 void
-Calendar::generateChineseSolar()
+Calendar::generateDayNotes()
 {
 #ifdef DEBUG
-	MY_ERR << this << "->Calendar::generateChineseSolar() called."
-		   << std::endl;
-#endif
-		//first clear everything
-	if ( ! _nChineseSolar.empty() ) {
-#ifdef DEBUG
-	MY_ERR << "\t_nChineseSolar not empty, cleaning."
-		   << std::endl;
-#endif
-		_nChineseSolar.clear();
-	}
-	else {
-#ifdef DEBUG
-	MY_ERR << "\t_nChineseSolar is empty.  Proceed."
+	MY_ERR << this << "->Calendar::generateDayNotes() called."
 		   << std::endl;
 #endif
-	}
 	Date dStart(_year,1,1);
 	Date dEnd(_year+1,1,1);
 	for (Date d=dStart; d<dEnd; d++) {
+		noteDay(d);
+	}
+}
+
+/**
+ * @brief work out what a day of the year shows
+ *
+ * The cell shows the solar term name, else the Chinese month and day on
+ * the first of a Gregorian month, else the Chinese month on the first of a
+ * Chinese month, else the Chinese day; and the solar term time and the
+ * holiday description, if any.  Only the indices into the name tables are
+ * kept; the text is put together by appendChineseSolar() and
+ * appendSolarPublicHoliday().
+ *
+ * @param d a date of _year
+ */
+void
+Calendar::noteDay(Date const& d)
+{
+	DateFields const f=d.decode();
 #ifdef DEBUG
-		MY_ERR << "\t Testing " << d.getYear() << "-" << d.getMonth() << "-"
-			   << d.getDay() << " for Chinese/Solar."
-			   << std::endl;
-#endif
-		std::string res;
-		if (isSolar(d)) {
-#ifdef DEBUG
-		MY_ERR << "\t\t Date is Solar, add solar name "
-			   << std::endl;
-#endif
-			res = getSolarName(d);
-		}
-		else if (d.getDay()==1) {
-#ifdef DEBUG
-		MY_ERR << "\t\t Date is first day of Gregorian Month, add both chinese month and day "
-			   << std::endl;
+	MY_ERR << "\t Testing " << f.gregorianYear << "-" << f.gregorianMonth
+		   << "-" << f.gregorianDay << " for Chinese/Solar."
+		   << std::endl;
 #endif
-			res = _nChineseMonthName[d.getChineseMonth()];
-			res+= _nChineseDayName[d.getChineseDay()];
-		}
-		else if (d.getChineseDay()==1) {
+	unsigned int const i=f.dayOfYear-1;
+	unsigned char flag=0;
+	if (isSolar(d)) flag|=DAY_SOLAR;
+	if (isPublicHoliday(d)) flag|=DAY_HOLIDAY;
+	if (f.gregorianDay==1) flag|=DAY_CHINESE_MONTH | DAY_CHINESE_DAY;
+	else if (f.chineseDay==1) flag|=DAY_CHINESE_MONTH;
+	else flag|=DAY_CHINESE_DAY;
+	_nDayFlag[i]=flag;
+	_nChineseMonth[i]=f.chineseMonth;
+	_nChineseDay[i]=f.chineseDay;
+}
+
+/**
+ * @brief append the Chinese date or solar term text of a day
+ *
+ * @param out buffer appended to
+ * @param d a date of _year
+ * @param i day of year of d, 0 for 1 January
+ */
+void
+Calendar::appendChineseSolar(TexBuffer& out, Date const& d,
+							 unsigned int i) const
+{
+	static FragmentTable const solarTermName(_nSolarTermName);
+	static FragmentTable const chineseMonthName(_nChineseMonthName);
+	static FragmentTable const chineseDayName(_nChineseDayName);
+	unsigned char const flag=_nDayFlag[i];
+	if (flag & DAY_SOLAR) {
+		out << solarTermName[_data->getSolarTermIndex(d)];
+		return;
+	}
+	if (flag & DAY_CHINESE_MONTH) out << chineseMonthName[_nChineseMonth[i]];
+	if (flag & DAY_CHINESE_DAY) out << chineseDayName[_nChineseDay[i]];
+}
+
+/**
+ * @brief append the solar term time and holiday description of a day
+ *
+ * @param out buffer appended to
+ * @param d a date of _year
+ * @param i day of year of d, 0 for 1 January
+ */
+void
+Calendar::appendSolarPublicHoliday(TexBuffer& out, Date const& d,
+								   unsigned int i) const
+{
+	unsigned char const flag=_nDayFlag[i];
+		// solar term first
+	if (flag & DAY_SOLAR) {
+		unsigned int const minute=_data->getSolarInstant(d).getMinuteOfDay();
+		out << char('0'+minute/600) << char('0'+minute/60%10) << ':'
+			<< char('0'+minute%60/10) << char('0'+minute%10);
+		if (flag & DAY_HOLIDAY) out << LATEX_NEWLINE;
+	}
+	if (flag & DAY_HOLIDAY) {
+		out << LATEX_CJK_BEGIN << getPublicHolidayName(d) << LATEX_CJK_END;
+	}
+}
+
+/**
+ * @brief data of this calendar, made private to it for changing
+ *
+ * Copies the data unless this calendar is its only holder, so calendars
+ * sharing it and the published default are never changed.
+ *
+ * This method takes no argument.
+ *
+ * @return data that may be changed
+ */
+CalendarData&
+Calendar::ownData()
+{
+	if (_data.use_count()!=1) {
+		_data=std::make_shared<CalendarData>(*_data);
+	}
+	// created non-const above or by a previous call
+	return const_cast<CalendarData&>(*_data);
+}
+
+/**
+ * @brief bring the notes of one date up to date
+ *
+ * @param d a date whose solar term or holiday changed
+ *
+ * @return dirty month mask of d, see addPublicHoliday()
+ */
+unsigned int
+Calendar::patchDay(Date const& d)
+{
+	int const year=d.getYear();
+	unsigned int const month=d.getMonth();
+	if (year==(int)_year) {
+		noteDay(d);
+		return 1u<<month;
+	}
+	if ((year==(int)_year-1) && (month==12)) return 1u<<0;
+	if ((year==(int)_year+1) && (month==1)) return 1u<<13;
+	return 0;
+}
+
+/**
+ * @brief add or rename a public holiday of this calendar
+ *
+ * Only this calendar sees the change.  Only the hash entries of d are
+ * rebuilt.
+ *
+ * @param d date of holiday
+ * @param name description of holiday
+ *
+ * @return dirty month mask: bit m is set if month m must be redrawn, with
+ * m numbered as in getTexMonthSmall(), 0=last December, 1..12, 13=next
+ * January.  A month is drawn both by getTexMonth() and, as small month,
+ * in getTexPreamble().
+ */
+unsigned int
+Calendar::addPublicHoliday(Date const& d, std::string const& name)
+{
 #ifdef DEBUG
-		MY_ERR << "\t\t Date is first day of Chinese Month, just add chinese momonth "
-			   << std::endl;
+	MY_ERR << this << "->Calendar::addPublicHoliday(Date(" << d.getYear()
+		   << "," << d.getMonth() << "," << d.getDay() << ")," << name
+		   << ") called." << std::endl;
 #endif
-			res = _nChineseMonthName[d.getChineseMonth()];
-		}
-		else {
+	if (isPublicHoliday(d) &&
+		(_data->getPublicHolidayLabel(d)==InternedString(name))) return 0;
+	ownData().addPublicHoliday(d,name);
+	return patchDay(d);
+}
+
+/**
+ * @brief remove a public holiday from this calendar
+ *
+ * Only this calendar sees the change.  Only the hash entries of d are
+ * rebuilt.
+ *
+ * @param d date of holiday
+ *
+ * @return dirty month mask as for addPublicHoliday(), 0 if d was not a
+ * holiday
+ */
+unsigned int
+Calendar::removePublicHoliday(Date const& d)
+{
 #ifdef DEBUG
-		MY_ERR << "\t\t Date is neither, just add chinese day "
-			   << std::endl;
+	MY_ERR << this << "->Calendar::removePublicHoliday(Date(" << d.getYear()
+		   << "," << d.getMonth() << "," << d.getDay() << ")) called."
+		   << std::endl;
 #endif
-			res = _nChineseDayName[d.getChineseDay()];
-		}
-		_nChineseSolar[d]=res;
-	}
+	if (!isPublicHoliday(d)) return 0;
+	ownData().removePublicHoliday(d);
+	return patchDay(d);
 }
 
 /**
- * @brief populate the SolarTerm-Holiday hash
+ * @brief add or move the time of a solar term of this calendar
  *
- * This function takes no argument
+ * Only this calendar sees the change.  Only the hash entries of d are
+ * rebuilt.  The name of the term follows from the date.
  *
- * This function has no return value
+ * @param d date of solar term
+ * @param hour hour of solar term, 0..23
+ * @param minute minute of solar term, 0..59
+ *
+ * @return dirty month mask as for addPublicHoliday()
  */
-void
-Calendar::generateSolarPublicHoliday()
+unsigned int
+Calendar::setSolarTerm(Date const& d, unsigned int hour, unsigned int minute)
 {
 #ifdef DEBUG
-	MY_ERR << this << "->Calendar::generateSolarPublicHoliday() called."
-		   << std::endl;
+	MY_ERR << this << "->Calendar::setSolarTerm(Date(" << d.getYear()
+		   << "," << d.getMonth() << "," << d.getDay() << ")," << hour
+		   << "," << minute << ") called." << std::endl;
 #endif
-		//first clear everything
-	if ( ! _nSolarPublicHoliday.empty() ) _nSolarPublicHoliday.clear();
-	for (Date d(_year,1,1); d<Date(_year+1,1,1); d++) {
-		std::string res;
-		bool s=isSolar(d), p=isPublicHoliday(d);
-			// solar term first
-		if (s) {
-			res = getSolarTime(d);
-			if (p) {
-				res += LATEX_NEWLINE + LATEX_CJK_BEGIN +
-					getPublicHolidayName(d) + LATEX_CJK_END;
-			}
-		}
-		else if (p) {
-			res = LATEX_CJK_BEGIN + getPublicHolidayName(d) + LATEX_CJK_END;
-		}
-		if (s || p) _nSolarPublicHoliday[d]=res;
-	}
+	if (hour>=24) throw INVALID_PARAM(hour);
+	if (minute>=60) throw INVALID_PARAM(minute);
+	ownData().setSolarTerm(d,hour*60+minute);
+	return patchDay(d);
 }
 
 /**
@@ -302,9 +785,9 @@ Calendar::generateSolarPublicHoliday()
  *
  * @param d a date that should be solar term
  *
- * @return constant string of solar term time
+ * @return solar term time as "hh:mm"
  */
-std::string const&
+std::string
 Calendar::getSolarTime(Date const& d) const
 {
 #ifdef DEBUG
@@ -312,11 +795,7 @@ Calendar::getSolarTime(Date const& d) const
 		   << "," << d.getMonth() << "," << d.getDay() << ")) called."
 		   << std::endl;
 #endif
-	std::map<Date,std::string>::const_iterator i=_nSolar.find(d);
-	if(i == _nSolar.end()){
-		throw Exception("Invalid Parameter d --- is not a solar term date");
-	}
-	return (i->second);
+	return _data->getSolarTime(d);
 }
 
 /**
@@ -336,11 +815,7 @@ Calendar::getPublicHolidayName(Date const& d) const
 		   << "," << d.getMonth() << "," << d.getDay() << ")) called."
 		   << std::endl;
 #endif
-	std::map<Date,std::string>::const_iterator i=_nPublicHoliday.find(d);
-	if(i == _nPublicHoliday.end() ) {
-		throw Exception("Invalid Parameter d --- is not a public holiday");
-	}
-	return (i->second);
+	return _data->getPublicHolidayName(d);
 }
 
 
@@ -364,17 +839,20 @@ Calendar::getSolarName(Date const& d) const
 	if(!isSolar(d)){
 		throw Exception("Invalid parameter d --- is not a solar term date");
 	}
-	return _nSolarTermName[2*(d.getMonth()-1)+(d.getDay()>>4)];
+	return _nSolarTermName[_data->getSolarTermIndex(d)];
 }
 
 /**
  * @brief set the solar hash according to file
  *
+ * Only this calendar sees the new solar terms; the shared data is left
+ * alone.  Bad lines are reported on std::cerr and skipped.
+ *
  * @param[in] file plain text in file stream, format in CSV, per line:
  * year,month,day,hour,minute
  *
  * @retval true if successfully set
- * @retval false should never happen
+ * @retval false if some lines were bad
  */
 bool
 Calendar::setSolar(std::ifstream& file)
@@ -383,46 +861,30 @@ Calendar::setSolar(std::ifstream& file)
 	MY_ERR << this << "->Calendar::setSolar((ifstream*)" << &file
 		   << ")) called." << std::endl;
 #endif
-	unsigned int year,month,day,hour,minute;
-	char comma;
-	
-	_nSolar.clear();
-	std::string s;
-	while (file >> s) {
-#ifdef DEBUG
-		MY_ERR << "\tCalendar::setSolar(): read line" << std::endl
-			   << "\t\t" << s << std::endl << "\tfrom (ifstream*)" << &file
-			   << std::endl;
-#endif
+	SolarList solar;
+	unsigned long bad=readSolarCSV(file,solar);
 
-		std::istringstream ist (s);
-		ist >> year >> comma
-			>> month >> comma
-			>> day >> comma
-			>> hour >> comma
-			>> minute;
-		std::ostringstream ost;
-		ost << std::setw(2) << std::setfill('0') << hour << ":"
-			<< std::setw(2) << std::setfill('0') << minute;
-#ifdef DEBUG
-		MY_ERR << "\t adding _nSolar[Date(" << year << "," << month << ","
-			   << day << ")]=" << '"' << ost.str() << '"'
-			   << std::endl;
-#endif
-		_nSolar[Date(year,month,day)]=ost.str();
-	}
+	// the shared data is never changed, replace it by a modified copy
+	std::shared_ptr<CalendarData> d=_data ?
+		std::make_shared<CalendarData>(*_data) :
+		std::make_shared<CalendarData>();
+	d->setSolar(solar);
+	_data=d;
 
-	return true;
+	return bad==0;
 }
 
 /**
  * @brief set the holiday hash according to file
  *
+ * Only this calendar sees the new holidays; the shared data is left
+ * alone.  Bad lines are reported on std::cerr and skipped.
+ *
  * @param[in] file plain text in file stream, format in CSV, per line:
  * year,month,day,description
  *
  * @retval true if successfully set
- * @retval false should never happen
+ * @retval false if some lines were bad
  */
 bool
 Calendar::setPublicHoliday(std::ifstream& file)
@@ -431,27 +893,14 @@ Calendar::setPublicHoliday(std::ifstream& file)
 	MY_ERR << this << "->Calendar::setPublicHoliday((ifstream*)" << &file
 		   << ")) called." << std::endl;
 #endif
-	unsigned int year,month,day;
-	char comma;
-	std::string desc;
-
-	_nPublicHoliday.clear();
-	std::string s;
-	while (file >> s) {
-		std::istringstream ist (s);
-		ist >> year >> comma
-			>> month >> comma
-			>> day >> comma
-			>> desc;
-#ifdef DEBUG
-		MY_ERR << "\t adding _nPublicHoliday[Date(" << year << "," << month
-			   << "," << day << ")]=" << '"' << desc << '"'
-			   << std::endl;
-#endif
-		_nPublicHoliday[Date(year,month,day)]=desc;
-	}
-
-	return true;
+	// the shared data is never changed, replace it by a modified copy
+	std::shared_ptr<CalendarData> d=_data ?
+		std::make_shared<CalendarData>(*_data) :
+		std::make_shared<CalendarData>();
+	unsigned long bad=d->readPublicHoliday(file);
+	_data=d;
+
+	return bad==0;
 }
 
 
@@ -462,41 +911,45 @@ Calendar::setPublicHoliday(std::ifstream& file)
  *
  * @return TeX formatting code string for an empty calendar cell
  */
-std::string&
+std::string const&
 Calendar::emptyCellTex() const
 {
 #ifdef DEBUG
 	MY_ERR << this << "->Calendar::emptyCellTex() called" << std::endl;
 #endif
-	static std::string res=std::string(_nCellType[0])+"{}{}{}{}{}{}%";
+	static std::string const res=std::string(_nCellType[0])+"{}{}{}{}{}{}%";
 	return res;
 }
 
 /**
- * @brief get an day cell TeX code.
+ * @brief append a day cell TeX code
  *
- * @param d date of the day cell
+ * Formats straight into the buffer, without allocating once the buffer has
+ * grown.
  *
- * @return string object containing TeX formatting code for the day-cell,
- * which looks like
+ * @param out buffer the TeX formatting code for the day-cell is appended
+ * to, which looks like
  *    \verbatim\caldate{January}{4}{十一}{}{4/362}{}%\endverbatim
  * for a normal day
  *    \verbatim\calpubd{January}{1}{十二月初八}{\cjktext{元旦}}{1/365}{}%\endverbatim
  * for public holiday
  *    \verbatim\calsatd{January}{21}{大寒}{00:09}{21/345}{}%\endverbatim
  * for other saturdays
+ * @param d date of the day cell
  */
-std::string
-Calendar::dayCellTex(Date const& d) const
+void
+Calendar::appendDayCell(TexBuffer& out, Date const& d) const
 {
 #ifdef DEBUG
-	MY_ERR << this << "->Calendar::dayCellTex(Date(" << d.getYear() << ","
+	MY_ERR << this << "->Calendar::appendDayCell(Date(" << d.getYear() << ","
 		   << d.getMonth() << "," << d.getDay() << ")) called"
 		   << std::endl;
 #endif
-	std::ostringstream out;
+	static FragmentTable const cellType(_nCellType);
+	static FragmentTable const longName(_nGregorianLongName);
+	DateFields const f=d.decode();
 	int index=0;
-	switch(d.getDayOfWeek()){
+	switch(f.dayOfWeek){
 		case Date::DOW_SATURDAY:
 			index=1;
 			break;
@@ -507,216 +960,91 @@ Calendar::dayCellTex(Date const& d) const
 			;
 	}
 	if (isPublicHoliday(d)) index=2;
-	out << _nCellType[index];
-	out << "{" << _nGregorianLongName[d.getMonth()] << "}"; // #1
-#ifdef DEBUG
-	MY_ERR << "\tCalendar::dayCellTex(): argument #1 generated without errors."
-		   << std::endl;
-#endif
-	out << "{" << d.getDay() << "}";						// #2
-#ifdef DEBUG
-	MY_ERR << "\tCalendar::dayCellTex(): argument #2 generated without errors."
-		   << std::endl;
-#endif
-	out << "{" << _nChineseSolar.find(d)->second << "}";					// #3
-#ifdef DEBUG
-	MY_ERR << "\tCalendar::dayCellTex(): argument #3 generated without errors."
-		   << std::endl;
-#endif
-	out << "{";
-	std::map<Date,std::string>::const_iterator i=_nSolarPublicHoliday.find(d);
-	if ( i != _nSolarPublicHoliday.end()) {
-		out << i->second;
-	}
-	out << "}"; // #4
-#ifdef DEBUG
-	MY_ERR << "\tCalendar::dayCellTex(): argument #4 generated without errors."
-		   << std::endl;
-#endif
-	out << "{";					// #5
-	int dd=d.getDayOfYear();
-	out << dd << "/" << (d.isLeap()?366:365)-dd << "}";
-#ifdef DEBUG
-	MY_ERR << "\tCalendar::dayCellTex(): argument #5 generated without errors."
-		   << std::endl;
-#endif
-	out << "{}%";				// #6
-#ifdef DEBUG
-	MY_ERR << "\tCalendar::dayCellTex(): argument #6 generated without errors."
-		   << std::endl;
-#endif
-
-	return out.str();
+	out << cellType[index];
+	out << '{' << longName[f.gregorianMonth] << '}';	// #1
+	out << '{' << f.gregorianDay << '}';				// #2
+	out << '{';											// #3
+	appendChineseSolar(out,d,f.dayOfYear-1);
+	out << '}';
+	out << '{';											// #4
+	appendSolarPublicHoliday(out,d,f.dayOfYear-1);
+	out << '}';
+	unsigned int dd=f.dayOfYear;
+	out << '{' << dd << '/'								// #5
+		<< (isLeapYear(f.gregorianYear)?366u:365u)-dd << '}';
+	out << "{}%";										// #6
 }
 
 
 
 
 /**
- * @brief get TeX preamble, begin document, until when the first month starts
+ * @brief write TeX preamble, begin document, until when the first month
+ * starts
  *
- * This function takes no argument.
+ * Only the 14 small month cells depend on the year; the text around them
+ * is constant.
  *
- * @return string object containing TeX formatting code
+ * @param sink where the TeX formatting code is written
  */
-std::string const&
-Calendar::getTexPreamble() const
+void
+Calendar::writeTexPreamble(TexSink& sink) const
 {
 #ifdef DEBUG
-	MY_ERR << this << "Calendar::getTexPreamble() called."
+	MY_ERR << this << "->Calendar::writeTexPreamble() called."
 		   << std::endl;
 #endif
-	static std::string preamble;
-	std::ostringstream out;
-
-		//usual preamble stuff
-	out << "\\documentclass[12pt]{article}" << std::endl
-		<< "\\usepackage{color}" << std::endl
-		<< "\\usepackage[math]{iwona}" << std::endl
-		<< "\\usepackage{fix-cm}" << std::endl
-		<< "\\usepackage{CJKutf8}" << std::endl
-		<< "\\usepackage[landscape,pdftex,a4paper]{geometry}" << std::endl
-		<< "%\\usepackage{garamond}" << std::endl
-		<< "\\newenvironment{TChinese}{%" << std::endl
-		<< "  \\CJKfamily{bsmi}%" << std::endl
-		<< "  \\CJKtilde" << std::endl
-		<< "  \\CJKnospace}{}" << std::endl
-		<< "%\\usepackage[encapsulated]{CJK}" << std::endl
-		<< "%\\usepackage{ucs}" << std::endl
-		<< "%\\usepackage[utf8x]{inputenc}" << std::endl
-		<< "\\newcommand{\\cjktext}[1]{\\begin{CJK}{UTF8}{bsmi}#1\\end{CJK}}" << std::endl
-		<< "%\\usepackage{mathpazo}" << std::endl;
-		// colour definition
-	out << "\\definecolor{Red}{rgb}{1.0,0.0,0.0}" << std::endl
-		<< "\\definecolor{Green}{rgb}{0.0,0.7,0.0}" << std::endl
-		<< std::endl
-		<< "\\newcommand{\\holcol}{\\color{Red}}" << std::endl
-		<< "\\newcommand{\\satcol}{\\color{Green}}" << std::endl;
-	out << std::endl;
-
-		// lengths related
-	out << "\\hbadness 20000" << std::endl
-		<< "\\hfuzz=1000pt" << std::endl
-		<< "\\vbadness 20000" << std::endl
-		<< "\\lineskip 0pt" << std::endl
-		<< "\\marginparwidth 0pt" << std::endl
-		<< "\\oddsidemargin  -1cm" << std::endl
-		<< "\\evensidemargin -1cm" << std::endl
-		<< "\\marginparsep   0pt" << std::endl
-		<< "\\topmargin      0pt" << std::endl
-		<< "\\textwidth      7.5in" << std::endl
-		<< "\\textheight     9.5in" << std::endl
-		<< "\\newlength{\\cellwidth}" << std::endl
-		<< "\\newlength{\\cellheight}" << std::endl
-		<< "\\newlength{\\boxwidth}" << std::endl
-		<< "\\newlength{\\boxheight}" << std::endl
-		<< "\\newlength{\\cellsize}" << std::endl
-		<< "\\newcommand{\\myday}[1]{}" << std::endl
-		<< "\\newcommand{\\caldate}[6]{}" << std::endl
-		<< "\\newcommand{\\nocaldate}[6]{}" << std::endl
-		<< "\\newcommand{\\calsmall}[6]{}" << std::endl;
-
-		// paper format
-	out << "%" << std::endl
-		<< "\\special{landscape}{}% " << std::endl
-		<< "\\textwidth 9.5in{}% " << std::endl
-		<< "\\textheight 7in{}% " << std::endl
-		<< "%" << std::endl;
-
-		// caldate, our building block
-	out << "\\def\\holidaymult{.08}{}% " << std::endl
-		<< "\\fboxsep=0pt" << std::endl
-		<< "\\long\\def\\caldate#1#2#3#4#5#6{%" << std::endl
-		<< "    \\fbox{\\hbox to\\cellwidth{%" << std::endl
-		<< "     \\vbox to\\cellheight{%" << std::endl
-		<< "       \\hbox to\\cellwidth{%" << std::endl
-		<< "          {\\hspace*{1mm}\\Large \\bf \\strut #2}\\hspace{.05\\cellwidth}%" << std::endl
-		<< "          \\raisebox{\\holidaymult\\cellheight}%" << std::endl
-		<< "                   {\\parbox[t]{.75\\cellwidth}{\\tiny \\raggedright %#4" << std::endl
-		<< "}}}" << std::endl
-		<< "       \\hbox to\\cellwidth{%" << std::endl
-		<< "           \\hspace*{1mm}\\parbox[t]{.95\\cellwidth}{\\vspace*{-2ex}\\scriptsize \\raggedright {\\cjktext{#3}%" << std::endl
-		<< "}}}" << std::endl
-		<< "       \\hspace*{1mm}%" << std::endl
-		<< "       \\hbox to\\cellwidth{#6" << std::endl
-		<< "}%" << std::endl
-		<< "       \\vfill%" << std::endl
-		<< "       \\hbox to\\cellwidth{\\hfill \\tiny #5 \\hfill" << std::endl
-		<< "}%" << std::endl
-		<< "       \\vskip 1.4pt}%" << std::endl
-		<< "     \\hskip -0.4pt}}}" << std::endl
-		<< "{}%" << std::endl;
-
-		// special for saturdays and holidays
-	out << "\\newcommand{\\calpubd}[6]{\\caldate{#1}{\\holcol #2}{\\holcol #3}{#4}{#5}{#6}}%" << std::endl
-		<< "\\newcommand{\\calsatd}[6]{\\caldate{#1}{\\satcol #2}{\\satcol #3}{#4}{#5}{#6}}%" << std::endl;
-
-		// myday, the heading row
-	out << "\\renewcommand{\\myday}[1]%" << std::endl
-		<< "{\\makebox[\\cellwidth]{\\hfill\\large\\bf#1\\hfill}}" << std::endl
-		<< "%" << std::endl
-		<< "{}%" << std::endl
-		<< "%" << std::endl;
-
-	out << "%%%%% Define months tabular here" << std::endl;
+	sink.write(TEX_PREAMBLE_HEAD,sizeof(TEX_PREAMBLE_HEAD)-1);
 	for (unsigned int month=0; month<=13; month++){
-		out << getTexMonthSmall(month) << std::endl;
+		writeTexMonthSmall(sink,month);
+		sink.write("\n",1);
 	}
-
-	out << "\\begin{document}{}%" << std::endl
-		<< "%" << std::endl
-		<< "\\pagestyle{empty}{}%" << std::endl
-		<< "\\setlength{\\cellwidth}{24cm}%" << std::endl
-		<< "\\setlength{\\cellwidth}{0.157143\\cellwidth}" << std::endl
-		<< "\\setlength{\\cellheight}{18cm}%" << std::endl
-		<< "\\setlength{\\cellheight}{0.20000\\cellheight}" << std::endl
-		<< "\\ \\par{}%" << std::endl
-		<< "\\vspace*{-3cm}%" << std::endl
-		<< "\\def\\calmonth#1#2%" << std::endl
-		<< "{\\begin{center}%" << std::endl
-		<< "%\\Huge\\bf\\uppercase{#1} #2 \\\\[1cm]%" << std::endl
-		<< "\\hspace*{1in}\\Huge{\\fontfamily{pzc}{\\slshape \\bfseries \\uppercase{#1}}}\\quad{\\fontfamily{cmfib}#2} \\\\[1cm]%" << std::endl
-		<< "\\end{center}}%" << std::endl
-		<< "\\vspace*{-1.5cm}%" << std::endl
-		<< "%" << std::endl
-		<< "{}%" << std::endl
-		<< "%" << std::endl;
-
-	preamble=out.str();
-	return preamble;
+	sink.write(TEX_PREAMBLE_TAIL,sizeof(TEX_PREAMBLE_TAIL)-1);
 }
 
 /**
- * @brief get TeX code for the small month-to-view cell for last/next month
+ * @brief write TeX code for the small month-to-view cell for last/next month
  *
+ * @param sink where the TeX formatting code, such as
+ *         \verbatim\def\thisjan{...}\endverbatim, is written
  * @param month 0=last December, ..., 13=next January
- *
- * @return string object containing TeX formatting code such as
- *         \verbatim\def\thisjan{...}\endverbatim
  */
-std::string const&
-Calendar::getTexMonthSmall(unsigned int month) const
+void
+Calendar::writeTexMonthSmall(TexSink& sink, unsigned int month) const
 {
 #ifdef DEBUG
-	MY_ERR << this << "->Calendar::getTexMonthSmall() called."
+	MY_ERR << this << "->Calendar::writeTexMonthSmall() called."
 		   << std::endl;
 #endif
-	static std::string res;
 		// month 0=lastdec
 		// month 13=nextjan
 	if (month>13) {
 		throw INVALID_PARAM(month);
 	}
 
-	std::ostringstream out;
+	static FragmentTable const longName(_nGregorianLongName);
+	static FragmentTable const shortName(_nGregorianShortName);
 	unsigned int a_year=_year, a_month=month, a_day=1;
 	if (month==0) { a_year--; a_month=12; };
 	if (month==13) { a_year++; a_month=1; };
-	out << "\\def\\" << _nGregorianShortName[month];
+	sink.write("\\def\\",5);
+	sink.write(shortName[month].text,shortName[month].size);
+
+		// the table itself is the same for every calendar showing the month
+	unsigned long version=_data->getVersion();
+	std::shared_ptr<const std::string> table=
+		smallMonthCache().find(version,a_year,a_month);
+	if (table) {
+		sink.write(*table);
+		return;
+	}
+
+	static thread_local std::string buffer;
+	TexBuffer out(buffer);
 	out << "{"; 				// now the definition begins
-	out << "\\begin{tabular}{@{\\hspace{0mm}}r@{\\hspace{1mm}}r@{\\hspace{1mm}}r@{\\hspace{1mm}}r@{\\hspace{1mm}}r@{\\hspace{1mm}}r@{\\hspace{1mm}}r@{\\hspace{0mm}}}%%" << std::endl;
-	out << "\\multicolumn{7}{c}{" << _nGregorianLongName[month] << " " << a_year << "}\\\\[1mm]" << std::endl;
-	out << "{\\holcol Su} & Mo & Tu & We & Th & Fr & {\\satcol Sa}\\\\[0.7mm]" << std::endl;
+	out << "\\begin{tabular}{@{\\hspace{0mm}}r@{\\hspace{1mm}}r@{\\hspace{1mm}}r@{\\hspace{1mm}}r@{\\hspace{1mm}}r@{\\hspace{1mm}}r@{\\hspace{1mm}}r@{\\hspace{0mm}}}%%" << '\n';
+	out << "\\multicolumn{7}{c}{" << longName[month] << " " << a_year << "}\\\\[1mm]" << '\n';
+	out << "{\\holcol Su} & Mo & Tu & We & Th & Fr & {\\satcol Sa}\\\\[0.7mm]" << '\n';
 		// figure out how many days in the month
 	unsigned int days=daysInMonth(a_year,a_month);
 
@@ -725,204 +1053,244 @@ Calendar::getTexMonthSmall(unsigned int month) const
 		out << " &";
 	}
 	for (;a_day<=days;a_day++,date++) { // holiday
-		std::ostringstream tmp;
-		tmp << std::setw(2) << a_day;
 		if (isPublicHoliday(date) || (date.getDayOfWeek()==0)) {
-			out << "{\\holcol " << tmp.str() << "}";
+			out << "{\\holcol ";
+			out.appendNumber(a_day,2) << "}";
 		} else if (date.getDayOfWeek()==Date::DOW_SATURDAY) { // Saturday
-			out << "{\\satcol " << tmp.str() << "}";
+			out << "{\\satcol ";
+			out.appendNumber(a_day,2) << "}";
 		} else {							// normal
-			out << tmp.str();
+			out.appendNumber(a_day,2);
 		}
 		if (date.getDayOfWeek() != Date::DOW_SATURDAY) { // not Saturday, cell separator
 			out << " & ";
 		} else {				// Saturday
 			if (a_day < days) {	// newline if not end of month
-				out << "\\\\[0.5mm]" << std::endl;
+				out << "\\\\[0.5mm]" << '\n';
 			}
 		}
 	}
-	out << std::endl;
+	out << '\n';
 	out << "\\end{tabular}}%";
 
-	res=out.str();
+	table=std::make_shared<const std::string>(out.str());
+	smallMonthCache().insert(version,a_year,a_month,table);
+	sink.write(*table);
+}
 
+/**
+ * @brief key of a month page in the FragmentCache
+ *
+ * Covers the output format, the year, the month, its grid and the notes,
+ * solar term time and holiday description of every day, which is all a
+ * page depends on.
+ *
+ * @param month 1=January, ..., 12=December, of _year
+ *
+ * @return key of the page
+ */
+FragmentKey
+Calendar::monthKey(unsigned int month) const
+{
+	FragmentKey res;
+	res.add(TEX_FORMAT_VERSION,sizeof(TEX_FORMAT_VERSION)-1);
+	res.add(_year).add(month);
+	MonthGrid const& grid=monthGrid(_year,month);
+	res.add(grid.layout).add(grid.size);
+	Date const end=Date(_year,month,1)+daysInMonth(_year,month);
+	for (Date d=Date(_year,month,1); d<end; d++) {
+		unsigned int const i=d.getDayOfYear()-1;
+		res.add(_nDayFlag[i]).add(_nChineseMonth[i]).add(_nChineseDay[i]);
+		if (_nDayFlag[i] & DAY_SOLAR) {
+			res.add(_data->getSolarTermIndex(d));
+			res.add(_data->getSolarInstant(d).getMinuteOfDay());
+		}
+		if (_nDayFlag[i] & DAY_HOLIDAY) res.add(getPublicHolidayName(d));
+	}
 	return res;
 }
 
 /**
- * @brief get TeX code for the full month-to-view page for month
+ * @brief write TeX code for the full month-to-view page for month
  *
- * @param month 1=January, ..., 12=December, of _year
+ * Served from the FragmentCache instead, if one is set and has the page.
  *
- * @return string object containing TeX formatting code
+ * @param sink where the TeX formatting code is written
+ * @param month 1=January, ..., 12=December, of _year
  */
-std::string const&
-Calendar::getTexMonth(unsigned int month) const
+void
+Calendar::writeTexMonth(TexSink& sink, unsigned int month) const
 {
 #ifdef DEBUG
-	MY_ERR << this << "->Calendar::getTexMonth() called."
+	MY_ERR << this << "->Calendar::writeTexMonth() called."
 		   << std::endl;
 #endif
-	static std::string res;
 		// month 0=lastdec
 		// month 13=nextjan
 	if ((month>=13) || (month<=0)) {
 		throw INVALID_PARAM(month);
 	}
 
-	std::ostringstream out;
+	static FragmentTable const longName(_nGregorianLongName);
+	static FragmentTable const shortName(_nGregorianShortName);
+	static FragmentTable const dayOfWeekHeading(_nDayOfWeekHeading);
+	static thread_local std::string buffer;
+	FragmentKey key;
+	if (_cache) {
+		key=monthKey(month);
+		if (_cache->find(key,buffer)) {
+			sink.write(buffer);
+			return;
+		}
+	}
+	TexBuffer out(buffer);
 
 	if (month==1) {
 		out << "%";
 	}
 
-	out << "\\newpage\\vspace*{-4.5cm}%" << std::endl
-		<< "\\def\\lastmonth{\\hbox to\\cellwidth{%" << std::endl
-		<< "\\vbox to\\cellheight{%" << std::endl
-		<< "\\vfil  \\hbox to\\cellwidth{%" << std::endl
-		<< "\\hfil\\scriptsize\\" << _nGregorianShortName[month-1]
-		<< "\\hfil}\\vfil}}}%" << std::endl;
-
-	out << "\\def\\nextmonth{\\hbox to\\cellwidth{%" << std::endl
-		<< "\\vbox to\\cellheight{%" << std::endl
-		<< "\\vfil  \\hbox to\\cellwidth{%" << std::endl
-		<< "\\hfil\\scriptsize\\" << _nGregorianShortName[month+1]
-		<< "\\hfil}\\vfil}}}%" << std::endl;
-
-	out << "\\calmonth{" << _nGregorianLongName[month] << "}{"
-		<< _year << "}" << std::endl
-		<< "\\vspace*{-0.5cm}%" << std::endl;
-
-		// decide which layout to use
-		// layout= 6 :   SAT SUN ... FRI
-		// layout= 0 :   SUN MON ... SAT
-		// layout= 1 :   MON TUE ... SUN
-		// default layout 0
-		// also decide whether small months appear in top row (default)
-	int mylayout=0;
-	bool mytop=true;
-	Date monthStart=Date(_year,month,1);
-	if ((monthStart.getDayOfWeek()==Date::DOW_SATURDAY) && (month!=2)) {
-		mylayout=6;
-#ifdef DEBUG
-		MY_ERR << "\tCalendar::getTexMonth(): layout changed to 6." << std::endl;
-#endif
-	} else if ((monthStart.getDayOfWeek()==Date::DOW_FRIDAY) &&
-			   (daysInMonth(_year,month)==31)) {
-		mylayout=1;
-#ifdef DEBUG
-		MY_ERR << "\tCalendar::getTexMonth(): layout changed to 1." << std::endl;
-#endif
-	}
-		// top = true unless there are month start on LAYOUT or LAYOUT+1 mod 7
-	if ((monthStart.getDayOfWeek()==mylayout) || (monthStart.getDayOfWeek()==(mylayout+1)%7)) {
-		mytop=false;
-#ifdef DEBUG
-		MY_ERR << "\tCalendar::getTexMonth(): top changed to false." << std::endl;
-#endif
-	}
-		// constify
-	const int layout=mylayout;
-	const bool top=mytop;
-
-		// all layout variables decided, now proceed to cook up the table.
-	for(int i=layout; i<layout+7; i++){
-		out << _nDayOfWeekHeading[i%7] << std::endl;
+	out << "\\newpage\\vspace*{-4.5cm}%" << '\n'
+		<< "\\def\\lastmonth{\\hbox to\\cellwidth{%" << '\n'
+		<< "\\vbox to\\cellheight{%" << '\n'
+		<< "\\vfil  \\hbox to\\cellwidth{%" << '\n'
+		<< "\\hfil\\scriptsize\\" << shortName[month-1]
+		<< "\\hfil}\\vfil}}}%" << '\n';
+
+	out << "\\def\\nextmonth{\\hbox to\\cellwidth{%" << '\n'
+		<< "\\vbox to\\cellheight{%" << '\n'
+		<< "\\vfil  \\hbox to\\cellwidth{%" << '\n'
+		<< "\\hfil\\scriptsize\\" << shortName[month+1]
+		<< "\\hfil}\\vfil}}}%" << '\n';
+
+	out << "\\calmonth{" << longName[month] << "}{"
+		<< _year << "}" << '\n'
+		<< "\\vspace*{-0.5cm}%" << '\n';
+
+		// the grid, and its layout, depend on the year shape only
+	MonthGrid const& grid=monthGrid(_year,month);
+	for(unsigned int i=grid.layout; i<grid.layout+7u; i++){
+		out << dayOfWeekHeading[i%7] << '\n';
 	}
-	out << "\\\\[.2cm]%" << std::endl;
-
-	Date d=monthStart;
-		//special care for normal year February which start on Sunday
-	if ((month==2) && dayOfWeek(monthStart)==0 && !monthStart.isLeap()) {
-		out << dayCellTex(d) << std::endl;
-		d++;
-		for (; d.getMonth()==month; d++){
-			if (d.getDayOfWeek()== layout) {
-				out << "\\hfill\\\\% " << std::endl;
-			}
-			out << dayCellTex(d) << std::endl;
-		}
-		out << "\\hfill\\\\%" << std::endl;
-		for (int i=0;i<7;i++){
-			out << emptyCellTex() << std::endl;
-		}
-		out << "\\vspace*{-\\cellwidth}\\hspace*{-2\\cellwidth}\\lastmonth\\nextmonth%" << std::endl;
-	} else {
-		if (top) {
-			out << "\\lastmonth\\nextmonth\\hspace*{-2\\cellwidth}";
-		}
-			// generate (dow+7-layout)%7 empty cells
-		for(int i=layout;i!=d.getDayOfWeek();i++,i%=7){
-			out << emptyCellTex() << std::endl;
-		}
-		out << dayCellTex(d) << std::endl;
-		d++;
-		for (; d.getMonth()==month; d++){
-			if (d.getDayOfWeek()==layout) {
-				out << "\\hfill\\\\%" << std::endl;
-			}
-			out << dayCellTex(d) << std::endl;
-		}
-			// generate empty cells to fill the gap
-		for (int i=Date(_year,month,daysInMonth(_year,month)).getDayOfWeek();
-			 i!=(layout+6)%7; i++){
-			out << emptyCellTex() << std::endl;
-		}
-		if (!top) {
-			out << "\\vspace*{-\\cellwidth}\\hspace*{-2\\cellwidth}\\lastmonth\\nextmonth%" << std::endl;
+	out << "\\\\[.2cm]%" << '\n';
+
+	Date d=Date(_year,month,1);
+	for (unsigned int i=0; i<grid.size; i++) {
+		switch (grid.slot[i]) {
+			case MonthGrid::GRID_DAY:
+				appendDayCell(out,d);
+				out << '\n';
+				d++;
+				break;
+			case MonthGrid::GRID_EMPTY:
+				out << emptyCellTex() << '\n';
+				break;
+			case MonthGrid::GRID_BREAK:
+				out << "\\hfill\\\\%" << '\n';
+				break;
+			case MonthGrid::GRID_BREAK_SPACE:
+				out << "\\hfill\\\\% " << '\n';
+				break;
+			case MonthGrid::GRID_TOP:
+				out << "\\lastmonth\\nextmonth\\hspace*{-2\\cellwidth}";
+				break;
+			case MonthGrid::GRID_BOTTOM:
+				out << "\\vspace*{-\\cellwidth}\\hspace*{-2\\cellwidth}\\lastmonth\\nextmonth%" << '\n';
+				break;
 		}
 	}
 	if (month<12) {
-		out << std::endl;
+		out << '\n';
 	}
 
-	res=out.str();
-
-	return res;
+	if (_cache) _cache->insert(key,out.str());
+	sink.write(out.str());
 }
 
 /**
- * @brief get the \verbatim\end{document}\endverbatim TeX code
- *
- * This function takes no arguments.
+ * @brief write the \verbatim\end{document}\endverbatim TeX code
  *
- * @return string object containing TeX formatting code
- *         \verbatim\end{document}\endverbatim
+ * @param sink where the TeX formatting code is written
  */
-std::string const&
-Calendar::getTexEnd() const
+void
+Calendar::writeTexEnd(TexSink& sink) const
 {
 #ifdef DEBUG
-	MY_ERR << this << "->Calendar::getTexEnd() called."
+	MY_ERR << this << "->Calendar::writeTexEnd() called."
 		   << std::endl;
 #endif
-	static std::string res="\\end{document}\n";
-	return res;
+	sink.write("\\end{document}\n",15);
 }
 
 /**
- * @brief get TeX code from start to end
+ * @brief write TeX code from start to end
  *
- * This function takes no argument
+ * Each page goes to sink as soon as it is rendered, so only one page is held
+ * in memory.  Writes only to sink and reads only this calendar and its
+ * shared data, so calendars may render concurrently, each into its own
+ * sink.
  *
- * @return string object containing TeX formatting code from
+ * @param sink where the TeX formatting code from
  *         \verbatim\documentclass{...}\endverbatim
  * to
  *         \verbatim\end{document}\endverbatim
+ * is written
  */
-std::string const&
-Calendar::getFullYearTex() const
+void
+Calendar::writeFullYearTex(TexSink& sink) const
 {
 #ifdef DEBUG
-	MY_ERR << this << "->Calendar::getFullYearTex() called."
+	MY_ERR << this << "->Calendar::writeFullYearTex() called."
 		   << std::endl;
 #endif
-	static std::string res;
-	res=getTexPreamble();
+	writeTexPreamble(sink);
 	for (unsigned int i=1; i<=12; i++){
-		res+=getTexMonth(i);
+		writeTexMonth(sink,i);
 	}
-	res+=getTexEnd();
-	return res;
+	writeTexEnd(sink);
+}
+
+/**
+ * @brief write TeX code from start to end, rendering the months on a pool
+ *
+ * The 14 small month cells and 12 month pages are rendered as separate
+ * tasks, and written in order, giving the same code as
+ * writeFullYearTex(TexSink&).  The calling thread renders parts too,
+ * so this may be called from a task of the same pool.  Rethrows the first
+ * exception thrown by a part.
+ *
+ * @param sink where the TeX formatting code is written
+ * @param pool threads to render on
+ */
+void
+Calendar::writeFullYearTex(TexSink& sink, ThreadPool& pool) const
+{
+#ifdef DEBUG
+	MY_ERR << this << "->Calendar::writeFullYearTex((ThreadPool*)" << &pool
+		   << ") called." << std::endl;
+#endif
+	// the workers may pick up their task after we return
+	std::shared_ptr<YearParts> job=std::make_shared<YearParts>(this);
+	unsigned int helpers=std::min(pool.getSize(),YEAR_PARTS-1);
+	for (unsigned int i=0; i<helpers; i++) {
+		pool.submit([job]() {
+				while (renderPart(*job)) {}
+			});
+	}
+	while (renderPart(*job)) {}
+	{
+		std::unique_lock<std::mutex> lock(job->lock);
+		while (job->done<YEAR_PARTS) job->finished.wait(lock);
+	}
+	if (job->error) {
+		releaseParts(*job);
+		std::rethrow_exception(job->error);
+	}
+
+	// helpers still queued keep job alive, but not the rendered text
+	sink.write(TEX_PREAMBLE_HEAD,sizeof(TEX_PREAMBLE_HEAD)-1);
+	for (unsigned int i=0; i<14; i++) sink.write(job->part[i]);
+	sink.write(TEX_PREAMBLE_TAIL,sizeof(TEX_PREAMBLE_TAIL)-1);
+	for (unsigned int i=14; i<YEAR_PARTS; i++) sink.write(job->part[i]);
+	releaseParts(*job);
+	writeTexEnd(sink);
 }
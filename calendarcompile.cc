@@ -0,0 +1,84 @@
+/**
+ * @file calendarcompile.cc
+ *
+ * Time-stamp: <2026-10-17 16:05:12 +0800 by kerwin>
+ *
+ * command line program to compile solar.dat and pubhol.dat into the binary
+ * file read by Calendar.
+ *
+ * @author kerwin\@localhost
+ */
+#include "include/debug.h"
+#include "include/date.h"
+#include "include/calendarfile.h"
+#include "include/solarterm.h"
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#ifdef DEBUG
+std::ofstream MY_ERR;
+#endif
+
+/**
+ * @brief main function of calendar-compile
+ *
+ * Invoke it from command line as
+ *     @verbatim calendar-compile <solar.dat> <pubhol.dat> <calendar.bin> @endverbatim
+ *
+ * Solar terms of 1901--2099 missing from solar.dat are worked out by
+ * SolarTermEngine; those in solar.dat are kept as they are.
+ *
+ * The output is written to a temporary file and renamed over the target, so
+ * a running calendar never maps a half written file.
+ *
+ * @return 0 if command executed successfully, 1 otherwise.
+ */
+int
+main(int argc, char** argv)
+{
+#ifdef DEBUG
+	MY_ERR.open("calendar-compile.log");
+	MY_ERR << "main() called with " << argc << " argument(s)." << std::endl;
+#endif
+	if (argc!=4) {
+		std::cerr << "usage: " << argv[0]
+				  << " <solar.dat> <pubhol.dat> <calendar.bin>" << std::endl;
+		return 1;
+	}
+	try {
+		std::ifstream isolar(argv[1]);
+		std::ifstream ipubhol(argv[2]);
+		if (!isolar || !ipubhol) {
+			throw Exception("Cannot open input file");
+		}
+		SolarList solar;
+		HolidayList holiday;
+		unsigned long bad=readSolarCSV(isolar,solar);
+		bad+=readPublicHolidayCSV(ipubhol,holiday);
+		if (bad) {
+			throw Exception("Bad lines in input file");
+		}
+		unsigned long computed=SolarTermEngine::fill(solar,1901,2099);
+
+		std::string tmp=std::string(argv[3])+".tmp";
+		std::ofstream out(tmp.c_str(),std::ios::binary);
+		CalendarFile::write(out,solar,holiday);
+		out.close();
+		if (!out || std::rename(tmp.c_str(),argv[3])) {
+			std::remove(tmp.c_str());
+			throw Exception("Cannot write output file");
+		}
+		std::cerr << argv[3] << ": " << solar.size() << " solar terms ("
+				  << computed << " computed), " << holiday.size()
+				  << " public holidays" << std::endl;
+	}
+	catch (BeautyException& h) {
+		std::cerr << h.message() << std::endl;
+		return 1;
+	}
+	catch (Exception& h) {
+		std::cerr << h.message() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,591 @@
+/**
+ * @file calendardata.cc
+ *
+ * Time-stamp: <2026-10-17 18:40:31 +0800 by kerwin>
+ *
+ * Solar terms and public holidays, loaded once and shared by calendars
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "include/debug.h"
+#include "include/calendardata.h"
+#include "include/solarterm.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <sys/stat.h>
+
+namespace {
+	/**
+	 * @brief format a solar term time
+	 *
+	 * @param minute minutes after midnight
+	 *
+	 * @return time as "hh:mm"
+	 */
+	std::string
+	hourMinute(unsigned int minute)
+	{
+		char s[]={char('0'+minute/600), char('0'+minute/60%10), ':',
+				  char('0'+minute%60/10), char('0'+minute%10), 0};
+		return s;
+	}
+
+	/**
+	 * @brief the solar term of a date and minute
+	 *
+	 * @param d a solar term date
+	 * @param minute minutes after midnight
+	 * @param term 0=xiaohan, ..., 23=dongzhi, or UNNUMBERED_TERM to have
+	 * SolarTermEngine match it by date
+	 *
+	 * @return solar term
+	 */
+	SolarTerm
+	makeSolarTerm(Date const& d, unsigned int minute, unsigned int term)
+	{
+		if (term>=SolarTermEngine::TERMS) {
+			term=SolarTermEngine::getTerm(d.getMJD());
+		}
+		SolarTerm res={DateTime(d,minute),term};
+		return res;
+	}
+
+	/**
+	 * @brief order solar terms by instant
+	 *
+	 * @param t an instant
+	 * @param s a solar term
+	 *
+	 * @retval true if t is before s begins
+	 * @retval false otherwise
+	 */
+	bool
+	beforeSolarTerm(DateTime const& t, SolarTerm const& s)
+	{
+		return t<s.instant;
+	}
+
+	/**
+	 * @brief a CalendarData version number never handed out before
+	 *
+	 * This function takes no argument.
+	 *
+	 * @return new version number
+	 */
+	unsigned long
+	newVersion()
+	{
+		static std::atomic<unsigned long> last(0);
+		return ++last;
+	}
+
+	/**
+	 * @brief modification time of a file
+	 *
+	 * @param path file name
+	 *
+	 * @return seconds since the epoch, -1 if the file is missing
+	 */
+	double
+	modificationTime(std::string const& path)
+	{
+		struct stat st;
+		if (stat(path.c_str(),&st)<0) return -1;
+		return st.st_mtim.tv_sec+1e-9*st.st_mtim.tv_nsec;
+	}
+
+	/**
+	 * @brief the published default data
+	 *
+	 * Two slots, the current one given by the parity of generation.  A
+	 * reader pins the slot it is about to copy from, then checks that the
+	 * generation has not moved; a publisher writes only the other slot, and
+	 * first waits until nobody has it pinned.  Readers never wait, and a
+	 * publisher waits at most for a pointer copy.
+	 */
+	struct Snapshot {
+		std::atomic<unsigned long> generation;
+		///< number of publish() calls so far
+		std::atomic<unsigned int> readers[2];
+		///< readers copying from each slot
+		std::shared_ptr<const CalendarData> data[2];
+		///< the current and the previous snapshot
+		std::mutex publishing;
+		///< serialises publishers, never taken by readers
+		Snapshot() : generation(0) {
+			readers[0]=0; readers[1]=0;
+			data[0]=CalendarData::load();
+		}
+	};
+
+	/**
+	 * @brief the published default data, loaded on first use
+	 *
+	 * This function takes no argument.
+	 *
+	 * @return reference to the single Snapshot
+	 */
+	Snapshot&
+	snapshot()
+	{
+		static Snapshot s;
+		return s;
+	}
+}
+
+/**
+ * @brief constructor, gives no solar terms and no holidays
+ */
+CalendarData::CalendarData() : _version(newVersion())
+{
+}
+
+/**
+ * @brief extracts the solar term time for a date
+ *
+ * @param d a date that should be solar term
+ *
+ * @return solar term time as "hh:mm"
+ */
+std::string
+CalendarData::getSolarTime(Date const& d) const
+{
+#ifdef DEBUG
+	MY_ERR << this << "->CalendarData::getSolarTime(Date(" << d.getYear()
+		   << "," << d.getMonth() << "," << d.getDay() << ")) called."
+		   << std::endl;
+#endif
+	return hourMinute(solarTermOn(d).instant.getMinuteOfDay());
+}
+
+/**
+ * @brief extracts the beginning of the solar term on a date
+ *
+ * @param d a date that should be solar term
+ *
+ * @return instant the term begins
+ */
+DateTime
+CalendarData::getSolarInstant(Date const& d) const
+{
+	return solarTermOn(d).instant;
+}
+
+/**
+ * @brief extracts which solar term falls on a date
+ *
+ * @param d a date that should be solar term
+ *
+ * @return 0=xiaohan, ..., 23=dongzhi
+ */
+unsigned int
+CalendarData::getSolarTermIndex(Date const& d) const
+{
+	return solarTermOn(d).term;
+}
+
+/**
+ * @brief the solar term on a date, from the data or worked out
+ *
+ * Throws Exception if d is not a solar term.
+ *
+ * @param d a date that should be solar term
+ *
+ * @return the solar term
+ */
+SolarTerm
+CalendarData::solarTermOn(Date const& d) const
+{
+	if (DayBitmap::covers(d.getMJD())) {
+		if (_nSolar.test(d)) return _nSolarTerm[_nSolar.rank(d)];
+	}
+	else {
+		SolarTerm t;
+		if (computedSolarTerm(d,t)) return t;
+	}
+	throw Exception("Invalid Parameter d --- is not a solar term date");
+}
+
+/**
+ * @brief look for a solar term on a date with SolarTermEngine
+ *
+ * Used for dates outside DayBitmap, where there is no data.
+ *
+ * @param d a date
+ * @param[out] res the solar term, if there is one
+ *
+ * @retval true if a solar term begins on d
+ * @retval false otherwise
+ */
+bool
+CalendarData::computedSolarTerm(Date const& d, SolarTerm& res)
+{
+	DateTime t[SolarTermEngine::TERMS];
+	SolarTermEngine::getYear(d.getGregorianYear(),t);
+		// two terms a month, the first before the 16th
+	unsigned int k=2*(d.getGregorianMonth()-1)+(d.getGregorianDay()>>4);
+	for (unsigned int i=(k?k-1:k); i<=k+1 && i<SolarTermEngine::TERMS; i++) {
+		if (t[i].getDate()==d) {
+			res.instant=t[i];
+			res.term=i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief the solar term period an instant is in
+ *
+ * A binary search over the solar terms.
+ *
+ * @param t an instant
+ * @param[out] res the last solar term beginning at or before t
+ *
+ * @retval true if found
+ * @retval false if t is before the first solar term known
+ */
+bool
+CalendarData::findSolarTerm(DateTime const& t, SolarTerm& res) const
+{
+	std::vector<SolarTerm>::const_iterator i=
+		std::upper_bound(_nSolarTerm.begin(),_nSolarTerm.end(),t,
+						 beforeSolarTerm);
+	if (i==_nSolarTerm.begin()) return false;
+	res=*--i;
+	return true;
+}
+
+/**
+ * @brief extracts the public holiday description for a date
+ *
+ * @param d a date that should be a holiday
+ *
+ * @return const string of public holiday description.
+ */
+std::string const&
+CalendarData::getPublicHolidayName(Date const& d) const
+{
+#ifdef DEBUG
+	MY_ERR << this << "->CalendarData::getPublicHolidayName(Date("
+		   << d.getYear() << "," << d.getMonth() << "," << d.getDay()
+		   << ")) called." << std::endl;
+#endif
+	if(!isPublicHoliday(d)) {
+		throw Exception("Invalid Parameter d --- is not a public holiday");
+	}
+	return _nPublicHolidayName[_nPublicHoliday.rank(d)].str();
+}
+
+/**
+ * @brief handle to the public holiday description for a date
+ *
+ * Two holidays have the same description exactly when their handles
+ * compare equal.
+ *
+ * @param d a date that should be a holiday
+ *
+ * @return pooled public holiday description
+ */
+InternedString
+CalendarData::getPublicHolidayLabel(Date const& d) const
+{
+	if(!isPublicHoliday(d)) {
+		throw Exception("Invalid Parameter d --- is not a public holiday");
+	}
+	return _nPublicHolidayName[_nPublicHoliday.rank(d)];
+}
+
+/**
+ * @brief replace the solar terms
+ *
+ * Terms not numbered, as from readSolarCSV(), are numbered by
+ * SolarTermEngine::getTerm().
+ *
+ * @param solar solar terms, ascending and unique in MJD
+ */
+void
+CalendarData::setSolar(SolarList const& solar)
+{
+#ifdef DEBUG
+	MY_ERR << this << "->CalendarData::setSolar(" << solar.size()
+		   << " entries) called." << std::endl;
+#endif
+	_version=newVersion();
+	_nSolar.clear();
+	_nSolarTerm.clear();
+	_nSolarTerm.reserve(solar.size());
+	for (std::size_t i=0; i<solar.size(); i++) {
+		if (!DayBitmap::covers(solar[i].first)) continue;
+		_nSolar.set(Date(solar[i].first));
+		_nSolarTerm.push_back(makeSolarTerm(Date(solar[i].first),
+											solar[i].second.minute,
+											solar[i].second.term));
+	}
+	_nSolar.buildIndex();
+}
+
+/**
+ * @brief replace the public holidays
+ *
+ * @param holiday public holidays, ascending and unique in MJD
+ */
+void
+CalendarData::setPublicHoliday(HolidayList const& holiday)
+{
+#ifdef DEBUG
+	MY_ERR << this << "->CalendarData::setPublicHoliday(" << holiday.size()
+		   << " entries) called." << std::endl;
+#endif
+	_version=newVersion();
+	_nPublicHoliday.clear();
+	_nPublicHolidayName.clear();
+	_nPublicHolidayName.reserve(holiday.size());
+	for (std::size_t i=0; i<holiday.size(); i++) {
+		if (!DayBitmap::covers(holiday[i].first)) continue;
+		_nPublicHoliday.set(Date(holiday[i].first));
+		_nPublicHolidayName.push_back(InternedString(holiday[i].second));
+	}
+	_nPublicHoliday.buildIndex();
+}
+
+/**
+ * @brief replace the public holidays by those of a CSV stream
+ *
+ * Reads straight into the bitmap and names, see readPublicHolidayCSV().
+ * Bad lines are reported on std::cerr and skipped.
+ *
+ * @param[in] file plain text stream, per line: year,month,day,description
+ *
+ * @return number of bad lines
+ */
+unsigned long
+CalendarData::readPublicHoliday(std::istream& file)
+{
+#ifdef DEBUG
+	MY_ERR << this << "->CalendarData::readPublicHoliday((istream*)" << &file
+		   << ") called." << std::endl;
+#endif
+	_version=newVersion();
+	return readPublicHolidayCSV(file,_nPublicHoliday,_nPublicHolidayName);
+}
+
+/**
+ * @brief replace solar terms and holidays by those of a compiled file
+ *
+ * @param data an open compiled calendar data file
+ */
+void
+CalendarData::setList(CalendarFile const& data)
+{
+#ifdef DEBUG
+	MY_ERR << this << "->CalendarData::setList((CalendarFile*)" << &data
+		   << ") called." << std::endl;
+#endif
+	_version=newVersion();
+	// the keys are sorted and unique, so push in file order
+	_nSolar.clear();
+	_nSolarTerm.clear();
+	_nSolarTerm.reserve(data.getSolarCount());
+	for (std::size_t i=0; i<data.getSolarCount(); i++) {
+		if (!DayBitmap::covers(data.getSolarMJD(i))) continue;
+		_nSolar.set(Date(data.getSolarMJD(i)));
+		_nSolarTerm.push_back(makeSolarTerm(Date(data.getSolarMJD(i)),
+											data.getSolarMinute(i),
+											data.getSolarTerm(i)));
+	}
+	_nSolar.buildIndex();
+
+	_nPublicHoliday.clear();
+	_nPublicHolidayName.clear();
+	_nPublicHolidayName.reserve(data.getHolidayCount());
+	for (std::size_t i=0; i<data.getHolidayCount(); i++) {
+		if (!DayBitmap::covers(data.getHolidayMJD(i))) continue;
+		_nPublicHoliday.set(Date(data.getHolidayMJD(i)));
+		char const* name=data.getHolidayName(i);
+		_nPublicHolidayName.push_back(InternedString(name,strlen(name)));
+	}
+	_nPublicHoliday.buildIndex();
+}
+
+/**
+ * @brief add a public holiday, or rename it if already there
+ *
+ * Throws INVALID_PARAM if d is outside the range of DayBitmap.
+ *
+ * @param d date of holiday
+ * @param name description of holiday
+ */
+void
+CalendarData::addPublicHoliday(Date const& d, std::string const& name)
+{
+	if (!DayBitmap::covers(d.getMJD())) {
+		throw INVALID_PARAM(d.getMJD());
+	}
+	_version=newVersion();
+	std::size_t i=_nPublicHoliday.rank(d);
+	if (_nPublicHoliday.test(d)) {
+		_nPublicHolidayName[i]=InternedString(name);
+		return;
+	}
+	_nPublicHolidayName.insert(_nPublicHolidayName.begin()+i,
+							   InternedString(name));
+	_nPublicHoliday.insert(d);
+}
+
+/**
+ * @brief remove a public holiday, if there
+ *
+ * @param d date of holiday
+ */
+void
+CalendarData::removePublicHoliday(Date const& d)
+{
+	if (!isPublicHoliday(d)) return;
+	_version=newVersion();
+	std::size_t i=_nPublicHoliday.rank(d);
+	_nPublicHolidayName.erase(_nPublicHolidayName.begin()+i);
+	_nPublicHoliday.erase(d);
+}
+
+/**
+ * @brief add a solar term, or change its time if already there
+ *
+ * A term already there keeps its number; a new one is numbered by
+ * SolarTermEngine::getTerm().  Throws INVALID_PARAM if d is outside the
+ * range of DayBitmap.
+ *
+ * @param d date of solar term
+ * @param minute minutes after midnight
+ */
+void
+CalendarData::setSolarTerm(Date const& d, unsigned int minute)
+{
+	if (!DayBitmap::covers(d.getMJD())) {
+		throw INVALID_PARAM(d.getMJD());
+	}
+	_version=newVersion();
+	std::size_t i=_nSolar.rank(d);
+	if (_nSolar.test(d)) {
+		_nSolarTerm[i].instant=DateTime(d,minute);
+		return;
+	}
+	_nSolarTerm.insert(_nSolarTerm.begin()+i,
+					   makeSolarTerm(d,minute,UNNUMBERED_TERM));
+	_nSolar.insert(d);
+}
+
+/**
+ * @brief read the data files of a directory
+ *
+ * Reads calendar.bin if it is a valid compiled file no older than
+ * solar.dat and pubhol.dat, else the two CSV files.  A missing pubhol.dat
+ * gives no holidays.  Solar terms missing from solar.dat are worked out by
+ * SolarTermEngine, as calendar-compile does for calendar.bin.
+ *
+ * @param directory where the files are, the current directory by default
+ *
+ * @return newly loaded data
+ */
+std::shared_ptr<const CalendarData>
+CalendarData::load(std::string const& directory)
+{
+#ifdef DEBUG
+	MY_ERR << "CalendarData::load(" << directory << ") called." << std::endl;
+#endif
+	std::string const bin=directory+"/calendar.bin";
+	std::string const sol=directory+"/solar.dat";
+	std::string const hol=directory+"/pubhol.dat";
+	std::shared_ptr<CalendarData> res=std::make_shared<CalendarData>();
+	CalendarFile compiled;
+	double t=modificationTime(bin);
+	if ((t>=modificationTime(sol)) && (t>=modificationTime(hol)) &&
+		compiled.open(bin.c_str())) {
+		res->setList(compiled);
+	}
+	else {
+		std::ifstream isolar(sol.c_str());
+		std::ifstream ipubhol(hol.c_str());
+		SolarList solar;
+		readSolarCSV(isolar,solar);
+		SolarTermEngine::fill(solar,Date(DayBitmap::firstMJD()).getYear(),
+							  Date(DayBitmap::lastMJD()).getYear());
+		res->setSolar(solar);
+		res->readPublicHoliday(ipubhol);
+	}
+	return res;
+}
+
+/**
+ * @brief the data shared by default by all calendars
+ *
+ * Loaded by load() on first call, which is thread safe; later calls return
+ * the snapshot last given to publish().  Never blocks once loaded.
+ *
+ * This function takes no argument.
+ *
+ * @return process wide data
+ */
+std::shared_ptr<const CalendarData>
+CalendarData::getDefault()
+{
+	Snapshot& s=snapshot();
+	for (;;) {
+		unsigned long g=s.generation.load();
+		s.readers[g & 1]++;
+		if (s.generation.load()==g) {
+			std::shared_ptr<const CalendarData> res=s.data[g & 1];
+			s.readers[g & 1]--;
+			return res;
+		}
+		// a publish() got in between, the slot may be rewritten
+		s.readers[g & 1]--;
+	}
+}
+
+/**
+ * @brief number of times the default data was replaced
+ *
+ * This function takes no argument.
+ *
+ * @return generation of the current default data, 0 for the first load
+ */
+unsigned long
+CalendarData::getGeneration()
+{
+	return snapshot().generation.load();
+}
+
+/**
+ * @brief replace the data shared by default by all calendars
+ *
+ * Calendars already holding the old data keep it until they call
+ * Calendar::refresh().
+ *
+ * @param data new default data
+ */
+void
+CalendarData::publish(std::shared_ptr<const CalendarData> const& data)
+{
+#ifdef DEBUG
+	MY_ERR << "CalendarData::publish((CalendarData*)" << data.get()
+		   << ") called." << std::endl;
+#endif
+	if (!data) {
+		throw Exception("Invalid parameter data --- is null");
+	}
+	Snapshot& s=snapshot();
+	std::lock_guard<std::mutex> lock(s.publishing);
+	unsigned long g=s.generation.load();
+	unsigned int next=(g+1) & 1;
+	// a reader that pinned this slot before the last publish is still
+	// copying from it
+	while (s.readers[next].load()) std::this_thread::yield();
+	s.data[next]=data;
+	s.generation.store(g+1);
+}
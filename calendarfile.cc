@@ -0,0 +1,685 @@
+/**
+ * @file calendarfile.cc
+ *
+ * Time-stamp: <2026-10-17 16:05:12 +0800 by kerwin>
+ *
+ * Compiled binary form of solar.dat and pubhol.dat, and the CSV readers
+ * shared by Calendar and calendar-compile.
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "include/debug.h"
+#include "include/calendarfile.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+	const char MAGIC[8] = "KCALDAT";
+	const uint32_t BYTE_ORDER_MARK = 0x01020304;
+	const unsigned int TERMS = 24;
+	///< solar terms in a year
+
+	/**
+	 * @brief file header, 32 bytes
+	 */
+	struct FileHeader {
+		char magic[8];
+		///< MAGIC
+		uint32_t version;
+		///< CalendarFile::VERSION
+		uint32_t byteOrder;
+		///< BYTE_ORDER_MARK as written by the compiling machine
+		uint32_t checksum;
+		///< FNV-1a of everything after the header
+		uint32_t solarCount;
+		///< number of solar terms
+		uint32_t holidayCount;
+		///< number of public holidays
+		uint32_t poolSize;
+		///< bytes in the string pool
+	};
+
+	/**
+	 * @brief byte offsets of the sections of a file
+	 */
+	struct FileLayout {
+		std::size_t solarMJD, solarMinute, solarTerm, holidayMJD, holidayName,
+			pool, end;
+		FileLayout(std::size_t nSolar, std::size_t nHoliday,
+				   std::size_t poolSize) {
+			solarMJD=sizeof(FileHeader);
+			solarMinute=solarMJD+4*nSolar;
+			solarTerm=solarMinute+((2*nSolar+3) & ~(std::size_t)3);
+			holidayMJD=solarTerm+((nSolar+3) & ~(std::size_t)3);
+			holidayName=holidayMJD+4*nHoliday;
+			pool=holidayName+4*nHoliday;
+			end=pool+poolSize;
+		}
+	};
+
+	/**
+	 * @brief 32-bit FNV-1a hash
+	 *
+	 * @param p start of data
+	 * @param n length of data
+	 *
+	 * @return hash of the n bytes at p
+	 */
+	uint32_t
+	fnv1a(unsigned char const* p, std::size_t n)
+	{
+		uint32_t h=2166136261u;
+		for (std::size_t i=0; i<n; i++) {
+			h=(h^p[i])*16777619u;
+		}
+		return h;
+	}
+
+	/**
+	 * @brief append the bytes of an object to a buffer
+	 *
+	 * @param[out] buf buffer
+	 * @param x object to append
+	 */
+	template <class T>
+	void
+	append(std::string& buf, T const& x)
+	{
+		buf.append(reinterpret_cast<char const*>(&x),sizeof(x));
+	}
+
+	/**
+	 * @brief check that a mapped file is a well formed compiled file
+	 *
+	 * @param p start of mapping
+	 * @param size length of mapping
+	 *
+	 * @retval true if header, sizes, checksum, key order, times, term
+	 * numbers and string offsets are all good
+	 * @retval false otherwise
+	 */
+	bool
+	validFile(unsigned char const* p, std::size_t size)
+	{
+		if (size<sizeof(FileHeader)) return false;
+		FileHeader h;
+		std::memcpy(&h,p,sizeof(h));
+		if (std::memcmp(h.magic,MAGIC,sizeof(MAGIC)) ||
+			(h.version!=CalendarFile::VERSION) ||
+			(h.byteOrder!=BYTE_ORDER_MARK)) {
+			return false;
+		}
+		FileLayout l(h.solarCount,h.holidayCount,h.poolSize);
+		if (l.end!=size) return false;
+		if (fnv1a(p+sizeof(h),size-sizeof(h))!=h.checksum) return false;
+		int const* solar=reinterpret_cast<int const*>(p+l.solarMJD);
+		unsigned short const* minute=
+			reinterpret_cast<unsigned short const*>(p+l.solarMinute);
+		unsigned char const* term=p+l.solarTerm;
+		for (std::size_t i=0; i<h.solarCount; i++) {
+			if ((i && (solar[i-1]>=solar[i])) || (minute[i]>=24*60) ||
+				(term[i]>=TERMS)) {
+				return false;
+			}
+		}
+		int const* holiday=reinterpret_cast<int const*>(p+l.holidayMJD);
+		unsigned int const* name=
+			reinterpret_cast<unsigned int const*>(p+l.holidayName);
+		for (std::size_t i=0; i<h.holidayCount; i++) {
+			if ((i && (holiday[i-1]>=holiday[i])) || (name[i]>=h.poolSize)) {
+				return false;
+			}
+		}
+		return (h.poolSize==0) || (p[size-1]==0);
+	}
+
+	/**
+	 * @brief line by line scanner over a stream, read in large blocks
+	 *
+	 * Lines are handed out as pointers into the block buffer, and fields
+	 * are parsed in place: nothing is copied or allocated per line.  A
+	 * line is valid until the next call to nextLine().
+	 */
+	class LineScanner {
+	  public:
+		LineScanner(std::istream&);
+		bool nextLine();
+		bool blank() const;
+		unsigned long getLineNumber() const;
+		char const* readNumber(unsigned int&, bool);
+		char const* readDate(int&);
+		char const* readRest(char const*&, std::size_t&);
+		char const* end() const;
+	  private:
+		std::istream& _in;
+		///< stream being read
+		std::vector<char> _buf;
+		///< block buffer, grows only to hold a line longer than a block
+		std::size_t _begin;
+		///< start of unread data in _buf
+		std::size_t _end;
+		///< end of data in _buf
+		bool _eof;
+		///< has the stream run out
+		unsigned long _line;
+		///< number of the current line, counted from 1
+		char const* _p;
+		///< scanning position in the current line
+		char const* _q;
+		///< end of the current line, less any '\r'
+		void skipBlank();
+	};
+
+	const std::size_t SCAN_BLOCK = 1<<16;
+
+	/**
+	 * @brief constructor
+	 *
+	 * @param in stream to scan
+	 */
+	LineScanner::LineScanner(std::istream& in) :
+		_in(in), _buf(SCAN_BLOCK), _begin(0), _end(0), _eof(false), _line(0),
+		_p(0), _q(0)
+	{
+	}
+
+	/**
+	 * @brief move to the next line
+	 *
+	 * This function takes no argument.
+	 *
+	 * @retval true if there is a line
+	 * @retval false at end of stream
+	 */
+	bool
+	LineScanner::nextLine()
+	{
+		for (;;) {
+			char* b=&_buf[0];
+			char* nl=static_cast<char*>(std::memchr(b+_begin,'\n',_end-_begin));
+			if (nl || (_eof && (_begin<_end))) {
+				_p=b+_begin;
+				_q=nl ? nl : b+_end;
+				_begin=nl ? nl+1-b : _end;
+				if ((_q>_p) && (_q[-1]=='\r')) _q--;
+				_line++;
+				return true;
+			}
+			if (_eof) return false;
+			// keep the partial line, then refill behind it
+			std::memmove(b,b+_begin,_end-_begin);
+			_end-=_begin;
+			_begin=0;
+			if (_end==_buf.size()) _buf.resize(2*_buf.size());
+			std::streamsize n=_in.rdbuf() ?
+				_in.rdbuf()->sgetn(&_buf[_end],_buf.size()-_end) : 0;
+			if (n<=0) _eof=true;
+			else _end+=n;
+		}
+	}
+
+	/**
+	 * @brief skip blanks at the scanning position
+	 *
+	 * This function takes no argument.
+	 */
+	inline
+	void
+	LineScanner::skipBlank()
+	{
+		while ((_p<_q) && ((*_p==' ') || (*_p=='\t'))) _p++;
+	}
+
+	/**
+	 * @brief check if the rest of the line is blank
+	 *
+	 * This function takes no argument.
+	 *
+	 * @retval true if only blanks remain
+	 * @retval false otherwise
+	 */
+	bool
+	LineScanner::blank() const
+	{
+		for (char const* p=_p; p<_q; p++) {
+			if ((*p!=' ') && (*p!='\t')) return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief current line number
+	 *
+	 * This function takes no argument.
+	 *
+	 * @return number of the line last returned by nextLine(), from 1
+	 */
+	inline
+	unsigned long
+	LineScanner::getLineNumber() const
+	{
+		return _line;
+	}
+
+	/**
+	 * @brief parse an unsigned decimal field
+	 *
+	 * @param[out] x value read
+	 * @param comma is the field followed by a comma (else by end of line)
+	 *
+	 * @return 0 on success, else the reason it failed
+	 */
+	char const*
+	LineScanner::readNumber(unsigned int& x, bool comma)
+	{
+		skipBlank();
+		char const* start=_p;
+		x=0;
+		while ((_p<_q) && (*_p>='0') && (*_p<='9') && (_p-start<9)) {
+			x=10*x+(*_p++-'0');
+		}
+		if (_p==start) return "expected a number";
+		if ((_p<_q) && (*_p>='0') && (*_p<='9')) return "number too long";
+		skipBlank();
+		if (comma) {
+			if ((_p==_q) || (*_p!=',')) return "expected ','";
+			_p++;
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief parse year,month,day, each followed by a comma
+	 *
+	 * @param[out] mjd MJD of the date read
+	 *
+	 * @return 0 on success, else the reason it failed
+	 */
+	char const*
+	LineScanner::readDate(int& mjd)
+	{
+		unsigned int year, month, day;
+		char const* why=readNumber(year,true);
+		if (!why) why=readNumber(month,true);
+		if (!why) why=readNumber(day,true);
+		if (why) return why;
+		if ((year>999999) || (month<1) || (month>12) || (day<1) ||
+			(day>daysInMonth(year,month))) {
+			return "invalid date";
+		}
+		mjd=mjdFromGregorian(year,month,day);
+		return 0;
+	}
+
+	/**
+	 * @brief take the rest of the line, less surrounding blanks
+	 *
+	 * @param[out] p start of the text, points into the block buffer
+	 * @param[out] n length of the text
+	 *
+	 * @return 0 on success, else the reason it failed
+	 */
+	char const*
+	LineScanner::readRest(char const*& p, std::size_t& n)
+	{
+		skipBlank();
+		char const* q=_q;
+		while ((q>_p) && ((q[-1]==' ') || (q[-1]=='\t'))) q--;
+		if (q==_p) return "missing description";
+		p=_p; n=q-_p;
+		_p=_q;
+		return 0;
+	}
+
+	/**
+	 * @brief check that nothing but blanks is left on the line
+	 *
+	 * This function takes no argument.
+	 *
+	 * @return 0 on success, else the reason it failed
+	 */
+	char const*
+	LineScanner::end() const
+	{
+		return blank() ? 0 : "unexpected text at end of line";
+	}
+
+	/**
+	 * @brief sort a list by MJD, keeping only the last entry of each MJD
+	 *
+	 * Data files are normally in date order already, which is checked first.
+	 *
+	 * @param[in,out] list list of (MJD, value) in file order
+	 */
+	template <class T>
+	void
+	sortUnique(std::vector<std::pair<int,T> >& list)
+	{
+		bool sorted=true;
+		for (std::size_t i=1; sorted && (i<list.size()); i++) {
+			sorted=list[i-1].first<list[i].first;
+		}
+		if (sorted) return;
+		std::stable_sort(list.begin(),list.end(),
+						 [](std::pair<int,T> const& a, std::pair<int,T> const& b)
+						 { return a.first<b.first; });
+		// last of each run of equal MJD wins, as with the old map loaders
+		std::size_t n=0;
+		for (std::size_t i=0; i<list.size(); i++) {
+			if ((i+1<list.size()) && (list[i+1].first==list[i].first)) continue;
+			if (n!=i) list[n]=std::move(list[i]);
+			n++;
+		}
+		list.resize(n);
+	}
+}
+
+/**
+ * @brief constructor, gives a closed file
+ */
+CalendarFile::CalendarFile() :
+	_map(0), _size(0), _nSolar(0), _nHoliday(0), _solarMJD(0),
+	_solarMinute(0), _solarTerm(0), _holidayMJD(0), _holidayName(0), _pool(0)
+{
+}
+
+/**
+ * @brief destructor, unmaps the file
+ */
+CalendarFile::~CalendarFile()
+{
+	close();
+}
+
+/**
+ * @brief map a compiled calendar data file
+ *
+ * @param path file name
+ *
+ * @retval true if the file was mapped and is valid
+ * @retval false if the file is missing, unreadable, of another version or
+ * byte order, or corrupt; the object is then closed
+ */
+bool
+CalendarFile::open(char const* path)
+{
+#ifdef DEBUG
+	MY_ERR << this << "->CalendarFile::open(" << path << ") called."
+		   << std::endl;
+#endif
+	close();
+	int fd=::open(path,O_RDONLY);
+	if (fd<0) return false;
+	struct stat st;
+	if ((fstat(fd,&st)<0) || (st.st_size<(off_t)sizeof(FileHeader))) {
+		::close(fd);
+		return false;
+	}
+	void* p=mmap(0,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+	::close(fd);
+	if (p==MAP_FAILED) return false;
+	unsigned char const* b=static_cast<unsigned char const*>(p);
+	if (!validFile(b,st.st_size)) {
+#ifdef DEBUG
+		MY_ERR << "\t" << path << " is not a valid compiled file." << std::endl;
+#endif
+		munmap(p,st.st_size);
+		return false;
+	}
+	FileHeader h;
+	std::memcpy(&h,b,sizeof(h));
+	FileLayout l(h.solarCount,h.holidayCount,h.poolSize);
+	_map=p;
+	_size=st.st_size;
+	_nSolar=h.solarCount;
+	_nHoliday=h.holidayCount;
+	_solarMJD=reinterpret_cast<int const*>(b+l.solarMJD);
+	_solarMinute=reinterpret_cast<unsigned short const*>(b+l.solarMinute);
+	_solarTerm=b+l.solarTerm;
+	_holidayMJD=reinterpret_cast<int const*>(b+l.holidayMJD);
+	_holidayName=reinterpret_cast<unsigned int const*>(b+l.holidayName);
+	_pool=reinterpret_cast<char const*>(b+l.pool);
+	return true;
+}
+
+/**
+ * @brief unmap the file
+ *
+ * This function takes no argument.
+ */
+void
+CalendarFile::close()
+{
+	if (_map) munmap(_map,_size);
+	_map=0; _size=0; _nSolar=0; _nHoliday=0;
+}
+
+/**
+ * @brief write a compiled calendar data file
+ *
+ * @param[out] out binary output stream
+ * Throws INVALID_PARAM if a solar term has a bad time or is not numbered.
+ *
+ * @param solar solar terms, ascending and unique in MJD, numbered as by
+ * SolarTermEngine::fill()
+ * @param holiday public holidays, ascending and unique in MJD
+ */
+void
+CalendarFile::write(std::ostream& out, SolarList const& solar,
+					HolidayList const& holiday)
+{
+#ifdef DEBUG
+	MY_ERR << "CalendarFile::write(" << solar.size() << " solar terms, "
+		   << holiday.size() << " holidays) called." << std::endl;
+#endif
+	std::string pool;
+	std::map<std::string,uint32_t> interned;
+	std::string body;
+	for (std::size_t i=0; i<solar.size(); i++) {
+		append(body,(int32_t)solar[i].first);
+	}
+	for (std::size_t i=0; i<solar.size(); i++) {
+		if (solar[i].second.minute>=24*60) {
+			throw INVALID_PARAM(solar[i].second.minute);
+		}
+		append(body,(uint16_t)solar[i].second.minute);
+	}
+	if (solar.size() & 1) append(body,(uint16_t)0);
+	for (std::size_t i=0; i<solar.size(); i++) {
+		if (solar[i].second.term>=TERMS) {
+			throw INVALID_PARAM(solar[i].second.term);
+		}
+		append(body,(uint8_t)solar[i].second.term);
+	}
+	for (std::size_t i=solar.size(); i%4; i++) append(body,(uint8_t)0);
+	for (std::size_t i=0; i<holiday.size(); i++) {
+		append(body,(int32_t)holiday[i].first);
+	}
+	for (std::size_t i=0; i<holiday.size(); i++) {
+		std::map<std::string,uint32_t>::const_iterator j=
+			interned.find(holiday[i].second);
+		if (j==interned.end()) {
+			j=interned.insert(std::make_pair(holiday[i].second,
+											 (uint32_t)pool.size())).first;
+			pool.append(holiday[i].second.c_str(),
+						holiday[i].second.size()+1);
+		}
+		append(body,j->second);
+	}
+	body+=pool;
+
+	FileHeader h;
+	std::memcpy(h.magic,MAGIC,sizeof(MAGIC));
+	h.version=VERSION;
+	h.byteOrder=BYTE_ORDER_MARK;
+	h.checksum=fnv1a(reinterpret_cast<unsigned char const*>(body.data()),
+					 body.size());
+	h.solarCount=solar.size();
+	h.holidayCount=holiday.size();
+	h.poolSize=pool.size();
+	out.write(reinterpret_cast<char const*>(&h),sizeof(h));
+	out.write(body.data(),body.size());
+}
+
+/**
+ * @brief read solar terms from CSV
+ *
+ * Lines that do not parse are reported and skipped, blank lines are
+ * skipped silently.
+ *
+ * @param[in] file plain text stream, per line: year,month,day,hour,minute
+ * @param[out] solar solar terms read, not numbered; a later line for the
+ * same date replaces an earlier one
+ * @param[out] err stream for "line N: reason" messages about bad lines
+ *
+ * @return number of bad lines
+ */
+unsigned long
+readSolarCSV(std::istream& file, SolarList& solar, std::ostream& err)
+{
+#ifdef DEBUG
+	MY_ERR << "readSolarCSV((istream*)" << &file << ") called." << std::endl;
+#endif
+	LineScanner scan(file);
+	unsigned long bad=0;
+	solar.clear();
+	while (scan.nextLine()) {
+		if (scan.blank()) continue;
+		int mjd;
+		unsigned int hour, minute;
+		char const* why=scan.readDate(mjd);
+		if (!why) why=scan.readNumber(hour,true);
+		if (!why) why=scan.readNumber(minute,false);
+		if (!why && ((hour>=24) || (minute>=60))) why="invalid time";
+		if (!why) why=scan.end();
+		if (why) {
+			err << "line " << scan.getLineNumber() << ": " << why << std::endl;
+			bad++;
+			continue;
+		}
+		SolarTime const t={hour*60+minute,UNNUMBERED_TERM};
+		solar.push_back(std::make_pair(mjd,t));
+	}
+	sortUnique(solar);
+	return bad;
+}
+
+/**
+ * @brief read public holidays from CSV
+ *
+ * Lines that do not parse are reported and skipped, blank lines are
+ * skipped silently.
+ *
+ * @param[in] file plain text stream, per line: year,month,day,description;
+ * the description is the rest of the line less surrounding blanks, and may
+ * hold blanks and commas
+ * @param[out] holiday public holidays read; a later line for the same date
+ * replaces an earlier one
+ * @param[out] err stream for "line N: reason" messages about bad lines
+ *
+ * @return number of bad lines
+ */
+unsigned long
+readPublicHolidayCSV(std::istream& file, HolidayList& holiday,
+					 std::ostream& err)
+{
+#ifdef DEBUG
+	MY_ERR << "readPublicHolidayCSV((istream*)" << &file << ") called."
+		   << std::endl;
+#endif
+	LineScanner scan(file);
+	unsigned long bad=0;
+	holiday.clear();
+	while (scan.nextLine()) {
+		if (scan.blank()) continue;
+		int mjd;
+		char const* desc;
+		std::size_t length;
+		char const* why=scan.readDate(mjd);
+		if (!why) why=scan.readRest(desc,length);
+		if (why) {
+			err << "line " << scan.getLineNumber() << ": " << why << std::endl;
+			bad++;
+			continue;
+		}
+		holiday.push_back(std::make_pair(mjd,std::string(desc,length)));
+	}
+	sortUnique(holiday);
+	return bad;
+}
+
+/**
+ * @brief read public holidays from CSV straight into a bitmap and names
+ *
+ * As readPublicHolidayCSV(std::istream&, HolidayList&, std::ostream&), but
+ * each description is interned from the line buffer, with no std::string
+ * or HolidayList in between.  Days outside the range of DayBitmap are
+ * skipped.  Lines in date order are appended; a line out of order is put
+ * in place with DayBitmap::insert(), which is slower but rare.
+ *
+ * @param[in] file plain text stream, per line: year,month,day,description
+ * @param[out] holiday public holidays read, indexed on return
+ * @param[out] name descriptions in date order, indexed by rank in holiday
+ * @param[out] err stream for "line N: reason" messages about bad lines
+ *
+ * @return number of bad lines
+ */
+unsigned long
+readPublicHolidayCSV(std::istream& file, DayBitmap& holiday,
+					 std::vector<InternedString>& name, std::ostream& err)
+{
+#ifdef DEBUG
+	MY_ERR << "readPublicHolidayCSV((istream*)" << &file
+		   << ",(DayBitmap*)" << &holiday << ") called." << std::endl;
+#endif
+	LineScanner scan(file);
+	unsigned long bad=0;
+	holiday.clear();
+	name.clear();
+	int last=DayBitmap::firstMJD()-1;
+	bool indexed=true;
+	while (scan.nextLine()) {
+		if (scan.blank()) continue;
+		int mjd;
+		char const* desc;
+		std::size_t length;
+		char const* why=scan.readDate(mjd);
+		if (!why) why=scan.readRest(desc,length);
+		if (why) {
+			err << "line " << scan.getLineNumber() << ": " << why << std::endl;
+			bad++;
+			continue;
+		}
+		if (!DayBitmap::covers(mjd)) continue;
+		Date const d(mjd);
+		if (mjd>last) {
+			holiday.set(d);
+			name.push_back(InternedString(desc,length));
+			last=mjd;
+			indexed=false;
+			continue;
+		}
+		// a later line for the same date replaces an earlier one
+		if (!indexed) {
+			holiday.buildIndex();
+			indexed=true;
+		}
+		std::size_t const i=holiday.rank(d);
+		if (holiday.test(d)) {
+			name[i]=InternedString(desc,length);
+		}
+		else {
+			name.insert(name.begin()+i,InternedString(desc,length));
+			holiday.insert(d);
+		}
+	}
+	if (!indexed) holiday.buildIndex();
+	return bad;
+}
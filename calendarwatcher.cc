@@ -0,0 +1,151 @@
+/**
+ * @file calendarwatcher.cc
+ *
+ * Time-stamp: <2026-10-17 20:12:55 +0800 by kerwin>
+ *
+ * Background reload of the data files when they change on disk
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "include/debug.h"
+#include "include/calendarwatcher.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+	const int WATCH_SETTLE_MS = 50;
+	///< quiet time after the last event before reloading
+
+	/**
+	 * @brief check if a file name is one of the data files
+	 *
+	 * @param name file name without directory
+	 *
+	 * @retval true for solar.dat, pubhol.dat and calendar.bin
+	 * @retval false otherwise
+	 */
+	bool
+	isDataFile(char const* name)
+	{
+		return !std::strcmp(name,"solar.dat") ||
+			!std::strcmp(name,"pubhol.dat") ||
+			!std::strcmp(name,"calendar.bin");
+	}
+
+	/**
+	 * @brief read pending inotify events
+	 *
+	 * @param fd inotify descriptor, non-blocking
+	 *
+	 * @retval true if some event was about a data file
+	 * @retval false otherwise
+	 */
+	bool
+	drainEvents(int fd)
+	{
+		bool res=false;
+		alignas(struct inotify_event) char buf[4096];
+		ssize_t n;
+		while ((n=read(fd,buf,sizeof(buf)))>0) {
+			for (char* p=buf; p<buf+n; ) {
+				struct inotify_event const* e=
+					reinterpret_cast<struct inotify_event const*>(p);
+				if (e->len && isDataFile(e->name)) res=true;
+				p+=sizeof(struct inotify_event)+e->len;
+			}
+		}
+		return res;
+	}
+}
+
+/**
+ * @brief start watching a directory
+ *
+ * Throws Exception if inotify is not available or the directory cannot be
+ * watched.
+ *
+ * @param directory where the data files are, the current directory by
+ * default; should be the one CalendarData::getDefault() was loaded from
+ */
+CalendarWatcher::CalendarWatcher(std::string const& directory) :
+	_directory(directory), _inotify(-1), _reloads(0)
+{
+#ifdef DEBUG
+	MY_ERR << "CalendarWatcher::CalendarWatcher(" << directory << ") called."
+		   << std::endl;
+#endif
+	_inotify=inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_inotify<0) {
+		throw Exception("Cannot start inotify");
+	}
+	if (inotify_add_watch(_inotify,directory.c_str(),
+						  IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE)<0) {
+		::close(_inotify);
+		throw Exception("Cannot watch data directory");
+	}
+	if (pipe2(_stop,O_CLOEXEC)<0) {
+		::close(_inotify);
+		throw Exception("Cannot create pipe");
+	}
+	_thread=std::thread(&CalendarWatcher::run,this);
+}
+
+/**
+ * @brief stop watching, waits for a reload in progress
+ */
+CalendarWatcher::~CalendarWatcher()
+{
+	char c=0;
+	while ((write(_stop[1],&c,1)<0) && (errno==EINTR)) {}
+	_thread.join();
+	::close(_stop[0]);
+	::close(_stop[1]);
+	::close(_inotify);
+}
+
+/**
+ * @brief body of the background thread
+ *
+ * Waits for events, lets a burst of them settle, then reloads and
+ * publishes.  Returns when the stop pipe becomes readable, or if poll()
+ * fails other than by a signal; the data then stays as last published.
+ *
+ * This function takes no argument.
+ */
+void
+CalendarWatcher::run()
+{
+	struct pollfd fds[2]={{_inotify,POLLIN,0},{_stop[0],POLLIN,0}};
+	bool pending=false;
+	for (;;) {
+		int n=poll(fds,2,pending ? WATCH_SETTLE_MS : -1);
+		if (n<0) {
+			if (errno==EINTR) continue;
+#ifdef DEBUG
+			MY_ERR << this << "->CalendarWatcher::run(): poll failed, "
+				   << std::strerror(errno) << "; no longer watching."
+				   << std::endl;
+#endif
+			return;
+		}
+		if (fds[1].revents) return;
+		if (n>0) {
+			if (drainEvents(_inotify)) pending=true;
+			continue;
+		}
+		// quiet for WATCH_SETTLE_MS after the last event
+		pending=false;
+		try {
+			CalendarData::publish(CalendarData::load(_directory));
+			_reloads++;
+		}
+		catch (...) {
+			// keep the old data and wait for the next change
+		}
+	}
+}
@@ -10,21 +10,45 @@
  */
 
 #include "include/date.h"
+#include "include/lunation.h"
+#include <map>
+#include <mutex>
+#include <vector>
 
 /* constants goes in an anonymous namespace */
 namespace {
 	// Using the (Chinese-American) convention
 	// Chinese calendar year 1 in 2698 BCE.
-	const int CHINESE_CALENDAR_BEGIN=2698;
-	// JD data for CNY
-	const int GREGORIAN_ZERO_JULIAN_OFFSET = 1721425; // JD of Greg 0001-01-00 12h
-	const int DAYS_IN_FOUR_CENTURY = 400*365+97*1;	  // 4 Gregorian century
-	const int DAYS_IN_HALF_CENTURY = 365*50+12;		  // 50 year with 12 leap
-	const int DAYS_IN_FOUR_YEAR = 365*4+1;			  // 4 year, 1 leap
-	const int LUNAR_TABLE_START_MJD = 0x3C4A;						 // 1901CNY
-	const int LUNAR_TABLE_END_MJD= 0x1121B+DAYS_IN_HALF_CENTURY-365; // 2099EOY
-/*
-const unsigned long long LUNAR_TABLE[] = {
+	constexpr int CHINESE_CALENDAR_BEGIN=2698;
+	// MJD range covered by the lunar table
+	constexpr int LUNAR_TABLE_START_MJD = mjdFromGregorian(1901,2,19); // 1901CNY
+	constexpr int LUNAR_TABLE_END_MJD = mjdFromGregorian(2099,12,31);  // 2099EOY
+	constexpr int LUNAR_TABLE_YEARS = 2099-1901+1;
+	// MJD range with a Chinese date, the table or LunationEngine
+	constexpr int LUNAR_START_MJD =
+		mjdFromGregorian(LunationEngine::FIRST_YEAR,1,1);
+	constexpr int LUNAR_END_MJD =
+		mjdFromGregorian(LunationEngine::LAST_YEAR,12,31);
+	// at most 13 months per Chinese year
+	constexpr int LUNAR_MONTH_COUNT_MAX = 13*LUNAR_TABLE_YEARS;
+	static_assert(LUNAR_TABLE_START_MJD==0x3C4A, "1901 CNY is MJD 0x3C4A");
+	static_assert(Date()==Date(2012,1,15), "default Date is 2012-1-15");
+	static_assert(Date(2012,1,1).getDayOfWeek()==Date::DOW_SUNDAY,
+				  "2012-1-1 is a Sunday");
+	static_assert(Date(2012,1,1)==Date(2011,12,19,Date::CALTYPE_JULIAN),
+				  "Julian calendar is 13 days behind");
+	// days the Julian calendar is behind from 1900-03-01 to 2100-02-28
+	constexpr int JULIAN_LAG = 13;
+	static_assert(mjdFromJulian(1901,2,19)==LUNAR_TABLE_START_MJD+JULIAN_LAG &&
+				  mjdFromJulian(2099,12,31)==LUNAR_TABLE_END_MJD+JULIAN_LAG,
+				  "Julian lag constant over the lunar table");
+
+	// Chinese calendar for each Gregorian year, encoded as
+	//   (value >> 20)        = intercalary month
+	//   (value >> 7) & 0x1FFF = month 1--13 has 30 days, month 1 highest
+	//   (value >> 5) & 0x3    = Gregorian month of CNY
+	//   (value & 0x1F)        = Gregorian day of CNY
+	constexpr unsigned long long LUNAR_TABLE[] = {
 		0x04AE53,0x0A5748,0x5526BD,0x0D2650,0x0D9544,0x46AAB9,0x056A4D,0x09AD42,0x24AEB6,0x04AE4A,//1901-1910
 		0x6A4DBE,0x0A4D52,0x0D2546,0x5D52BA,0x0B544E,0x0D6A43,0x296D37,0x095B4B,0x749BC1,0x049754,//1911-1920
 		0x0A4B48,0x5B25BC,0x06A550,0x06D445,0x4ADAB8,0x02B64D,0x095742,0x2497B7,0x04974A,0x664B3E,//1921-1930
@@ -45,63 +69,67 @@ const unsigned long long LUNAR_TABLE[] = {
 		0x8A95BF,0x0A9553,0x0B4A47,0x6B553B,0x0AD54F,0x055A45,0x4A5D38,0x0A5B4C,0x052B42,0x3A93B6,//2071-2080
 		0x069349,0x7729BD,0x06AA51,0x0AD546,0x54DABA,0x04B64E,0x0A5743,0x452738,0x0D264A,0x8E933E,//2081-2090
 		0x0D5252,0x0DAA47,0x66B53B,0x056D4F,0x04AE45,0x4A4EB9,0x0A4D4C,0x0D1541,0x2D92B5          //2091-2099
-};
+	};
+/**
+ * @brief MJD of Gregorian January 0 that the CNY offsets count from
+ *
+ * @param year Gregorian year
+ *
+ * @return MJD of January 0 of the year rounded down to 1 mod 50
  */
-	const unsigned long long CHINESE_JULIAN_DAY[] =
+	constexpr
+	int
+	lunarTableBase(int year)
 	{
-		// This table is automatically generated from LUNAR_TABLE
-			// 1901-1-0 is MJD 0x3C18
-			// 1951-1-0 is MJD 0x836E
-			// 2001-1-0 is MJD 0xCAC5
-			// 2051-1-0 is MJD 0x1121B
-			// 0xF0000000 = leap month
-			// 0x08000000 = 1st month big?
-			// 0x00010000 = 12th month big?
-			// 0x00008000 = 13th month big?
-			// 0x00007FFF = modified julian day of CNY offset
-//1901-1910
-0x04AE0032,0x0A570194,0x552682F7,0x0D260476,0x0D9505D8,0x46AA873B,0x056A08BB,0x09AD0A1D,0x24AE8B80,0x04AE0D00,
-//1911-1920
-0x6A4D8E62,0x0A4D0FE2,0x0D251144,0x5D5292A6,0x0B541426,0x0D6A1588,0x296D16EB,0x095B186B,0x749B99CE,0x04971B4E,
-//1921-1930
-0x0A4B1CB0,0x5B259E12,0x06A51F92,0x06D420F4,0x4ADAA256,0x02B623D7,0x09572539,0x2497A69C,0x0497281C,0x664B297E,
-//1931-1940
-0x0D4A2AFD,0x0EA52C5F,0x56D4ADC2,0x05AD2F42,0x02B630A5,0x39373207,0x092E3387,0x7C96B4E9,0x0C953669,0x0D4A37CB,
-//1941-1950
-0x6DA5392D,0x0B553AAD,0x056A3C10,0x4AADBD72,0x025D3EF3,0x092D4055,0x2C95C1B7,0x0A954337,0x7B4AC499,0x06CA4619,
-//1951-1960
-0x0B550025,0x555A8188,0x04DA0308,0x0A5B046A,0x352B85CD,0x052B074D,0x8A9508AF,0x0E950A2E,0x06AA0B91,0x6AD50CF3,
-//1961-1970
-0x0AB50E73,0x04B60FD6,0x4A571138,0x0A5712B8,0x0526141B,0x3E93157C,0x0D9516FC,0x75AA985F,0x056A19DF,0x096D1B41,
-//1971-1980
-0x54AE9CA4,0x04AD1E24,0x0A4D1F86,0x4D26A0E8,0x0D252268,0x8D52A3CA,0x0B54254A,0x0B6A26AC,0x696D280F,0x095B298F,
-//1981-1990
-0x049B2AF2,0x4A4BAC54,0x0A4B2DD4,0xAB25AF36,0x06A530B6,0x06D43218,0x6ADA337A,0x0AB634FA,0x0937365D,0x5497B7C0,
-//1991-2000
-0x04973940,0x064B3AA2,0x36A53C04,0x0EA53D83,0x86B2BEE6,0x05AC4066,0x0AB641C8,0x5936C32B,0x092E44AB,0x0C96460D,
-//2001-2010
-0x4D4A8018,0x0D4A0198,0x0DA502FA,0x25AA845D,0x056A05DD,0x7AAD873F,0x025D08C0,0x092D0A22,0x5C958B84,0x0A950D04,
-//2011-2020
-0x0B4A0E66,0x4B550FC8,0x0AD51148,0x955A92AB,0x04BA142B,0x0A5B158D,0x652B96F0,0x052B1870,0x0A9319D2,0x474A9B34,
-//2021-2030
-0x06AA1CB4,0x0AD51E16,0x24DA9F79,0x04B620F9,0x6957225B,0x0A4E23DB,0x0D26253D,0x5E93269F,0x0D53281F,0x05AA2982,
-//2031-2040
-0x36B52AE4,0x096D2C64,0xB4AEADC7,0x04AD2F47,0x0A4D30A9,0x6D25B20B,0x0D25338B,0x0D5234ED,0x5DAA364F,0x0B5A37CF,
-//2041-2050
-0x056D3932,0x24ADBA95,0x049B3C15,0x7A4BBD77,0x0A4B3EF7,0x0AA54059,0x5B52C1BB,0x06D2433B,0x0ADA449D,0x355B4600,
-//2051-2060
-0x0937002A,0x8497818D,0x0497030D,0x064B046F,0x66A505D1,0x0EA50750,0x06B208B3,0x4AB60A15,0x0AAE0B95,0x092E0CF8,
-//2061-2070
-0x3C970E5A,0x0C960FDA,0x7D4A913C,0x0D4A12BC,0x0DA5141E,0x55AA9581,0x056A1701,0x0A6D1863,0x452E99C6,0x052D1B46,
-//2071-2080
-0x8A959CA8,0x0A951E28,0x0B4A1F8A,0x6B5520EC,0x0AD5226C,0x055A23CF,0x4A5D2531,0x0A5B26B1,0x052B2814,0x3A93A976,
-//2081-2090
-0x06932AF6,0x7729AC58,0x06AA2DD8,0x0AD52F3A,0x54DAB09D,0x04B6321D,0x0A57337F,0x452734E2,0x0D263661,0x8E9337C3,
-//2091-2100
-0x0D523943,0x0DAA3AA5,0x66B53C08,0x056D3D88,0x04AE3EEB,0x4A4EC04D,0x0A4D41CD,0x0D15432F,0x2D92C491
+		return mjdFromGregorian(1+50*((year-1)/50),1,0);
+	}
+	static_assert(lunarTableBase(1901)==0x3C18 && lunarTableBase(1951)==0x836E &&
+				  lunarTableBase(2001)==0xCAC5 && lunarTableBase(2051)==0x1121B,
+				  "lunar table bases");
+
+/**
+ * @brief CHINESE_JULIAN_DAY, generated from LUNAR_TABLE at compile time
+ *
+ * See Date::getLunarCalendarData(unsigned int) for the encoding.
+ */
+	struct ChineseJulianDayTable {
+		unsigned long long value[LUNAR_TABLE_YEARS];
+		///< one element per Gregorian year from 1901
+			/**
+			 * @brief re-encode LUNAR_TABLE, replacing the Gregorian month
+			 * and day of CNY by its MJD offset from lunarTableBase()
+			 */
+		constexpr ChineseJulianDayTable() : value()
+		{
+			for (int y=0; y<LUNAR_TABLE_YEARS; y++) {
+				unsigned long long l=LUNAR_TABLE[y];
+				value[y]=((l>>7)<<15) |
+					(mjdFromGregorian(1901+y,(l>>5) & 3,l & 0x1F)
+					 -lunarTableBase(1901+y));
+			}
+		}
+			/**
+			 * @brief element for Gregorian year 1901+i
+			 * @param i year offset from 1901
+			 * @return table element
+			 */
+		constexpr unsigned long long operator[](int i) const
+		{
+			return value[i];
+		}
 	};
+	constexpr ChineseJulianDayTable CHINESE_JULIAN_DAY;
+	static_assert(sizeof(LUNAR_TABLE)/sizeof(LUNAR_TABLE[0])==LUNAR_TABLE_YEARS,
+				  "LUNAR_TABLE covers 1901-2099");
+	static_assert(CHINESE_JULIAN_DAY[1901-1901]==0x04AE0032 &&
+				  CHINESE_JULIAN_DAY[1950-1901]==0x06CA4619 &&
+				  CHINESE_JULIAN_DAY[1951-1901]==0x0B550025 &&
+				  CHINESE_JULIAN_DAY[2012-1901]==0x4B550FC8 &&
+				  CHINESE_JULIAN_DAY[2051-1901]==0x0937002A &&
+				  CHINESE_JULIAN_DAY[2099-1901]==0x2D92C491,
+				  "CHINESE_JULIAN_DAY matches the old hand generated table");
 
-	const unsigned int doyOffset[][2]=
+	constexpr unsigned int doyOffset[][2]=
 	{
 		{0,0},					// January
 		{31,31},				// February
@@ -118,9 +146,63 @@ const unsigned long long LUNAR_TABLE[] = {
 		{365,366}				// next January - for convenience
 	};
 
+/**
+ * @brief check doyOffset against daysInMonth()
+ * @return true if every row is the sum of the month lengths before it
+ */
+	constexpr
+	bool
+	doyOffsetConsistent()
+	{
+		for (unsigned int m=1; m<=12; m++) {
+			if (doyOffset[m][0]!=doyOffset[m-1][0]+daysInMonth(2001,m) ||
+				doyOffset[m][1]!=doyOffset[m-1][1]+daysInMonth(2000,m)) {
+				return false;
+			}
+		}
+		return true;
+	}
+	static_assert(doyOffsetConsistent(), "doyOffset matches daysInMonth");
+
+/**
+ * @brief table element for a year outside the table, from LunationEngine
+ *
+ * Each year is worked out once and kept, packed like CHINESE_JULIAN_DAY,
+ * for the rest of the process.  Throws INVALID_PARAM if year is outside
+ * LunationEngine::FIRST_YEAR-1 to LunationEngine::LAST_YEAR.
+ *
+ * @param year Gregorian year
+ * @return table element
+ */
+	unsigned long long
+	derivedLunarYear(int year)
+	{
+		static std::mutex lock;
+		static std::map<int,unsigned long long> derived;
+		{
+			std::lock_guard<std::mutex> l(lock);
+			std::map<int,unsigned long long>::const_iterator i=
+				derived.find(year);
+			if (i!=derived.end()) return i->second;
+		}
+		int newYear;
+		unsigned int leap, longMonths;
+		LunationEngine::getChineseYear(year,newYear,leap,longMonths);
+		unsigned long long c=((unsigned long long)leap<<28) |
+			((unsigned long long)longMonths<<15) |
+			(newYear-lunarTableBase(year));
+		std::lock_guard<std::mutex> l(lock);
+		derived.insert(std::make_pair(year,c));
+		return c;
+	}
+
 /**
  * @brief safer way to access table
- * @param year Gregorian year (between 1901 and 2099 inclusive)
+ *
+ * Years outside 1901--2099 are worked out by LunationEngine.
+ *
+ * @param year Gregorian year (between LunationEngine::FIRST_YEAR-1 and
+ * LunationEngine::LAST_YEAR inclusive)
  * @return table element
  */
 	inline
@@ -136,119 +218,93 @@ const unsigned long long LUNAR_TABLE[] = {
 			return CHINESE_JULIAN_DAY[year-1901];
 		}
 		else {
-			throw INVALID_PARAM(year);
+			return derivedLunarYear(year);
 		}
 	}
 
-		/**
-		 * @brief compute modified julian day number for Gregorian date
-		 *
-		 * MJD 0 starts at Gregorian 1858-11-17 0h (Wednesday).
-		 *
-		 * algorithm as follows
-		 @verbatim
-		 a = (14-month)/12
-		 y = year+4800-a
-		 m = month + 12*a - 3
-
-		 For a date in the Gregorian calendar:
-		 MJD = day + (153*m+2)/5 + y*365 + y/4 - y/100 + y/400 - 2432046
-		 @endverbatim
-		 *
-		 * @param year Gregorian year of date
-		 * @param month Gregorian month of date
-		 * @param day Gregorian day of date
-		 *
-		 * @return julian day number
-		 */
-	inline
+
+/**
+ * @brief modified julian day of Chinese New Year from a table element
+ *
+ * The low 15 bits of the table element are an offset from Gregorian
+ * January 0 of the year rounded down to 1 mod 50, see
+ * Date::getLunarCalendarData(unsigned int).
+ *
+ * @param year Gregorian year
+ * @param c    table element for that year
+ *
+ * @return modified julian day of Chinese New Year
+ */
+	constexpr
 	int
-	mjdFromGregorian(int year, unsigned int month, unsigned int day)
+	cnyFromTable(int year, unsigned long long c)
 	{
-		unsigned int a=(14-month)/12;
-		unsigned int y=year+4800-a;
-		unsigned int m=month+12*a-3;
-		int jd=day+(153*m+2)/5+y*365+y/4-y/100+y/400-32045;
-		return jd-2400001;
+		return (c & 0x7FFF)+lunarTableBase(year);
 	}
 
-		/**
-		 * @brief compute modified julian day number for Julian date
-		 *
-		 * JD 0 starts at noon 1 January 4713BC in the Julian calendar.
-		 * MJD = JD - 2400000.5
-		 *
-		 * algorithm as follows
-		 @verbatim
-		 a = (14-month)/12
-		 y = year+4800-a
-		 m = month + 12*a - 3
-
-		 JD = day + (153*m+2)/5 + y*365 + y/4 - 32083
-		 @endverbatim
-		 *
-		 * @param year Julian calendar year of date
-		 * @param month Julian calendar month of date
-		 * @param day Julian calendar day of date
-		 *
-		 * @return modified julian day number
-		 */
-	inline
-	int
-	mjdFromJulian(int year, unsigned int month, unsigned int day)
+/**
+ * @brief label of the j-th month of a Chinese year
+ *
+ * @param leap month followed by an intercalary month, 0 for none
+ * @param j    position of the month in the year, 1 for the first
+ *
+ * @return month number, plus 16 if intercalary
+ */
+	constexpr
+	unsigned int
+	lunarMonthLabel(unsigned int leap, unsigned int j)
 	{
-		unsigned int a=(14-month)/12;
-		unsigned int y=year+4800-a;
-		unsigned int m=month+12*a-3;
-		int jd=day+(153*m+2)/5+y*365+y/4-32083;
-		return jd-2400001;
+		return (leap && j>leap) ? ((j==leap+1) ? leap+16 : j-1) : j;
 	}
 
-		/**
-		 * @brief lookup/compute modified julian day number for Chinese date
-		 *
-		 * @param year  Chinese calendar year of date
-		 * @param month Chinese calendar month of date
-		 * @param day   Chinese calendar day of date
-		 *
-		 * @return modified julian day number
-		 */
-	inline
-	int
-	mjdFromChinese(int year, unsigned int month, unsigned int day)
-	{
-			// first look up the table for that chinese year
-		unsigned long long c=LunarCalendarTable(year-CHINESE_CALENDAR_BEGIN);
-			// cny from offset
-		int res=(c & 0x7FFF);
-			// check leap
-		if ((c>>28) && month>(c>>28)) {
-			month++;
-			if(month>16) month-=16;
-		}
-			// adding offset
-		if (year>2050) {
-			res+=0x1121B;
-		}
-		else if (year>2000) {
-			res+=0xCAC5;
-		}
-		else if (year>1950) {
-			res+=0x836E;
-		}
-		else {
-			res+=0x3C18;
-		}
-			// add months
-		for (unsigned int j=1; j<month; j++) {
-			res+=(c & ((1<<28)>>j))? 30 : 29;
+/**
+ * @brief start of every Chinese month between 1901 and 2099
+ *
+ * Each month is packed in one 32 bit word as
+@verbatim
+	(value >> 13)        = modified julian day of the first day of the month
+	(value >> 5) & 0xFF  = Gregorian year of its CNY - 1901
+	(value & 0x1F)       = month number, plus 16 if intercalary
+@endverbatim
+ * so the words sort by start day.  The whole index is about 10kB.
+ */
+	struct LunarMonthIndex {
+		unsigned int month[LUNAR_MONTH_COUNT_MAX];
+		///< packed months, sorted by start day
+		unsigned short yearStart[LUNAR_TABLE_YEARS+1];
+		///< index into month of the first month of each year
+		int count;
+		///< number of months in the table
+			/**
+			 * @brief expand CHINESE_JULIAN_DAY, at compile time
+			 */
+		constexpr LunarMonthIndex() : month(), yearStart(), count(0)
+		{
+			for (int y=0; y<LUNAR_TABLE_YEARS; y++) {
+				unsigned long long c=CHINESE_JULIAN_DAY[y];
+				unsigned int leap=c>>28;
+				int start=cnyFromTable(1901+y,c);
+				yearStart[y]=count;
+				for (unsigned int j=1; j<=(leap?13u:12u); j++) {
+					month[count++]=(start<<13) | (y<<5) | lunarMonthLabel(leap,j);
+					start+=(c & ((1<<28)>>j))? 30 : 29;
+				}
+			}
+			yearStart[LUNAR_TABLE_YEARS]=count;
 		}
-		return res+day-1;
-	}
+	};
+	constexpr LunarMonthIndex LUNAR_MONTH_INDEX;
+	static_assert((int)(LUNAR_MONTH_INDEX.month[0]>>13)==LUNAR_TABLE_START_MJD,
+				  "first month starts on 1901 CNY");
+	static_assert((int)(LUNAR_MONTH_INDEX.month[LUNAR_MONTH_INDEX.yearStart[2012-1901]]>>13)
+				  ==mjdFromGregorian(2012,1,23), "CNY 2012 is 23 January");
+	static_assert((int)(LUNAR_MONTH_INDEX.month[LUNAR_MONTH_INDEX.count-2]>>13)
+				  <=LUNAR_TABLE_END_MJD, "every month up to 2099-12-31 indexed");
+
 
 		// julian day to gregorian
 /**
- * @brief compute julian day number for date at noon
+ * @brief compute Gregorian date from julian day number for date at noon
  *
  * JD 0 starts at noon 1 January 4713BC in the Julian calendar.
  *
@@ -268,45 +324,31 @@ const unsigned long long LUNAR_TABLE[] = {
      year  = b*100 + d - 4800 + m/10
 @endverbatim
  *
- * @param jd Julian Day
- * @param dp enum indicating the requested part (only DATEPART_GREGORIAN_* is supposed to be here).
+ * All three parts are computed together and nothing is cached, so this is
+ * safe to call from several threads.
  *
- * @return Gregorian date part requested
+ * @param jd Julian Day
+ * @param[out] year  Gregorian year
+ * @param[out] month Gregorian month
+ * @param[out] day   Gregorian day
  */
-	int gregorianFromJD(int jd, enum Date::DatePart dp)
+	inline
+	void
+	gregorianFromJD(int jd, int& year, unsigned int& month, unsigned int& day)
 	{
-		static int _myjd,_myYear,_myMonth,_myDay,res;
-		if (_myjd!=jd) {
-			int a = jd + 32044,
-				b = (4*a+3)/146097,
-				c = a - (b*146097)/4,
-				d = (4*c+3)/1461,
-				e = c - (1461*d)/4,
-				m = (5*e+2)/153;
-			_myDay = e - (153*m+2)/5 + 1;
-			_myMonth = m + 3 - 12*(m/10);
-			_myYear  = b*100 + d - 4800 + m/10;
-			_myjd=jd;
-		}
-		switch(dp){
-			case Date::DATEPART_GREGORIAN_YEAR :
-				res=_myYear;
-				break;
-			case Date::DATEPART_GREGORIAN_MONTH :
-				res=_myMonth;
-				break;
-			case Date::DATEPART_GREGORIAN_DAY :
-				res = _myDay;
-				break;
-			default:
-					// shouldn't be here
-				res=0;
-		};
-		return res;
+		int a = jd + 32044,
+			b = (4*a+3)/146097,
+			c = a - (b*146097)/4,
+			d = (4*c+3)/1461,
+			e = c - (1461*d)/4,
+			m = (5*e+2)/153;
+		day   = e - (153*m+2)/5 + 1;
+		month = m + 3 - 12*(m/10);
+		year  = b*100 + d - 4800 + m/10;
 	}
 
 /**
- * @brief compute julian day number for date at noon
+ * @brief compute Julian calendar date from julian day number for date at noon
  *
  * JD 0 starts at noon 1 January 4713BC in the Julian calendar.
  *
@@ -325,265 +367,322 @@ const unsigned long long LUNAR_TABLE[] = {
 @endverbatim
  *
  * @param jd Julian Day
- * @param dp enum indicating the requested part (only DATEPART_JULIAN_* is supposed to be here).
- *
- * @return requested Julian calendar part
+ * @param[out] year  Julian calendar year
+ * @param[out] month Julian calendar month
+ * @param[out] day   Julian calendar day
  */
-	int julianFromJD(int jd, enum Date::DatePart dp)
+	inline
+	void
+	julianFromJD(int jd, int& year, unsigned int& month, unsigned int& day)
 	{
-		static int _myjd,_myYear,_myMonth,_myDay,res;
-		if (_myjd!=jd) {
-			int b = 0,
-				c = jd + 32082,
-				d = (4*c+3)/1461,
-				e = c - (1461*d)/4,
-				m = (5*e+2)/153;
-			_myDay = e - (153*m+2)/5 + 1;
-			_myMonth = m + 3 - 12*(m/10);
-			_myYear  = b*100 + d - 4800 + m/10;
-			_myjd=jd;
-		}
-		switch(dp){
-			case Date::DATEPART_JULIAN_YEAR :
-				res=_myYear;
-				break;
-			case Date::DATEPART_JULIAN_MONTH :
-				res=_myMonth;
-				break;
-			case Date::DATEPART_JULIAN_DAY :
-				res = _myDay;
-				break;
-			default:
-					// shouldn't be here
-				res=0;
-		};
-		return res;
+		int b = 0,
+			c = jd + 32082,
+			d = (4*c+3)/1461,
+			e = c - (1461*d)/4,
+			m = (5*e+2)/153;
+		day   = e - (153*m+2)/5 + 1;
+		month = m + 3 - 12*(m/10);
+		year  = b*100 + d - 4800 + m/10;
 	}
 
 /**
- * @brief compute chinese day and return
+ * @brief compute Chinese date from julian day number
  *
- * The intermediary result is cached, so it should help performance.
+ * Within the lunar table the month is found in the month index by
+ * interpolation: lunar months are so regular that the first guess is at
+ * most a month or two off.  Outside it the months of the year are walked
+ * from Chinese New Year.  Throws INVALID_PARAM outside
+ * LunationEngine::FIRST_YEAR to LunationEngine::LAST_YEAR.
  *
  * @param jd Julian Day number
- * @param dp the requested part of chinese date (DATEPART_CHINESE_*)
- *
- * @return requested part of Chinese date.
+ * @param[out] cyear  Chinese year
+ * @param[out] cmonth Chinese month, plus 16 if intercalary
+ * @param[out] cday   Chinese day
  */
-	int
-	chineseFromJD(int jd,enum Date::DatePart const dp)
+	void
+	chineseFromJD(int jd, int& cyear, unsigned int& cmonth, unsigned int& cday)
 	{
 #ifdef DEBUG
-		MY_ERR << "chineseFromJD(" << jd << "," << dp << ") called." << std::endl;
+		MY_ERR << "chineseFromJD(" << jd << ") called." << std::endl;
 #endif	// DEBUG
-		static int cyear,cmonth,cday,myjd;
-		int gyear;
-		if ((jd<LUNAR_TABLE_START_MJD+2400001) ||
-			(jd>LUNAR_TABLE_END_MJD+2400001)) {
+		if ((jd<LUNAR_START_MJD+2400001) || (jd>LUNAR_END_MJD+2400001)) {
 			throw INVALID_PARAM(jd);
 		}
-		while (jd != myjd) {
-#ifdef DEBUG
-			MY_ERR << "\tDate changed since last computed." << std::endl;
-#endif	// DEBUG
-			gyear=gregorianFromJD(jd,Date::DATEPART_GREGORIAN_YEAR);
-			cday=((jd-GREGORIAN_ZERO_JULIAN_OFFSET)   // days from 1AD-Jan-0
-				  % DAYS_IN_FOUR_CENTURY);				// extract 4 centuries
-			unsigned long long cCal = LunarCalendarTable(gyear);
-			if ((cCal & 0x7FFF)> (cday % DAYS_IN_HALF_CENTURY)) {
-#ifdef DEBUG
-			MY_ERR << "\tDate is before CNY, getting previous year." << std::endl;
-#endif	// DEBUG
-					// day before CNY of Gregorian year
-				gyear--;
-				cCal=LunarCalendarTable(gyear);
+		int mjd=jd-2400001;
+		if ((mjd<LUNAR_TABLE_START_MJD) || (mjd>LUNAR_TABLE_END_MJD)) {
+			int year;
+			unsigned int month, day;
+			gregorianFromJD(jd,year,month,day);
+			unsigned long long c=LunarCalendarTable(year);
+			int start=cnyFromTable(year,c);
+			if (mjd<start) {
+				c=LunarCalendarTable(--year);
+				start=cnyFromTable(year,c);
 			}
-			cyear = gyear + CHINESE_CALENDAR_BEGIN;
-			cday -= (cCal & 0x7FFF); // day from CNY, starting 0 at CNY
-#ifdef DEBUG
-			MY_ERR << "\t\tDate is " << cday << " days from CNY of year" << std::endl;
-#endif	// DEBUG
-
-				// now compute the month and day
-			int leap = cCal >> 28;
-				// now keep subtracting enough 29/30 days until we get there.
-			cmonth=1;
-			int curmonthlen=(cCal & ((1<<28)>>cmonth))?30:29;
-			while ((cday>=curmonthlen) && (cmonth<(leap?13:12))) {
-				cday-=curmonthlen;
-				cmonth++;
-				curmonthlen=(cCal & ((1<<28)>>cmonth))?30:29;
-			}
-			if((leap>0) && (cmonth>leap)){
-				cmonth--;
-				if (cmonth==leap) cmonth+=16;
+			unsigned int leap=c>>28;
+			unsigned int j=1;
+			for (;;) {
+				int length=(c & ((1<<28)>>j))? 30 : 29;
+				if (mjd<start+length) break;
+				start+=length;
+				j++;
 			}
-			cday++;
-			myjd = jd;
+			cyear = year + CHINESE_CALENDAR_BEGIN;
+			cmonth = lunarMonthLabel(leap,j);
+			cday = mjd - start + 1;
+			return;
 		}
+		LunarMonthIndex const& index=LUNAR_MONTH_INDEX;
+			// mean synodic month is 29.530589 days
+		int i=(mjd-LUNAR_TABLE_START_MJD)*1000/29531;
+		if (i>=index.count) i=index.count-1;
+		while ((int)(index.month[i]>>13) > mjd) i--;
+		while ((i+1<index.count) && ((int)(index.month[i+1]>>13) <= mjd)) i++;
 #ifdef DEBUG
-			MY_ERR << "\tComputation finished.  Deciding what to return." << std::endl;
+		MY_ERR << "\tDate is in month " << i << " of index" << std::endl;
 #endif	// DEBUG
-		switch(dp){
-			case Date::DATEPART_CHINESE_YEAR  : return cyear;
-			case Date::DATEPART_CHINESE_MONTH : return cmonth;
-			case Date::DATEPART_CHINESE_DAY   : return cday;
-			default :
-					//shouldn't be here
+		unsigned int m=index.month[i];
+		cyear = 1901 + ((m>>5) & 0xFF) + CHINESE_CALENDAR_BEGIN;
+		cmonth = m & 0x1F;
+		cday = mjd - (m>>13) + 1;
+	}
+
+#ifndef NO_DAYINFO_TABLE
+	const int DAYINFO_TABLE_SIZE = LUNAR_TABLE_END_MJD-LUNAR_TABLE_START_MJD+1;
+
+/**
+ * @brief compute the DayInfo of every day covered by the lunar table
+ *
+ * Walks the month index once, so the Chinese fields come for free.
+ *
+ * @param[out] table DAYINFO_TABLE_SIZE entries, indexed by
+ * mjd-LUNAR_TABLE_START_MJD
+ */
+	void
+	buildDayInfoTable(std::vector<DayInfo>& table)
+	{
 #ifdef DEBUG
-				MY_ERR << "\tError: requested date part is not handled by this method!" << std::endl;
-#endif	// DEBUG
-				throw INVALID_PARAM(dp);
+		MY_ERR << "anonymous_Date_namespace::buildDayInfoTable() called."
+			   << std::endl;
+#endif
+		table.resize(DAYINFO_TABLE_SIZE);
+		LunarMonthIndex const& index=LUNAR_MONTH_INDEX;
+		for (int i=0; i<index.count; i++) {
+			unsigned int m=index.month[i];
+			int start=m>>13;
+			int end=(i+1<index.count) ?
+				(int)(index.month[i+1]>>13) : LUNAR_TABLE_END_MJD+1;
+				// the last month of Chinese year 2099 starts in 2100
+			if (end>LUNAR_TABLE_END_MJD+1) end=LUNAR_TABLE_END_MJD+1;
+			for (int mjd=start; mjd<end; mjd++) {
+				DayInfo& info=table[mjd-LUNAR_TABLE_START_MJD];
+				int year;
+				unsigned int month, day;
+				gregorianFromJD(mjd+2400001,year,month,day);
+				info.gregorianYear=year-1900;
+				info.gregorianMonth=month;
+				info.gregorianDay=day;
+				info.dayOfWeek=(mjd+3)%7;
+				info.dayOfYear=doyOffset[month-1][isLeapYear(year)]+day;
+				info.chineseYear=((m>>5) & 0xFF)+1901-1900;
+				info.chineseMonth=m & 0x1F;
+				info.chineseDay=mjd-start+1;
+			}
 		}
 	}
 
+/**
+ * @brief the DayInfo table, built on first use
+ *
+ * This function takes no argument.
+ *
+ * @return pointer to the entry for LUNAR_TABLE_START_MJD
+ */
+	inline
+	DayInfo const*
+	dayInfoTable()
+	{
+		struct Builder {
+			std::vector<DayInfo> table;
+			Builder() { buildDayInfoTable(table); }
+		};
+		static const Builder b;
+		return &b.table[0];
+	}
+#endif	// NO_DAYINFO_TABLE
+
 }
 
 /**
  * @relatesalso Date
- * @brief compute Gregorian date from Modified Julian Date
- * @param mjd Modified Julian Date
- * @param dp part (DATEPART_GREGORIAN_*)
- * @return requested calendar part
+ * @brief lookup/compute modified julian day number for Chinese date
+ *
+ * @param year  Chinese calendar year of date
+ * @param month Chinese calendar month of date
+ * @param day   Chinese calendar day of date
+ *
+ * @return modified julian day number
  */
 int
-gregorianFromMJD(int mjd, enum Date::DatePart dp)
+mjdFromChinese(int year, unsigned int month, unsigned int day)
 {
-	return gregorianFromJD(mjd+2400001,dp);
+		// first look up the table for that chinese year
+	int gyear=year-CHINESE_CALENDAR_BEGIN;
+	unsigned long long c=LunarCalendarTable(gyear);
+		// check leap
+	if ((c>>28) && month>(c>>28)) {
+		month++;
+		if(month>16) month-=16;
+	}
+		// month start is then read off the index, or added up
+	if ((gyear>1900) && (gyear<2100)) {
+		int res=LUNAR_MONTH_INDEX.month[LUNAR_MONTH_INDEX.yearStart[gyear-1901]+month-1]>>13;
+		return res+day-1;
+	}
+	int res=cnyFromTable(gyear,c);
+	for (unsigned int j=1; j<month; j++) {
+		res+=(c & ((1<<28)>>j))? 30 : 29;
+	}
+	return res+day-1;
 }
 
 /**
  * @relatesalso Date
- * @brief compute Julian date from Modified Julian Date
+ * @brief compute Gregorian year, month and day from Modified Julian Date
  * @param mjd Modified Julian Date
- * @param dp part (DATEPART_JULIAN_*)
- * @return requested calendar part
+ * @param[out] year  Gregorian year
+ * @param[out] month Gregorian month
+ * @param[out] day   Gregorian day
  */
-int
-julianFromMJD(int mjd, enum Date::DatePart dp)
+void
+gregorianFromMJD(int mjd, int& year, unsigned int& month, unsigned int& day)
 {
-	return julianFromJD(mjd+2400001,dp);
+	DayInfo const* info=dayInfoFromMJD(mjd);
+	if (info) {
+		year=info->gregorianYear+1900;
+		month=info->gregorianMonth;
+		day=info->gregorianDay;
+		return;
+	}
+	gregorianFromJD(mjd+2400001,year,month,day);
 }
 
 /**
- * @brief constructor
+ * @relatesalso Date
+ * @brief compute Julian calendar year, month and day from Modified Julian Date
+ *
+ * Throughout the DayInfo table the Julian calendar is JULIAN_LAG days
+ * behind, so a day has the Julian date that the day JULIAN_LAG days
+ * earlier has in the Gregorian calendar, and that is read off the table.
  *
- * @param d (Modified) Julian Day (default: MJD 55941 = Gregorian 2012-1-1)
- * @param t Calendar to which day are measured MJD (default) or JD)
+ * @param mjd Modified Julian Date
+ * @param[out] year  Julian calendar year
+ * @param[out] month Julian calendar month
+ * @param[out] day   Julian calendar day
  */
-Date::Date(int d,
-		   enum CalendarType t)
+void
+julianFromMJD(int mjd, int& year, unsigned int& month, unsigned int& day)
 {
-	switch(t){
-		case CALTYPE_MJD :
-			_mjd = d;
-			break;
-		case CALTYPE_JD :
-			_mjd = d-2400001;
-			break;
-		default :
-				// shouldn't be here
-			throw INVALID_PARAM(t);
+	DayInfo const* info=dayInfoFromMJD(mjd-JULIAN_LAG);
+	if (info) {
+		year=info->gregorianYear+1900;
+		month=info->gregorianMonth;
+		day=info->gregorianDay;
+		return;
 	}
+	julianFromJD(mjd+2400001,year,month,day);
 }
 
 /**
- * @brief another constructor
+ * @relatesalso Date
+ * @brief compute Chinese year, month and day from Modified Julian Date
+ *
+ * Throws INVALID_PARAM if mjd is outside LunationEngine::FIRST_YEAR to
+ * LunationEngine::LAST_YEAR.
  *
- * @param year  year of desired date
- * @param month month of desired date
- * @param day   day of desired date
- * @param t     Calendar to which year, month and day are measured
- * (currently supported Gregorian, Julian, and Chinese (experimental).)
+ * @param mjd Modified Julian Date
+ * @param[out] year  Chinese year
+ * @param[out] month Chinese month, plus 16 if intercalary
+ * @param[out] day   Chinese day
  */
-Date::Date(int year,
-		   unsigned int month,
-		   unsigned int day,
-		   enum CalendarType t)
+void
+chineseFromMJD(int mjd, int& year, unsigned int& month, unsigned int& day)
 {
-	switch(t){
-		case CALTYPE_GREGORIAN :
-			_mjd = mjdFromGregorian(year,month,day);
-			break;
-		case CALTYPE_JULIAN :
-			_mjd = mjdFromJulian(year,month,day);
-			break;
-		case CALTYPE_CHINESE :
-			_mjd = mjdFromChinese(year,month,day);
-			break;
-		default :
-			throw INVALID_PARAM(t);
+	DayInfo const* info=dayInfoFromMJD(mjd);
+	if (info) {
+		year=info->chineseYear+1900+CHINESE_CALENDAR_BEGIN;
+		month=info->chineseMonth;
+		day=info->chineseDay;
+		return;
 	}
+	chineseFromJD(mjd+2400001,year,month,day);
 }
 
 /**
- * @brief ISO day of week of this date object
- *
- * Epoch of modified Julian date is 1858-11-17 0h (Wednesday).
- * So day of week is (MJD+3) mod 7.
+ * @relatesalso Date
+ * @brief look up the precomputed fields of a day
  *
- * This function takes no argument.
+ * @param mjd Modified Julian Date
  *
- * @return ISO day of week
+ * @return pointer to the DayInfo of the day, or null if mjd is outside
+ * Chinese New Year 1901 to the end of 2099, or if the program was built
+ * with NO_DAYINFO_TABLE.
  */
-enum Date::DayOfWeek
-Date::getDayOfWeek() const
+DayInfo const*
+dayInfoFromMJD(int mjd)
 {
-	return Date::DayOfWeek((_mjd+3)%7);
+#ifndef NO_DAYINFO_TABLE
+	if ((mjd>=LUNAR_TABLE_START_MJD) && (mjd<=LUNAR_TABLE_END_MJD)) {
+		return dayInfoTable()+(mjd-LUNAR_TABLE_START_MJD);
+	}
+#endif	// NO_DAYINFO_TABLE
+	return 0;
 }
 
-
 /**
  * @relatesalso Date
- * @brief look up the number of days in a Gregorian month
- *
- * @param year Gregorian year
- * @param month Gregorian month
- *
- * @return the number of days in the given month
+ * @brief compute Gregorian date from Modified Julian Date
+ * @param mjd Modified Julian Date
+ * @param dp part (DATEPART_GREGORIAN_*)
+ * @return requested calendar part
  */
-unsigned int
-daysInMonth(int year, unsigned int month)
+int
+gregorianFromMJD(int mjd, enum Date::DatePart dp)
 {
-#ifdef DEBUG
-	MY_ERR << "daysInMonth(" << year <<  "," << month << ") called." << std::endl;
-#endif	// DEBUG
-	switch (month) {
-		case 1: case 3: case 5: case 7: case 8: case 10: case 12:
-			return 31;
-		case 2:
-				// can't use Date(year,2,xxx) otherwise infinite loop.
-			return (isLeapYear(year)?29:28);
-		case 4: case 6: case 9: case 11:
-			return 30;
+	int year;
+	unsigned int month, day;
+	gregorianFromMJD(mjd,year,month,day);
+	switch(dp){
+		case Date::DATEPART_GREGORIAN_YEAR  : return year;
+		case Date::DATEPART_GREGORIAN_MONTH : return month;
+		case Date::DATEPART_GREGORIAN_DAY   : return day;
 		default:
-		// shouldn't get here --- month is not a valid month, throwing
-			throw INVALID_PARAM(month);
+				// shouldn't be here
+			return 0;
 	}
 }
 
 /**
- * @brief helper function to decide a year is leap in Gregorian calendar.
- *
- * May rename this later to isGregorianLeapYear, if I decide to implement
- * Julian calendar too, but since Julian leap year is easy it probably won't
- * happen.
- *
- * @param y Gregorian year
- *
- * @retval true if y is a leap year in Gregorian calendar
- * @retval false if y is not a leap year in Gregorian calendar
+ * @relatesalso Date
+ * @brief compute Julian date from Modified Julian Date
+ * @param mjd Modified Julian Date
+ * @param dp part (DATEPART_JULIAN_*)
+ * @return requested calendar part
  */
-bool
-isLeapYear(int const y)
+int
+julianFromMJD(int mjd, enum Date::DatePart dp)
 {
-#ifdef DEBUG
-	MY_ERR << "isLeapYear(" << y << ") called." << std::endl;
-#endif	// DEBUG
-	if (y % 4) return false;
-	if (y % 100) return true;
-	if (y % 400) return false;
-	return true;
+	int year;
+	unsigned int month, day;
+	julianFromMJD(mjd,year,month,day);
+	switch(dp){
+		case Date::DATEPART_JULIAN_YEAR  : return year;
+		case Date::DATEPART_JULIAN_MONTH : return month;
+		case Date::DATEPART_JULIAN_DAY   : return day;
+		default:
+				// shouldn't be here
+			return 0;
+	}
 }
 
 /**
@@ -644,16 +743,12 @@ Date::getLunarCalendarData() const{
 unsigned int
 Date::getDayOfYear() const
 {
-	unsigned int d = (((_mjd+2400000-GREGORIAN_ZERO_JULIAN_OFFSET)
-					  % DAYS_IN_FOUR_CENTURY)
-					 % DAYS_IN_HALF_CENTURY)
-		% DAYS_IN_FOUR_YEAR;
-	int	i=3;
-	while (i>0) {
-		if (d>=365) d-=365;
-		i--;
-	}
-	return d+1;
+	DayInfo const* info=dayInfoFromMJD(_mjd);
+	if (info) return info->dayOfYear;
+	int year;
+	unsigned int month, day;
+	gregorianFromJD(getJD(),year,month,day);
+	return doyOffset[month-1][isLeapYear(year)]+day;
 }
 
 /**
@@ -666,5 +761,69 @@ Date::getDayOfYear() const
 int
 chineseFromMJD(int mjd, enum Date::DatePart dp)
 {
-	return chineseFromJD(mjd+2400001,dp);
+#ifdef DEBUG
+	MY_ERR << "chineseFromMJD(" << mjd << "," << dp << ") called." << std::endl;
+#endif	// DEBUG
+	int year;
+	unsigned int month, day;
+	chineseFromMJD(mjd,year,month,day);
+	switch(dp){
+		case Date::DATEPART_CHINESE_YEAR  : return year;
+		case Date::DATEPART_CHINESE_MONTH : return month;
+		case Date::DATEPART_CHINESE_DAY   : return day;
+		default :
+				//shouldn't be here
+#ifdef DEBUG
+			MY_ERR << "\tError: requested date part is not handled by this method!" << std::endl;
+#endif	// DEBUG
+			throw INVALID_PARAM(dp);
+	}
+}
+
+/**
+ * @brief compute every calendar field of this date at once
+ *
+ * Unlike the individual getters, this does not go back to the conversion
+ * routines once per field, and keeps no hidden state, so it is reentrant.
+ *
+ * This function takes no argument.
+ *
+ * @return all calendar fields of the date; see DateFields.
+ */
+DateFields
+Date::decode() const
+{
+#ifdef DEBUG
+	MY_ERR << this << "->Date::decode() called." << std::endl;
+#endif	// DEBUG
+	DateFields f;
+	f.mjd=_mjd;
+	julianFromMJD(_mjd,f.julianYear,f.julianMonth,f.julianDay);
+	DayInfo const* info=dayInfoFromMJD(_mjd);
+	if (info) {
+		f.gregorianYear=info->gregorianYear+1900;
+		f.gregorianMonth=info->gregorianMonth;
+		f.gregorianDay=info->gregorianDay;
+		f.chineseYear=info->chineseYear+1900+CHINESE_CALENDAR_BEGIN;
+		f.chineseMonth=info->chineseMonth;
+		f.chineseDay=info->chineseDay;
+		f.chineseLeap=(f.chineseMonth & 16);
+		f.dayOfWeek=Date::DayOfWeek(info->dayOfWeek);
+		f.dayOfYear=info->dayOfYear;
+		return f;
+	}
+	gregorianFromJD(getJD(),f.gregorianYear,f.gregorianMonth,f.gregorianDay);
+	if ((_mjd>=LUNAR_START_MJD) && (_mjd<=LUNAR_END_MJD)) {
+		chineseFromJD(getJD(),f.chineseYear,f.chineseMonth,f.chineseDay);
+	}
+	else {
+		f.chineseYear=0;
+		f.chineseMonth=0;
+		f.chineseDay=0;
+	}
+	f.chineseLeap=(f.chineseMonth & 16);
+	f.dayOfWeek=Date::DayOfWeek((_mjd+3)%7);
+	f.dayOfYear=doyOffset[f.gregorianMonth-1][isLeapYear(f.gregorianYear)]
+		+f.gregorianDay;
+	return f;
 }
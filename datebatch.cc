@@ -0,0 +1,522 @@
+/**
+ * @file datebatch.cc
+ *
+ * Time-stamp: <2026-10-17 10:12:40 +0800 by kerwin>
+ *
+ * Batch conversion of arrays of Modified Julian Days into calendar fields.
+ *
+ * The formulas are the same Fliegel--Van Flandern ones used by the scalar
+ * gregorianFromMJD() and julianFromMJD(), but every division by a constant
+ * is replaced by a multiply and shift so that eight (AVX2) or four (SSE4.1)
+ * days can be converted at once.  The kernel is chosen at run time from
+ * what the processor supports; anything else falls back to the scalar code.
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "include/date.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define DATEBATCH_X86
+#include <immintrin.h>
+#endif
+
+/* constants and kernels goes in an anonymous namespace */
+namespace {
+	// The vector kernels are only used for 0 <= MJD < BATCH_MJD_LIMIT
+	// (1858-11-17 to well beyond year 13000).  The multiply-shift
+	// constants below are exact for every intermediate value in that range;
+	// lanes outside it are handed to the scalar code.
+	const int BATCH_MJD_LIMIT = 1<<22;
+
+		/**
+		 * @brief kernels available for batch conversion
+		 */
+	enum BatchKernel {
+		KERNEL_SCALAR,			///< plain C++ loop
+		KERNEL_SSE41,			///< 4 days at a time
+		KERNEL_AVX2				///< 8 days at a time
+	};
+
+/**
+ * @brief choose the widest kernel supported by this processor
+ *
+ * The answer is worked out once and remembered.
+ *
+ * @return kernel to use for batch conversion
+ */
+	enum BatchKernel
+	batchKernel()
+	{
+#ifdef DATEBATCH_X86
+		static const enum BatchKernel kernel=
+			__builtin_cpu_supports("avx2") ? KERNEL_AVX2 :
+			__builtin_cpu_supports("sse4.1") ? KERNEL_SSE41 : KERNEL_SCALAR;
+		return kernel;
+#else
+		return KERNEL_SCALAR;
+#endif
+	}
+
+#ifdef DATEBATCH_X86
+/**
+ * @brief x/d for 0 <= x < 2^25 as (x*M)>>K, with a 64 bit product
+ *
+ * @tparam M magic multiplier ceil(2^K/d), must fit 32 bits
+ * @tparam K total shift, at least 32
+ * @param x four non-negative 32 bit integers
+ *
+ * @return four quotients
+ */
+	template <unsigned int M, int K>
+	__attribute__((target("sse4.1")))
+	inline
+	__m128i
+	divWide(__m128i x)
+	{
+		const __m128i m=_mm_set1_epi32(M);
+		__m128i even=_mm_srli_epi64(_mm_mul_epu32(x,m),K);
+		__m128i odd=_mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(x,32),m),K);
+		return _mm_blend_epi16(even,_mm_slli_epi64(odd,32),0xCC);
+	}
+
+/**
+ * @brief x/d for small x as (x*M)>>K, with a 32 bit product
+ *
+ * @tparam M magic multiplier ceil(2^K/d)
+ * @tparam K shift
+ * @param x four non-negative 32 bit integers, x*M must not overflow
+ *
+ * @return four quotients
+ */
+	template <unsigned int M, int K>
+	__attribute__((target("sse4.1")))
+	inline
+	__m128i
+	divNarrow(__m128i x)
+	{
+		return _mm_srli_epi32(_mm_mullo_epi32(x,_mm_set1_epi32(M)),K);
+	}
+
+/**
+ * @brief 8-lane version of divWide(__m128i)
+ * @param x eight non-negative 32 bit integers
+ * @return eight quotients
+ */
+	template <unsigned int M, int K>
+	__attribute__((target("avx2")))
+	inline
+	__m256i
+	divWide(__m256i x)
+	{
+		const __m256i m=_mm256_set1_epi32(M);
+		__m256i even=_mm256_srli_epi64(_mm256_mul_epu32(x,m),K);
+		__m256i odd=_mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x,32),m),K);
+		return _mm256_blend_epi32(even,_mm256_slli_epi64(odd,32),0xAA);
+	}
+
+/**
+ * @brief 8-lane version of divNarrow(__m128i)
+ * @param x eight non-negative 32 bit integers
+ * @return eight quotients
+ */
+	template <unsigned int M, int K>
+	__attribute__((target("avx2")))
+	inline
+	__m256i
+	divNarrow(__m256i x)
+	{
+		return _mm256_srli_epi32(_mm256_mullo_epi32(x,_mm256_set1_epi32(M)),K);
+	}
+
+	// The divisors, as (multiplier, shift) pairs.  Bounds are for
+	// 0 <= MJD < BATCH_MJD_LIMIT.
+#define DIV146097 3853261556u,49	// x < 2^25
+#define DIV1461   3010298776u,42	// x < 2^25
+#define DIV153    6854u,20			// x < 2^11
+#define DIV5      13108u,16			// x < 2^11
+#define DIV10     6554u,16			// x < 2^4
+#define DIV7      2454267027u,34	// x < 2^23
+
+/**
+ * @brief common tail of the Gregorian and Julian formulas, 4 lanes
+ *
+ * Given c (days since the start of a 4 year cycle) and the century part,
+ * computes day, month and year as in gregorianFromJD().
+ *
+ * @param c   c in the formula
+ * @param yb  b*100 in the formula (0 for the Julian calendar)
+ * @param[out] year  4 years
+ * @param[out] month 4 months
+ * @param[out] day   4 days
+ */
+	__attribute__((target("sse4.1")))
+	inline
+	void
+	fromCycle(__m128i c, __m128i yb, __m128i& year, __m128i& month, __m128i& day)
+	{
+		__m128i d=divWide<DIV1461>(_mm_add_epi32(_mm_slli_epi32(c,2),_mm_set1_epi32(3)));
+		__m128i e=_mm_sub_epi32(c,_mm_srli_epi32(_mm_mullo_epi32(d,_mm_set1_epi32(1461)),2));
+		__m128i m=divNarrow<DIV153>(_mm_add_epi32(_mm_mullo_epi32(e,_mm_set1_epi32(5)),_mm_set1_epi32(2)));
+		__m128i m10=divNarrow<DIV10>(m);
+		day=_mm_add_epi32(_mm_sub_epi32(e,divNarrow<DIV5>(_mm_add_epi32(_mm_mullo_epi32(m,_mm_set1_epi32(153)),_mm_set1_epi32(2)))),_mm_set1_epi32(1));
+		month=_mm_sub_epi32(_mm_add_epi32(m,_mm_set1_epi32(3)),_mm_mullo_epi32(m10,_mm_set1_epi32(12)));
+		year=_mm_add_epi32(_mm_add_epi32(yb,d),_mm_sub_epi32(m10,_mm_set1_epi32(4800)));
+	}
+
+/**
+ * @brief common tail of the Gregorian and Julian formulas, 8 lanes
+ *
+ * See fromCycle(__m128i, __m128i, __m128i&, __m128i&, __m128i&).
+ */
+	__attribute__((target("avx2")))
+	inline
+	void
+	fromCycle(__m256i c, __m256i yb, __m256i& year, __m256i& month, __m256i& day)
+	{
+		__m256i d=divWide<DIV1461>(_mm256_add_epi32(_mm256_slli_epi32(c,2),_mm256_set1_epi32(3)));
+		__m256i e=_mm256_sub_epi32(c,_mm256_srli_epi32(_mm256_mullo_epi32(d,_mm256_set1_epi32(1461)),2));
+		__m256i m=divNarrow<DIV153>(_mm256_add_epi32(_mm256_mullo_epi32(e,_mm256_set1_epi32(5)),_mm256_set1_epi32(2)));
+		__m256i m10=divNarrow<DIV10>(m);
+		day=_mm256_add_epi32(_mm256_sub_epi32(e,divNarrow<DIV5>(_mm256_add_epi32(_mm256_mullo_epi32(m,_mm256_set1_epi32(153)),_mm256_set1_epi32(2)))),_mm256_set1_epi32(1));
+		month=_mm256_sub_epi32(_mm256_add_epi32(m,_mm256_set1_epi32(3)),_mm256_mullo_epi32(m10,_mm256_set1_epi32(12)));
+		year=_mm256_add_epi32(_mm256_add_epi32(yb,d),_mm256_sub_epi32(m10,_mm256_set1_epi32(4800)));
+	}
+
+/**
+ * @brief are all 4 lanes inside [0, BATCH_MJD_LIMIT)?
+ * @param x 4 MJD
+ * @return true if the vector kernel may be used
+ */
+	__attribute__((target("sse4.1")))
+	inline
+	bool
+	inBatchRange(__m128i x)
+	{
+		__m128i ok=_mm_and_si128(_mm_cmpgt_epi32(x,_mm_set1_epi32(-1)),
+								 _mm_cmpgt_epi32(_mm_set1_epi32(BATCH_MJD_LIMIT),x));
+		return _mm_movemask_epi8(ok)==0xFFFF;
+	}
+
+/**
+ * @brief are all 8 lanes inside [0, BATCH_MJD_LIMIT)?
+ * @param x 8 MJD
+ * @return true if the vector kernel may be used
+ */
+	__attribute__((target("avx2")))
+	inline
+	bool
+	inBatchRange(__m256i x)
+	{
+		__m256i ok=_mm256_and_si256(_mm256_cmpgt_epi32(x,_mm256_set1_epi32(-1)),
+									_mm256_cmpgt_epi32(_mm256_set1_epi32(BATCH_MJD_LIMIT),x));
+		return _mm256_movemask_epi8(ok)==-1;
+	}
+
+/**
+ * @brief Gregorian batch kernel, 4 days at a time
+ *
+ * @param mjd  array of n MJD
+ * @param n    number of days
+ * @param[out] year  n Gregorian years
+ * @param[out] month n Gregorian months
+ * @param[out] day   n Gregorian days
+ *
+ * @return number of days converted; the caller finishes the rest.
+ */
+	__attribute__((target("sse4.1")))
+	std::size_t
+	gregorianSSE41(int const* mjd, std::size_t n,
+				   int* year, unsigned int* month, unsigned int* day)
+	{
+		std::size_t i=0;
+		for (; i+4<=n; i+=4) {
+			__m128i x=_mm_loadu_si128((__m128i const*)(mjd+i));
+			if (!inBatchRange(x)) {
+				for (std::size_t j=i; j<i+4; j++) {
+					gregorianFromMJD(mjd[j],year[j],month[j],day[j]);
+				}
+				continue;
+			}
+				// a = JD + 32044, JD = MJD + 2400001
+			__m128i a=_mm_add_epi32(x,_mm_set1_epi32(2400001+32044));
+			__m128i b=divWide<DIV146097>(_mm_add_epi32(_mm_slli_epi32(a,2),_mm_set1_epi32(3)));
+			__m128i c=_mm_sub_epi32(a,_mm_srli_epi32(_mm_mullo_epi32(b,_mm_set1_epi32(146097)),2));
+			__m128i y,m,d;
+			fromCycle(c,_mm_mullo_epi32(b,_mm_set1_epi32(100)),y,m,d);
+			_mm_storeu_si128((__m128i*)(year+i),y);
+			_mm_storeu_si128((__m128i*)(month+i),m);
+			_mm_storeu_si128((__m128i*)(day+i),d);
+		}
+		return i;
+	}
+
+/**
+ * @brief Gregorian batch kernel, 8 days at a time
+ *
+ * See gregorianSSE41().
+ */
+	__attribute__((target("avx2")))
+	std::size_t
+	gregorianAVX2(int const* mjd, std::size_t n,
+				  int* year, unsigned int* month, unsigned int* day)
+	{
+		std::size_t i=0;
+		for (; i+8<=n; i+=8) {
+			__m256i x=_mm256_loadu_si256((__m256i const*)(mjd+i));
+			if (!inBatchRange(x)) {
+				for (std::size_t j=i; j<i+8; j++) {
+					gregorianFromMJD(mjd[j],year[j],month[j],day[j]);
+				}
+				continue;
+			}
+			__m256i a=_mm256_add_epi32(x,_mm256_set1_epi32(2400001+32044));
+			__m256i b=divWide<DIV146097>(_mm256_add_epi32(_mm256_slli_epi32(a,2),_mm256_set1_epi32(3)));
+			__m256i c=_mm256_sub_epi32(a,_mm256_srli_epi32(_mm256_mullo_epi32(b,_mm256_set1_epi32(146097)),2));
+			__m256i y,m,d;
+			fromCycle(c,_mm256_mullo_epi32(b,_mm256_set1_epi32(100)),y,m,d);
+			_mm256_storeu_si256((__m256i*)(year+i),y);
+			_mm256_storeu_si256((__m256i*)(month+i),m);
+			_mm256_storeu_si256((__m256i*)(day+i),d);
+		}
+		return i;
+	}
+
+/**
+ * @brief Julian calendar batch kernel, 4 days at a time
+ *
+ * See gregorianSSE41().
+ */
+	__attribute__((target("sse4.1")))
+	std::size_t
+	julianSSE41(int const* mjd, std::size_t n,
+				int* year, unsigned int* month, unsigned int* day)
+	{
+		std::size_t i=0;
+		for (; i+4<=n; i+=4) {
+			__m128i x=_mm_loadu_si128((__m128i const*)(mjd+i));
+			if (!inBatchRange(x)) {
+				for (std::size_t j=i; j<i+4; j++) {
+					julianFromMJD(mjd[j],year[j],month[j],day[j]);
+				}
+				continue;
+			}
+				// c = JD + 32082
+			__m128i c=_mm_add_epi32(x,_mm_set1_epi32(2400001+32082));
+			__m128i y,m,d;
+			fromCycle(c,_mm_setzero_si128(),y,m,d);
+			_mm_storeu_si128((__m128i*)(year+i),y);
+			_mm_storeu_si128((__m128i*)(month+i),m);
+			_mm_storeu_si128((__m128i*)(day+i),d);
+		}
+		return i;
+	}
+
+/**
+ * @brief Julian calendar batch kernel, 8 days at a time
+ *
+ * See gregorianSSE41().
+ */
+	__attribute__((target("avx2")))
+	std::size_t
+	julianAVX2(int const* mjd, std::size_t n,
+			   int* year, unsigned int* month, unsigned int* day)
+	{
+		std::size_t i=0;
+		for (; i+8<=n; i+=8) {
+			__m256i x=_mm256_loadu_si256((__m256i const*)(mjd+i));
+			if (!inBatchRange(x)) {
+				for (std::size_t j=i; j<i+8; j++) {
+					julianFromMJD(mjd[j],year[j],month[j],day[j]);
+				}
+				continue;
+			}
+			__m256i c=_mm256_add_epi32(x,_mm256_set1_epi32(2400001+32082));
+			__m256i y,m,d;
+			fromCycle(c,_mm256_setzero_si256(),y,m,d);
+			_mm256_storeu_si256((__m256i*)(year+i),y);
+			_mm256_storeu_si256((__m256i*)(month+i),m);
+			_mm256_storeu_si256((__m256i*)(day+i),d);
+		}
+		return i;
+	}
+
+/**
+ * @brief day of week batch kernel, 4 days at a time
+ *
+ * @param mjd  array of n MJD
+ * @param n    number of days
+ * @param[out] dow n ISO days of week
+ *
+ * @return number of days converted; the caller finishes the rest.
+ */
+	__attribute__((target("sse4.1")))
+	std::size_t
+	dayOfWeekSSE41(int const* mjd, std::size_t n, int* dow)
+	{
+		std::size_t i=0;
+		for (; i+4<=n; i+=4) {
+			__m128i x=_mm_loadu_si128((__m128i const*)(mjd+i));
+			if (!inBatchRange(x)) {
+				for (std::size_t j=i; j<i+4; j++) {
+					dow[j]=(mjd[j]+3)%7;
+				}
+				continue;
+			}
+			x=_mm_add_epi32(x,_mm_set1_epi32(3));
+			__m128i q=divWide<DIV7>(x);
+			_mm_storeu_si128((__m128i*)(dow+i),
+							 _mm_sub_epi32(x,_mm_mullo_epi32(q,_mm_set1_epi32(7))));
+		}
+		return i;
+	}
+
+/**
+ * @brief day of week batch kernel, 8 days at a time
+ *
+ * See dayOfWeekSSE41().
+ */
+	__attribute__((target("avx2")))
+	std::size_t
+	dayOfWeekAVX2(int const* mjd, std::size_t n, int* dow)
+	{
+		std::size_t i=0;
+		for (; i+8<=n; i+=8) {
+			__m256i x=_mm256_loadu_si256((__m256i const*)(mjd+i));
+			if (!inBatchRange(x)) {
+				for (std::size_t j=i; j<i+8; j++) {
+					dow[j]=(mjd[j]+3)%7;
+				}
+				continue;
+			}
+			x=_mm256_add_epi32(x,_mm256_set1_epi32(3));
+			__m256i q=divWide<DIV7>(x);
+			_mm256_storeu_si256((__m256i*)(dow+i),
+								_mm256_sub_epi32(x,_mm256_mullo_epi32(q,_mm256_set1_epi32(7))));
+		}
+		return i;
+	}
+
+#undef DIV146097
+#undef DIV1461
+#undef DIV153
+#undef DIV5
+#undef DIV10
+#undef DIV7
+#endif	// DATEBATCH_X86
+}
+
+/**
+ * @relatesalso Date
+ * @brief compute Gregorian year, month and day for an array of MJD
+ *
+ * Gives exactly the same answers as calling
+ * gregorianFromMJD(int, int&, unsigned int&, unsigned int&) on every
+ * element, only faster.
+ *
+ * @param mjd  array of n Modified Julian Days
+ * @param n    number of days
+ * @param[out] year  array of n Gregorian years
+ * @param[out] month array of n Gregorian months
+ * @param[out] day   array of n Gregorian days
+ */
+void
+gregorianFromMJD(int const* mjd, std::size_t n,
+				 int* year, unsigned int* month, unsigned int* day)
+{
+#ifdef DEBUG
+	MY_ERR << "gregorianFromMJD((int*)" << mjd << "," << n << ",...) called."
+		   << std::endl;
+#endif	// DEBUG
+	std::size_t i=0;
+	switch (batchKernel()) {
+#ifdef DATEBATCH_X86
+		case KERNEL_AVX2 :
+			i=gregorianAVX2(mjd,n,year,month,day);
+			break;
+		case KERNEL_SSE41 :
+			i=gregorianSSE41(mjd,n,year,month,day);
+			break;
+#endif	// DATEBATCH_X86
+		default :
+			;
+	}
+	for (; i<n; i++) {
+		gregorianFromMJD(mjd[i],year[i],month[i],day[i]);
+	}
+}
+
+/**
+ * @relatesalso Date
+ * @brief compute Julian calendar year, month and day for an array of MJD
+ *
+ * Gives exactly the same answers as calling
+ * julianFromMJD(int, int&, unsigned int&, unsigned int&) on every
+ * element, only faster.
+ *
+ * @param mjd  array of n Modified Julian Days
+ * @param n    number of days
+ * @param[out] year  array of n Julian calendar years
+ * @param[out] month array of n Julian calendar months
+ * @param[out] day   array of n Julian calendar days
+ */
+void
+julianFromMJD(int const* mjd, std::size_t n,
+			  int* year, unsigned int* month, unsigned int* day)
+{
+#ifdef DEBUG
+	MY_ERR << "julianFromMJD((int*)" << mjd << "," << n << ",...) called."
+		   << std::endl;
+#endif	// DEBUG
+	std::size_t i=0;
+	switch (batchKernel()) {
+#ifdef DATEBATCH_X86
+		case KERNEL_AVX2 :
+			i=julianAVX2(mjd,n,year,month,day);
+			break;
+		case KERNEL_SSE41 :
+			i=julianSSE41(mjd,n,year,month,day);
+			break;
+#endif	// DATEBATCH_X86
+		default :
+			;
+	}
+	for (; i<n; i++) {
+		julianFromMJD(mjd[i],year[i],month[i],day[i]);
+	}
+}
+
+/**
+ * @relatesalso Date
+ * @brief compute ISO day of week for an array of MJD
+ *
+ * Gives exactly the same answers as Date::getDayOfWeek() on every element.
+ *
+ * @param mjd  array of n Modified Julian Days
+ * @param n    number of days
+ * @param[out] dow array of n ISO days of week (see Date::DayOfWeek)
+ */
+void
+dayOfWeekFromMJD(int const* mjd, std::size_t n, int* dow)
+{
+#ifdef DEBUG
+	MY_ERR << "dayOfWeekFromMJD((int*)" << mjd << "," << n << ",...) called."
+		   << std::endl;
+#endif	// DEBUG
+	std::size_t i=0;
+	switch (batchKernel()) {
+#ifdef DATEBATCH_X86
+		case KERNEL_AVX2 :
+			i=dayOfWeekAVX2(mjd,n,dow);
+			break;
+		case KERNEL_SSE41 :
+			i=dayOfWeekSSE41(mjd,n,dow);
+			break;
+#endif	// DATEBATCH_X86
+		default :
+			;
+	}
+	for (; i<n; i++) {
+		dow[i]=(mjd[i]+3)%7;
+	}
+}
@@ -0,0 +1,340 @@
+/**
+ * @file daybitmap.cc
+ *
+ * Time-stamp: <2026-10-17 11:02:18 +0800 by kerwin>
+ *
+ * One bit per day for every day of 1901--2099, with rank, count and scan.
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "include/debug.h"
+#include "include/daybitmap.h"
+#include <algorithm>
+
+namespace {
+	const int DAYBITMAP_DAYS = mjdFromGregorian(2100,1,1)-mjdFromGregorian(1901,1,1);
+	const int DAYBITMAP_WORDS = (DAYBITMAP_DAYS+63)/64;
+
+	/**
+	 * @brief position of the j-th set bit of each byte value
+	 */
+	struct SelectInByte {
+		unsigned char pos[256][8];
+		///< pos[b][j] is the position of set bit j of b, 0 if none
+		constexpr SelectInByte() : pos() {
+			for (int b=0; b<256; b++) {
+				int j=0;
+				for (int i=0; i<8; i++) {
+					if (b & (1<<i)) pos[b][j++]=i;
+				}
+			}
+		}
+	};
+	constexpr SelectInByte SELECT_IN_BYTE;
+}
+
+/**
+ * @brief constructor, gives the empty set
+ */
+DayBitmap::DayBitmap() :
+	_word(DAYBITMAP_WORDS,0), _rank(DAYBITMAP_WORDS+1,0), _indexed(true)
+{
+}
+
+/**
+ * @brief add a day to the set
+ *
+ * Throws INVALID_PARAM if the day is outside 1901--2099.
+ *
+ * @param d the date to add
+ */
+void
+DayBitmap::set(Date const& d)
+{
+	int i=d.getMJD()-firstMJD();
+	if ((i<0) || (i>=DAYBITMAP_DAYS)) {
+		throw INVALID_PARAM(i);
+	}
+	_word[i>>6] |= 1ULL<<(i & 63);
+	_indexed=false;
+}
+
+/**
+ * @brief remove a day from the set
+ *
+ * Days outside 1901--2099 are ignored, since they are never members.
+ *
+ * @param d the date to remove
+ */
+void
+DayBitmap::reset(Date const& d)
+{
+	unsigned int i=d.getMJD()-firstMJD();
+	if (i>=(unsigned int)DAYBITMAP_DAYS) return;
+	_word[i>>6] &= ~(1ULL<<(i & 63));
+	_indexed=false;
+}
+
+/**
+ * @brief add a day to the set, keeping the prefix counts
+ *
+ * Only the counts after the day's word change, so this is cheaper
+ * than set() and buildIndex() for a single day.  If the counts were already
+ * out of date they stay so.  Throws INVALID_PARAM if the day is outside
+ * 1901--2099.
+ *
+ * @param d the date to add
+ */
+void
+DayBitmap::insert(Date const& d)
+{
+	int i=d.getMJD()-firstMJD();
+	if ((i<0) || (i>=DAYBITMAP_DAYS)) {
+		throw INVALID_PARAM(i);
+	}
+	unsigned long long const bit=1ULL<<(i & 63);
+	if (_word[i>>6] & bit) return;
+	_word[i>>6] |= bit;
+	for (int w=(i>>6)+1; w<=DAYBITMAP_WORDS; w++) _rank[w]++;
+}
+
+/**
+ * @brief remove a day from the set, keeping the prefix counts
+ *
+ * As insert(); days outside 1901--2099 are ignored, since they are never
+ * members.
+ *
+ * @param d the date to remove
+ */
+void
+DayBitmap::erase(Date const& d)
+{
+	unsigned int i=d.getMJD()-firstMJD();
+	if (i>=(unsigned int)DAYBITMAP_DAYS) return;
+	unsigned long long const bit=1ULL<<(i & 63);
+	if (!(_word[i>>6] & bit)) return;
+	_word[i>>6] &= ~bit;
+	for (int w=(i>>6)+1; w<=DAYBITMAP_WORDS; w++) _rank[w]--;
+}
+
+/**
+ * @brief empty the set
+ *
+ * This function takes no argument.
+ */
+void
+DayBitmap::clear()
+{
+	_word.assign(DAYBITMAP_WORDS,0);
+	_rank.assign(DAYBITMAP_WORDS+1,0);
+	_indexed=true;
+}
+
+/**
+ * @brief recompute the prefix counts used by rank() and count()
+ *
+ * This function takes no argument.
+ */
+void
+DayBitmap::buildIndex()
+{
+#ifdef DEBUG
+	MY_ERR << this << "->DayBitmap::buildIndex() called." << std::endl;
+#endif
+	_rank[0]=0;
+	for (int w=0; w<DAYBITMAP_WORDS; w++) {
+		_rank[w+1]=_rank[w]+__builtin_popcountll(_word[w]);
+	}
+	_indexed=true;
+}
+
+/**
+ * @brief number of days set before day i
+ *
+ * @param i day number counted from firstMJD(), clamped to the range
+ *
+ * @return number of members strictly before day i
+ */
+unsigned int
+DayBitmap::rankOf(int i) const
+{
+	if (!_indexed) {
+		throw Exception("DayBitmap::buildIndex() not called after update");
+	}
+	if (i<=0) return 0;
+	if (i>=DAYBITMAP_DAYS) return _rank[DAYBITMAP_WORDS];
+	unsigned int r=_rank[i>>6];
+	if (i & 63) {
+		r+=__builtin_popcountll(_word[i>>6] & ((1ULL<<(i & 63))-1));
+	}
+	return r;
+}
+
+/**
+ * @brief number of members before a day
+ *
+ * For a member d, this is its position in date order, so it can be used to
+ * index a side array of data kept in date order.
+ *
+ * @param d a date
+ *
+ * @return number of members strictly before d
+ */
+unsigned int
+DayBitmap::rank(Date const& d) const
+{
+	return rankOf(d.getMJD()-firstMJD());
+}
+
+/**
+ * @brief number of members
+ *
+ * This function takes no argument.
+ *
+ * @return number of days in the set
+ */
+unsigned int
+DayBitmap::count() const
+{
+	return rankOf(DAYBITMAP_DAYS);
+}
+
+/**
+ * @brief number of members in a range of days
+ *
+ * @param first first day of range
+ * @param last  day after the end of range
+ *
+ * @return number of members d with first <= d < last
+ */
+unsigned int
+DayBitmap::count(Date const& first, Date const& last) const
+{
+	if (!(first<last)) return 0;
+	return rankOf(last.getMJD()-firstMJD())-rankOf(first.getMJD()-firstMJD());
+}
+
+/**
+ * @brief find the first member on or after a day
+ *
+ * @param[in,out] d day to start looking from, set to the member found
+ *
+ * @retval true if found
+ * @retval false if there is none, d is left unchanged
+ */
+bool
+DayBitmap::findNext(Date& d) const
+{
+	int i=d.getMJD()-firstMJD();
+	if (i>=DAYBITMAP_DAYS) return false;
+	if (i<0) i=0;
+	int w=i>>6;
+	unsigned long long bits=_word[w] & (~0ULL<<(i & 63));
+	while (!bits) {
+		if (++w>=DAYBITMAP_WORDS) return false;
+		bits=_word[w];
+	}
+	d=Date(firstMJD()+(w<<6)+__builtin_ctzll(bits));
+	return true;
+}
+
+/**
+ * @brief find the last member on or before a day
+ *
+ * @param[in,out] d day to start looking from, set to the member found
+ *
+ * @retval true if found
+ * @retval false if there is none, d is left unchanged
+ */
+bool
+DayBitmap::findPrevious(Date& d) const
+{
+	int i=d.getMJD()-firstMJD();
+	if (i<0) return false;
+	if (i>=DAYBITMAP_DAYS) i=DAYBITMAP_DAYS-1;
+	int w=i>>6;
+	unsigned long long bits=_word[w] & (~0ULL>>(63-(i & 63)));
+	while (!bits) {
+		if (--w<0) return false;
+		bits=_word[w];
+	}
+	d=Date(firstMJD()+(w<<6)+63-__builtin_clzll(bits));
+	return true;
+}
+
+/**
+ * @brief find the member of a given rank
+ *
+ * The inverse of rank(): select(rank(d),d) leaves a member d unchanged.
+ *
+ * @param k number of members before the one wanted
+ * @param[out] d set to the member found
+ *
+ * @retval true if found
+ * @retval false if there are k or fewer members, d is left unchanged
+ */
+bool
+DayBitmap::select(unsigned int k, Date& d) const
+{
+	if (k>=count()) return false;
+	// last word with fewer than k+1 members before it: guess assuming the
+	// members are spread evenly, then walk; exact for periodic sets
+	unsigned int total=_rank[DAYBITMAP_WORDS];
+	int w=(unsigned long long)k*DAYBITMAP_WORDS/total;
+	while (_rank[w]>k) w--;
+	while (_rank[w+1]<=k) w++;
+	unsigned long long bits=_word[w];
+	unsigned int j=k-_rank[w];
+	// broadword select: byte i of prefix is the number of members in bytes
+	// 0..i, find the first byte exceeding j, then look up within the byte.
+	unsigned long long b=bits-((bits>>1) & 0x5555555555555555ULL);
+	b=(b & 0x3333333333333333ULL)+((b>>2) & 0x3333333333333333ULL);
+	b=(b+(b>>4)) & 0x0F0F0F0F0F0F0F0FULL;
+	unsigned long long prefix=b*0x0101010101010101ULL;
+	unsigned long long le=((j*0x0101010101010101ULL | 0x8080808080808080ULL)
+						   -prefix) & 0x8080808080808080ULL;
+	unsigned int shift=(((le>>7)*0x0101010101010101ULL)>>56)<<3;
+	j-=((prefix<<8)>>shift) & 0xFF;
+	shift+=SELECT_IN_BYTE.pos[(bits>>shift) & 0xFF][j];
+	d=Date(firstMJD()+(w<<6)+shift);
+	return true;
+}
+
+/**
+ * @brief remove from this set every member of another set
+ *
+ * @param other days to remove
+ *
+ * @return this set
+ */
+DayBitmap&
+DayBitmap::operator-=(DayBitmap const& other)
+{
+	for (int w=0; w<DAYBITMAP_WORDS; w++) {
+		_word[w] &= ~other._word[w];
+	}
+	_indexed=false;
+	return *this;
+}
+
+/**
+ * @brief set of every day falling on some days of the week
+ *
+ * @param mask bit (1<<Date::DayOfWeek) set for each day of week wanted,
+ * e.g. (1<<Date::DOW_SATURDAY)|(1<<Date::DOW_SUNDAY) for weekends.
+ *
+ * @return indexed bitmap of those days
+ */
+DayBitmap
+DayBitmap::daysOfWeek(unsigned int mask)
+{
+	DayBitmap res;
+	for (int i=0; i<DAYBITMAP_DAYS; i++) {
+		if (mask & (1u<<Date(firstMJD()+i).getDayOfWeek())) {
+			res._word[i>>6] |= 1ULL<<(i & 63);
+		}
+	}
+	res.buildIndex();
+	return res;
+}
@@ -0,0 +1,234 @@
+/**
+ * @file fragmentcache.cc
+ *
+ * Time-stamp: <2026-10-17 23:12:09 +0800 by kerwin>
+ *
+ * Directory of rendered TeX fragments, kept between runs
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "include/debug.h"
+#include "include/fragmentcache.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+	const char FRAGMENT_SUFFIX[]=".tex";
+	///< file name of a fragment is 16 hex digits and this
+
+	/**
+	 * @brief a fragment file found in the directory
+	 */
+	struct FragmentFile {
+		double modified;
+		///< modification time, seconds since the epoch
+		unsigned long long size;
+		///< bytes
+		std::string name;
+		///< file name without directory
+		/**
+		 * @brief order by age
+		 * @param f other file
+		 * @return true if this file is older
+		 */
+		bool operator<(FragmentFile const& f) const {
+			return modified<f.modified;
+		}
+	};
+
+	/**
+	 * @brief check if a file name is that of a fragment
+	 *
+	 * @param name file name without directory
+	 *
+	 * @retval true for 16 hex digits followed by FRAGMENT_SUFFIX
+	 * @retval false otherwise
+	 */
+	bool
+	isFragment(char const* name)
+	{
+		for (int i=0; i<16; i++) {
+			if (!name[i] || !std::strchr("0123456789abcdef",name[i])) {
+				return false;
+			}
+		}
+		return !std::strcmp(name+16,FRAGMENT_SUFFIX);
+	}
+
+	/**
+	 * @brief list the fragments of a directory
+	 *
+	 * @param directory where the fragments are
+	 * @param[out] res fragments found, in directory order
+	 *
+	 * @retval true if the directory could be read
+	 * @retval false otherwise
+	 */
+	bool
+	listFragments(std::string const& directory, std::vector<FragmentFile>& res)
+	{
+		DIR* dir=opendir(directory.c_str());
+		if (!dir) return false;
+		struct dirent* e;
+		while ((e=readdir(dir))) {
+			if (!isFragment(e->d_name)) continue;
+			struct stat st;
+			if (fstatat(dirfd(dir),e->d_name,&st,0)<0) continue;
+			FragmentFile f;
+			f.modified=st.st_mtim.tv_sec+1e-9*st.st_mtim.tv_nsec;
+			f.size=st.st_size;
+			f.name=e->d_name;
+			res.push_back(f);
+		}
+		closedir(dir);
+		return true;
+	}
+}
+
+/**
+ * @brief constructor, creates the directory if needed
+ *
+ * Throws Exception if the directory cannot be created or read.
+ *
+ * @param directory where the fragments are kept
+ * @param limit size limit of the fragments in bytes
+ */
+FragmentCache::FragmentCache(std::string const& directory,
+							 unsigned long long limit) :
+	_directory(directory), _limit(limit), _size(0), _hits(0), _misses(0),
+	_evictions(0), _serial(0)
+{
+#ifdef DEBUG
+	MY_ERR << this << "->FragmentCache::FragmentCache(" << directory << ","
+		   << limit << ") called." << std::endl;
+#endif
+	if ((mkdir(directory.c_str(),0777)<0) && (errno!=EEXIST)) {
+		throw Exception("Cannot create cache directory");
+	}
+	std::vector<FragmentFile> file;
+	if (!listFragments(directory,file)) {
+		throw Exception("Cannot read cache directory");
+	}
+	for (std::size_t i=0; i<file.size(); i++) _size+=file[i].size;
+}
+
+/**
+ * @brief look up a fragment
+ *
+ * @param key key of the fragment
+ * @param[out] res the fragment, if found; its storage is reused
+ *
+ * @retval true if found
+ * @retval false otherwise
+ */
+bool
+FragmentCache::find(FragmentKey const& key, std::string& res)
+{
+	int fd=open(path(key).c_str(),O_RDONLY | O_CLOEXEC);
+	if (fd>=0) {
+		struct stat st;
+		if (fstat(fd,&st)==0) {
+			res.resize(st.st_size);
+			std::size_t n=0;
+			while (n<res.size()) {
+				ssize_t k=read(fd,&res[n],res.size()-n);
+				if ((k<0) && (errno==EINTR)) continue;
+				if (k<=0) break;
+				n+=k;
+			}
+			close(fd);
+			if (n==res.size()) {
+				_hits++;
+				return true;
+			}
+		}
+		else {
+			close(fd);
+		}
+	}
+	_misses++;
+	return false;
+}
+
+/**
+ * @brief keep a fragment
+ *
+ * Errors are ignored: the fragment is simply not kept.
+ *
+ * @param key key of the fragment
+ * @param tex the fragment
+ */
+void
+FragmentCache::insert(FragmentKey const& key, std::string const& tex)
+{
+	char name[64];
+	std::snprintf(name,sizeof(name),"/.tmp-%ld-%lu",static_cast<long>(getpid()),
+				  _serial++);
+	std::string tmp=_directory+name;
+	int fd=open(tmp.c_str(),O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,0666);
+	if (fd<0) return;
+	std::size_t n=0;
+	while (n<tex.size()) {
+		ssize_t k=write(fd,tex.data()+n,tex.size()-n);
+		if ((k<0) && (errno==EINTR)) continue;
+		if (k<=0) break;
+		n+=k;
+	}
+	if ((close(fd)<0) || (n<tex.size()) ||
+		(std::rename(tmp.c_str(),path(key).c_str())<0)) {
+		unlink(tmp.c_str());
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_lock);
+	_size+=tex.size();
+	if (_size>_limit) evict();
+}
+
+/**
+ * @brief file name of a fragment
+ *
+ * @param key key of the fragment
+ *
+ * @return directory, 16 hex digits of the key and FRAGMENT_SUFFIX
+ */
+std::string
+FragmentCache::path(FragmentKey const& key) const
+{
+	char name[24];
+	std::snprintf(name,sizeof(name),"/%016llx",key.getValue());
+	return _directory+name+FRAGMENT_SUFFIX;
+}
+
+/**
+ * @brief remove the oldest fragments until a quarter of the limit is free
+ *
+ * Sizes are taken afresh from the directory, which other processes may
+ * have written to.  Called with _lock held.
+ *
+ * This function takes no argument.
+ */
+void
+FragmentCache::evict()
+{
+	std::vector<FragmentFile> file;
+	listFragments(_directory,file);
+	std::sort(file.begin(),file.end());
+	unsigned long long size=0;
+	for (std::size_t i=0; i<file.size(); i++) size+=file[i].size;
+	for (std::size_t i=0; (i<file.size()) && (size>_limit/4*3); i++) {
+		if (unlink((_directory+"/"+file[i].name).c_str())==0) {
+			_evictions++;
+		}
+		size-=file[i].size;
+	}
+	_size=size;
+}
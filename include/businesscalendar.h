@@ -0,0 +1,69 @@
+/**
+ * @file businesscalendar.h
+ *
+ * Time-stamp: <2026-10-17 14:26:40 +0800 by kerwin>
+ *
+ * Business day arithmetic over the public holidays of a Calendar
+ *
+ * @author kerwin\@localhost
+ */
+#include "debug.h"
+#include "date.h"
+#include "daybitmap.h"
+#include "calendar.h"
+#include <cstddef>
+
+#ifndef KERWIN_BUSINESSCALENDAR_H
+#define KERWIN_BUSINESSCALENDAR_H
+
+/**
+ * @brief business day calendar
+ *
+ * A business day is a day that is neither a weekend day nor a public
+ * holiday.  The business days of 1901--2099 are kept as a DayBitmap, so
+ * counting is two rank() lookups and adding days is a rank() and a
+ * select(), both independent of the distance.  Queries reaching outside
+ * 1901--2099 throw.
+ */
+class BusinessCalendar {
+  public:
+	enum {
+		WEEKEND_SAT_SUN = (1<<Date::DOW_SATURDAY)|(1<<Date::DOW_SUNDAY),
+		///< default weekend mask, Saturday and Sunday
+		WEEKEND_SUN = (1<<Date::DOW_SUNDAY)
+		///< Sunday only weekend mask
+	};
+	BusinessCalendar(Calendar const&, unsigned int=WEEKEND_SAT_SUN);
+	BusinessCalendar(DayBitmap const&, unsigned int=WEEKEND_SAT_SUN);
+	bool isBusinessDay(Date const&) const;
+	Date nextBusinessDay(Date const&) const;
+	Date previousBusinessDay(Date const&) const;
+	Date addBusinessDays(Date const&, int) const;
+	int countBusinessDays(Date const&, Date const&) const;
+	void addBusinessDays(int const*, int const*, std::size_t, int*) const;
+  private:
+	DayBitmap _nBusinessDay;
+	///< Bitmap of business days
+	void build(DayBitmap const&, unsigned int);
+	int addBusinessDaysMJD(int, int) const;
+};
+
+// inline function declaration
+/**
+ * @brief check if a date is a business day
+ *
+ * This method should be inlined.
+ *
+ * @param d the date we want to check
+ *
+ * @retval true d is a business day
+ * @retval false d is a weekend day, a holiday, or outside 1901--2099
+ */
+inline
+bool
+BusinessCalendar::isBusinessDay(Date const& d) const
+{
+	return _nBusinessDay.test(d);
+}
+
+#endif	// KERWIN_BUSINESSCALENDAR_H
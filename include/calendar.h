@@ -9,12 +9,18 @@
  */
 #include "debug.h"
 #include "date.h"
+#include "daybitmap.h"
+#include "calendarfile.h"
+#include "calendardata.h"
+#include "fragmentcache.h"
+#include "monthgrid.h"
+#include "texsink.h"
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <sstream>
 #include <string>
-#include <map>
+#include <memory>
 
 #ifndef KERWIN_CALENDAR_H
 #define KERWIN_CALENDAR_H
@@ -23,6 +29,8 @@
 //class Calendar;
 
 // definition
+class ThreadPool;
+
 /**
  * @brief Yearly calendar
  *
@@ -32,20 +40,36 @@ class Calendar {
   public:
 	Calendar();
 	Calendar(unsigned int);
-	std::string const& getTexPreamble() const;
-	std::string const& getTexMonth(unsigned int) const;
-	std::string const& getTexMonthSmall(unsigned int) const;
-	std::string const& getTexEnd() const;
-	std::string const& getFullYearTex() const;
+	Calendar(unsigned int, std::shared_ptr<const CalendarData> const&);
+	std::string getTexPreamble() const;
+	std::string getTexMonth(unsigned int) const;
+	std::string getTexMonthSmall(unsigned int) const;
+	std::string getTexEnd() const;
+	std::string getFullYearTex() const;
+	std::string getFullYearTex(ThreadPool&) const;
+	void writeTexPreamble(TexSink&) const;
+	void writeTexMonth(TexSink&, unsigned int) const;
+	void writeTexMonthSmall(TexSink&, unsigned int) const;
+	void writeTexEnd(TexSink&) const;
+	void writeFullYearTex(TexSink&) const;
+	void writeFullYearTex(TexSink&, ThreadPool&) const;
 	bool isSolar(Date const&) const;
 	bool isPublicHoliday(Date const&) const;
+	DayBitmap const& getPublicHolidays() const;
+	std::shared_ptr<const CalendarData> const& getData() const;
 	std::string getSolarName(Date const&) const;
 	std::string const& getPublicHolidayName(Date const&) const;
-	std::string const& getSolarTime(Date const&) const;
+	std::string getSolarTime(Date const&) const;
 	bool setSolar(std::ifstream&);
 	bool setPublicHoliday(std::ifstream&);
 	bool setList(std::ifstream&,std::ifstream&);
+	bool setList(CalendarFile const&);
 	bool updateList();
+	bool refresh();
+	void setFragmentCache(std::shared_ptr<FragmentCache> const&);
+	unsigned int addPublicHoliday(Date const&, std::string const&);
+	unsigned int removePublicHoliday(Date const&);
+	unsigned int setSolarTerm(Date const&, unsigned int, unsigned int);
   private:
 	unsigned int _year;
 	///< Gregorian year of calendar
@@ -64,23 +88,30 @@ class Calendar {
 	///< LaTeX command choosing color of cells
 	static const char* const _nDayOfWeekHeading[];
 	///< LaTeX command for the day of week header
-	std::map<Date,std::string> _nPublicHoliday;
-	///< Hash of public holiday description strings hashed by date
-	std::map<Date,std::string> _nSolar;
-	///< Hash of only solar terms name string, keyed by date
-	std::map<Date,std::string> _nChineseSolar;
-	///< Hash combining Chinese calendar day and Solar term, keyed by date
-	std::map<Date,std::string> _nSolarPublicHoliday;
-	///< Hash combining Solar Term times and public holiday description,
-	///< keyed by date
+	std::shared_ptr<const CalendarData> _data;
+	///< Solar terms and public holidays, shared with other calendars
+	std::shared_ptr<FragmentCache> _cache;
+	///< Month pages rendered before, null for none
+	unsigned char _nDayFlag[366];
+	///< What each day shows, DAY_* flags, indexed by day of year - 1
+	unsigned char _nChineseMonth[366];
+	///< Chinese month of each day, index into _nChineseMonthName
+	unsigned char _nChineseDay[366];
+	///< Chinese day of each day, index into _nChineseDayName
 	bool initialised;
 	///< have we read the files
 	bool forcedInitialise();
 	bool initialise();
-	void generateChineseSolar();
-	void generateSolarPublicHoliday();
-	std::string dayCellTex(Date const& d) const;
-	std::string& emptyCellTex() const;
+	void generateDayNotes();
+	void noteDay(Date const&);
+	void appendChineseSolar(TexBuffer&, Date const&, unsigned int) const;
+	void appendSolarPublicHoliday(TexBuffer&, Date const&,
+								  unsigned int) const;
+	CalendarData& ownData();
+	unsigned int patchDay(Date const&);
+	void appendDayCell(TexBuffer&, Date const&) const;
+	FragmentKey monthKey(unsigned int) const;
+	std::string const& emptyCellTex() const;
 };
 
 // associated functions
@@ -128,6 +159,31 @@ Calendar::Calendar(unsigned int year)
 	initialise();
 }
 
+/**
+ * @brief Calendar constructor with given data
+ *
+ * This method should be inlined.
+ * The constructor sets the year and the solar terms and holidays to the
+ * arguments and call methods to initialise the variables.
+ *
+ * @param year Gregorian year of calendar.
+ * @param data solar terms and holidays to use, shared and not copied.
+ *
+ * @return Calendar object for year given.
+ */
+inline
+Calendar::Calendar(unsigned int year,
+				   std::shared_ptr<const CalendarData> const& data) :
+	_data(data)
+{
+#ifdef DEBUG
+	MY_ERR << "inline Calendar::Calendar(" << year << ",(CalendarData*)"
+		   << data.get() << ") called." << std::endl;
+#endif
+	_year = year; initialised=false;
+	initialise();
+}
+
 /**
  * @brief Calendar initialiser
  *
@@ -151,4 +207,156 @@ Calendar::initialise() {
 	return forcedInitialise();
 }
 
+/**
+ * @brief all public holidays
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return bitmap of public holiday dates
+ */
+inline
+DayBitmap const&
+Calendar::getPublicHolidays() const
+{
+	return _data->getPublicHolidays();
+}
+
+/**
+ * @brief the solar terms and holidays in use
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return shared data, may be passed to other calendars
+ */
+inline
+std::shared_ptr<const CalendarData> const&
+Calendar::getData() const
+{
+	return _data;
+}
+
+/**
+ * @brief get TeX preamble, begin document, until when the first month starts
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return string object containing TeX formatting code
+ */
+inline
+std::string
+Calendar::getTexPreamble() const
+{
+	std::string res;
+	StringSink sink(res);
+	writeTexPreamble(sink);
+	return res;
+}
+
+/**
+ * @brief get TeX code for the full month-to-view page for month
+ *
+ * This method should be inlined.
+ *
+ * @param month 1=January, ..., 12=December, of _year
+ *
+ * @return string object containing TeX formatting code
+ */
+inline
+std::string
+Calendar::getTexMonth(unsigned int month) const
+{
+	std::string res;
+	StringSink sink(res);
+	writeTexMonth(sink,month);
+	return res;
+}
+
+/**
+ * @brief get TeX code for the small month-to-view cell for last/next month
+ *
+ * This method should be inlined.
+ *
+ * @param month 0=last December, ..., 13=next January
+ *
+ * @return string object containing TeX formatting code such as
+ *         \verbatim\def\thisjan{...}\endverbatim
+ */
+inline
+std::string
+Calendar::getTexMonthSmall(unsigned int month) const
+{
+	std::string res;
+	StringSink sink(res);
+	writeTexMonthSmall(sink,month);
+	return res;
+}
+
+/**
+ * @brief get the \verbatim\end{document}\endverbatim TeX code
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return string object containing TeX formatting code
+ *         \verbatim\end{document}\endverbatim
+ */
+inline
+std::string
+Calendar::getTexEnd() const
+{
+	std::string res;
+	StringSink sink(res);
+	writeTexEnd(sink);
+	return res;
+}
+
+/**
+ * @brief get TeX code from start to end
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return string object containing TeX formatting code from
+ *         \verbatim\documentclass{...}\endverbatim
+ * to
+ *         \verbatim\end{document}\endverbatim
+ */
+inline
+std::string
+Calendar::getFullYearTex() const
+{
+	std::string res;
+	StringSink sink(res);
+	writeFullYearTex(sink);
+	return res;
+}
+
+/**
+ * @brief get TeX code from start to end, rendering the months on a pool
+ *
+ * This method should be inlined.
+ *
+ * @param pool threads to render on
+ *
+ * @return string object containing the same TeX formatting code as
+ *         getFullYearTex()
+ */
+inline
+std::string
+Calendar::getFullYearTex(ThreadPool& pool) const
+{
+	std::string res;
+	StringSink sink(res);
+	writeFullYearTex(sink,pool);
+	return res;
+}
+
 #endif	// KERWIN_CALENDAR_H
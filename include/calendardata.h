@@ -0,0 +1,181 @@
+/**
+ * @file calendardata.h
+ *
+ * Time-stamp: <2026-10-17 18:40:31 +0800 by kerwin>
+ *
+ * Solar terms and public holidays, loaded once and shared by calendars
+ *
+ * @author kerwin\@localhost
+ */
+#include "debug.h"
+#include "date.h"
+#include "datetime.h"
+#include "daybitmap.h"
+#include "calendarfile.h"
+#include "internedstring.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef KERWIN_CALENDARDATA_H
+#define KERWIN_CALENDARDATA_H
+
+/**
+ * @brief a solar term and when it begins
+ */
+struct SolarTerm {
+	DateTime instant;	///< beginning of the term, Chinese Standard Time
+	unsigned int term;	///< 0=xiaohan (minor cold), ..., 23=dongzhi
+						///< (winter solstice), as in the calendar year
+};
+
+/**
+ * @brief solar term times and public holidays of 1901--2099
+ *
+ * Filled by the set methods, then handed out as
+ * std::shared_ptr<const CalendarData>: once shared it is never changed, so
+ * any number of Calendar objects and threads may read it without locking.
+ * Changing the data means building a new CalendarData, usually a copy of
+ * the old one.
+ *
+ * The process wide default data is a snapshot: publish() replaces it while
+ * getDefault() goes on handing out the old or the new one; readers never
+ * take a lock or wait for a publisher.  Holders of an older snapshot keep it until they let
+ * go of their pointer.
+ *
+ * Entries outside the range of DayBitmap are dropped.  The solar terms of
+ * other years are worked out by SolarTermEngine when asked for, so pages
+ * outside 1901--2099 still show them; those years have no public holidays.
+ */
+class CalendarData {
+  public:
+	CalendarData();
+	bool isSolar(Date const&) const;
+	bool isPublicHoliday(Date const&) const;
+	DayBitmap const& getSolarTerms() const;
+	DayBitmap const& getPublicHolidays() const;
+	std::string getSolarTime(Date const&) const;
+	DateTime getSolarInstant(Date const&) const;
+	unsigned int getSolarTermIndex(Date const&) const;
+	bool findSolarTerm(DateTime const&, SolarTerm&) const;
+	std::string const& getPublicHolidayName(Date const&) const;
+	InternedString getPublicHolidayLabel(Date const&) const;
+	unsigned long getVersion() const;
+	void setSolar(SolarList const&);
+	void setPublicHoliday(HolidayList const&);
+	unsigned long readPublicHoliday(std::istream&);
+	void setList(CalendarFile const&);
+	void addPublicHoliday(Date const&, std::string const&);
+	void removePublicHoliday(Date const&);
+	void setSolarTerm(Date const&, unsigned int);
+	static std::shared_ptr<const CalendarData> load(std::string const& =".");
+	static std::shared_ptr<const CalendarData> getDefault();
+	static unsigned long getGeneration();
+	static void publish(std::shared_ptr<const CalendarData> const&);
+  private:
+	SolarTerm solarTermOn(Date const&) const;
+	static bool computedSolarTerm(Date const&, SolarTerm&);
+	DayBitmap _nPublicHoliday;
+	///< Bitmap of public holidays
+	std::vector<InternedString> _nPublicHolidayName;
+	///< Public holiday descriptions in date order, indexed by rank in
+	///< _nPublicHoliday; the same name every year is kept once
+	DayBitmap _nSolar;
+	///< Bitmap of solar term days
+	std::vector<SolarTerm> _nSolarTerm;
+	///< Solar terms sorted by instant, indexed by rank in _nSolar
+	unsigned long _version;
+	///< Changed to a number never used before by every set method; copies
+	///< share it until changed
+};
+
+// inline function declaration
+/**
+ * @brief check if a date is on the public holiday list
+ *
+ * This method should be inlined.
+ *
+ * @param d the date we want to check
+ *
+ * @retval true date is a holiday
+ * @retval false date is not a holiday
+ */
+inline
+bool
+CalendarData::isPublicHoliday(Date const& d) const
+{
+	return _nPublicHoliday.test(d);
+}
+
+/**
+ * @brief check if a date is a solar term
+ *
+ * This method should be inlined.
+ *
+ * @param d date to check
+ *
+ * @retval true if d is a solar term
+ * @retval false if d is not a solar term
+ */
+inline
+bool
+CalendarData::isSolar(Date const& d) const
+{
+	if (DayBitmap::covers(d.getMJD())) return _nSolar.test(d);
+	SolarTerm t;
+	return computedSolarTerm(d,t);
+}
+
+/**
+ * @brief all solar term days
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return bitmap of solar term dates
+ */
+inline
+DayBitmap const&
+CalendarData::getSolarTerms() const
+{
+	return _nSolar;
+}
+
+/**
+ * @brief all public holidays
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return bitmap of public holiday dates
+ */
+inline
+DayBitmap const&
+CalendarData::getPublicHolidays() const
+{
+	return _nPublicHoliday;
+}
+
+/**
+ * @brief identifies the content of this data
+ *
+ * This method should be inlined.
+ *
+ * Two CalendarData objects with the same version hold the same solar terms
+ * and holidays, so anything worked out from one may be reused for the
+ * other, even after the first is gone.
+ *
+ * This method has no argument
+ *
+ * @return version number, unique in the process
+ */
+inline
+unsigned long
+CalendarData::getVersion() const
+{
+	return _version;
+}
+
+#endif	// KERWIN_CALENDARDATA_H
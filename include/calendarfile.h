@@ -0,0 +1,239 @@
+/**
+ * @file calendarfile.h
+ *
+ * Time-stamp: <2026-10-17 16:05:12 +0800 by kerwin>
+ *
+ * Compiled binary form of solar.dat and pubhol.dat, and the CSV readers
+ * shared by Calendar and calendar-compile.
+ *
+ * @author kerwin\@localhost
+ */
+#include "debug.h"
+#include "date.h"
+#include "daybitmap.h"
+#include "internedstring.h"
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef KERWIN_CALENDARFILE_H
+#define KERWIN_CALENDARFILE_H
+
+/**
+ * @brief time and number of a solar term in a SolarList
+ */
+struct SolarTime {
+	unsigned int minute;	///< minutes after midnight, hour*60+minute
+	unsigned int term;		///< 0=xiaohan, ..., 23=dongzhi, or
+							///< UNNUMBERED_TERM
+};
+
+const unsigned int UNNUMBERED_TERM = ~0u;
+///< SolarTime::term of a term read from CSV, not yet matched to a term
+
+typedef std::vector<std::pair<int,SolarTime> > SolarList;
+///< solar terms as (MJD, time and number), ascending and unique in MJD
+typedef std::vector<std::pair<int,std::string> > HolidayList;
+///< public holidays as (MJD, description), ascending and unique in MJD
+
+/**
+ * @brief read-only view of a compiled calendar data file
+ *
+ * The file is mapped with mmap and used in place, nothing is parsed.  All
+ * integers are in host byte order; a file written on a machine of the other
+ * byte order is rejected.  Layout, every section 4-byte aligned:
+ *
+ *  - header: magic "KCALDAT", version, byte order mark, FNV-1a checksum of
+ *    everything after the header, solar term count, holiday count, string
+ *    pool size
+ *  - int32  solar term MJD, ascending
+ *  - uint16 solar term minute of day (hour*60+minute), padded to 4 bytes
+ *  - uint8  solar term number, 0=xiaohan, ..., 23=dongzhi, padded to 4 bytes
+ *  - int32  public holiday MJD, ascending
+ *  - uint32 public holiday name offset into the string pool
+ *  - string pool of NUL terminated UTF-8 names, each distinct name once
+ */
+class CalendarFile {
+  public:
+	CalendarFile();
+	~CalendarFile();
+	bool open(char const*);
+	void close();
+	bool isOpen() const;
+	std::size_t getSolarCount() const;
+	int getSolarMJD(std::size_t) const;
+	unsigned int getSolarMinute(std::size_t) const;
+	unsigned int getSolarTerm(std::size_t) const;
+	std::size_t getHolidayCount() const;
+	int getHolidayMJD(std::size_t) const;
+	char const* getHolidayName(std::size_t) const;
+	static void write(std::ostream&, SolarList const&, HolidayList const&);
+	static const unsigned int VERSION = 2;
+	///< format version written, and the only one read
+  private:
+	CalendarFile(CalendarFile const&);
+	CalendarFile& operator=(CalendarFile const&);
+	void* _map;
+	///< start of the mapping, 0 if not open
+	std::size_t _size;
+	///< length of the mapping
+	std::size_t _nSolar;
+	///< number of solar terms
+	std::size_t _nHoliday;
+	///< number of public holidays
+	int const* _solarMJD;
+	///< solar term dates
+	unsigned short const* _solarMinute;
+	///< solar term minutes of day
+	unsigned char const* _solarTerm;
+	///< solar term numbers
+	int const* _holidayMJD;
+	///< public holiday dates
+	unsigned int const* _holidayName;
+	///< public holiday name offsets into _pool
+	char const* _pool;
+	///< string pool
+};
+
+unsigned long readSolarCSV(std::istream&, SolarList&,
+						   std::ostream& =std::cerr);
+unsigned long readPublicHolidayCSV(std::istream&, HolidayList&,
+								   std::ostream& =std::cerr);
+unsigned long readPublicHolidayCSV(std::istream&, DayBitmap&,
+								   std::vector<InternedString>&,
+								   std::ostream& =std::cerr);
+
+// inline function declaration
+/**
+ * @brief check if a file is mapped
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @retval true if open() succeeded and close() was not called since
+ * @retval false otherwise
+ */
+inline
+bool
+CalendarFile::isOpen() const
+{
+	return _map!=0;
+}
+
+/**
+ * @brief number of solar terms in file
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return number of solar terms, 0 if not open
+ */
+inline
+std::size_t
+CalendarFile::getSolarCount() const
+{
+	return _nSolar;
+}
+
+/**
+ * @brief date of a solar term
+ *
+ * This method should be inlined.
+ *
+ * @param i index, less than getSolarCount()
+ *
+ * @return MJD of the i-th solar term in date order
+ */
+inline
+int
+CalendarFile::getSolarMJD(std::size_t i) const
+{
+	return _solarMJD[i];
+}
+
+/**
+ * @brief time of a solar term
+ *
+ * This method should be inlined.
+ *
+ * @param i index, less than getSolarCount()
+ *
+ * @return minutes after midnight of the i-th solar term
+ */
+inline
+unsigned int
+CalendarFile::getSolarMinute(std::size_t i) const
+{
+	return _solarMinute[i];
+}
+
+/**
+ * @brief which solar term it is
+ *
+ * This method should be inlined.
+ *
+ * @param i index, less than getSolarCount()
+ *
+ * @return 0=xiaohan, ..., 23=dongzhi, of the i-th solar term
+ */
+inline
+unsigned int
+CalendarFile::getSolarTerm(std::size_t i) const
+{
+	return _solarTerm[i];
+}
+
+/**
+ * @brief number of public holidays in file
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return number of public holidays, 0 if not open
+ */
+inline
+std::size_t
+CalendarFile::getHolidayCount() const
+{
+	return _nHoliday;
+}
+
+/**
+ * @brief date of a public holiday
+ *
+ * This method should be inlined.
+ *
+ * @param i index, less than getHolidayCount()
+ *
+ * @return MJD of the i-th public holiday in date order
+ */
+inline
+int
+CalendarFile::getHolidayMJD(std::size_t i) const
+{
+	return _holidayMJD[i];
+}
+
+/**
+ * @brief description of a public holiday
+ *
+ * This method should be inlined.
+ *
+ * @param i index, less than getHolidayCount()
+ *
+ * @return NUL terminated UTF-8 name of the i-th public holiday, valid until
+ * close()
+ */
+inline
+char const*
+CalendarFile::getHolidayName(std::size_t i) const
+{
+	return _pool+_holidayName[i];
+}
+
+#endif	// KERWIN_CALENDARFILE_H
@@ -0,0 +1,69 @@
+/**
+ * @file calendarwatcher.h
+ *
+ * Time-stamp: <2026-10-17 20:12:55 +0800 by kerwin>
+ *
+ * Background reload of the data files when they change on disk
+ *
+ * @author kerwin\@localhost
+ */
+#include "debug.h"
+#include "calendardata.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+#ifndef KERWIN_CALENDARWATCHER_H
+#define KERWIN_CALENDARWATCHER_H
+
+/**
+ * @brief reloads the data files when they change
+ *
+ * Watches a directory with inotify from a background thread.  When
+ * solar.dat, pubhol.dat or calendar.bin is written, renamed into place or
+ * removed, the files are reloaded with CalendarData::load() and published
+ * with CalendarData::publish().  Calendars pick the new data up with
+ * Calendar::refresh().
+ *
+ * Only local file systems deliver inotify events.  A burst of events, such
+ * as an editor saving, gives a single reload.
+ */
+class CalendarWatcher {
+  public:
+	CalendarWatcher(std::string const& =".");
+	~CalendarWatcher();
+	unsigned long getReloadCount() const;
+  private:
+	CalendarWatcher(CalendarWatcher const&);
+	CalendarWatcher& operator=(CalendarWatcher const&);
+	std::string _directory;
+	///< directory watched
+	int _inotify;
+	///< inotify descriptor
+	int _stop[2];
+	///< pipe, written to by the destructor to stop the thread
+	std::atomic<unsigned long> _reloads;
+	///< number of reloads published
+	std::thread _thread;
+	///< background thread running run()
+	void run();
+};
+
+// inline function declaration
+/**
+ * @brief number of reloads so far
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return number of times new data was published
+ */
+inline
+unsigned long
+CalendarWatcher::getReloadCount() const
+{
+	return _reloads.load();
+}
+
+#endif	// KERWIN_CALENDARWATCHER_H
@@ -15,9 +15,12 @@
 // header containing debugging stuff.
 #include "debug.h"
 #include "beautyexception.h"
+#include <cstddef>
 
 /* forward declaration */
 class Date;
+struct DateFields;
+struct DayInfo;
 
 /* class definition */
 /**
@@ -26,8 +29,9 @@ class Date;
  * The Date class for storing a date, and converting them between different
  * calendars.
  *
- * Currently only Gregorian and Chinese calendar is supported, and must
- * be within year range 1901--2099 in Gregorian year.
+ * Currently only Gregorian and Chinese calendar is supported.  The Chinese
+ * calendar is read off a table for Gregorian years 1901--2099, and worked
+ * out by LunationEngine for the other years of 1645--2199.
  */
 class Date {
   public:
@@ -77,11 +81,11 @@ class Date {
 		DATEPART_JULIAN_DAY,		///< Julian Day
 	};
 		/* Constructor */
-	Date(int jd=55941, enum CalendarType t=CALTYPE_MJD);
-	Date(int year, unsigned int month, unsigned int day, enum CalendarType t=CALTYPE_GREGORIAN);
+	constexpr Date(int jd=55941, enum CalendarType t=CALTYPE_MJD);
+	constexpr Date(int year, unsigned int month, unsigned int day, enum CalendarType t=CALTYPE_GREGORIAN);
 		/* other methods */
-	int getJD() const;
-	int getMJD() const;
+	constexpr int getJD() const;
+	constexpr int getMJD() const;
 	int getYear() const;
 	unsigned int getMonth() const;
 	unsigned int getDay() const;
@@ -94,11 +98,12 @@ class Date {
 	int getJulianYear() const;
 	unsigned int getJulianMonth() const;
 	unsigned int getJulianDay() const;
-	enum Date::DayOfWeek getDayOfWeek() const;
+	constexpr enum Date::DayOfWeek getDayOfWeek() const;
 	unsigned long long getLunarCalendarData() const;
 	unsigned int getDayOfYear() const;
 	bool isLeap() const;
 	bool isIntercalary() const;
+	struct DateFields decode() const;
 		/* static functions */
 	static unsigned long long getLunarCalendarData(unsigned int);
 		/* operators */
@@ -111,23 +116,79 @@ class Date {
 	int _mjd;			///< Modified Julian Day.
 };
 
+/**
+ * @brief every calendar field of a date, computed in one pass
+ *
+ * Returned by Date::decode().  The structure is a plain value, so it can be
+ * kept around and read from any thread.
+ *
+ * The Chinese fields are only meaningful between the start of 1645 and the
+ * end of 2199; outside that range they are all zero.
+ */
+struct DateFields {
+	int mjd;						///< Modified Julian Day
+	int gregorianYear;				///< Gregorian year
+	unsigned int gregorianMonth;	///< Gregorian month
+	unsigned int gregorianDay;		///< Gregorian day
+	int julianYear;					///< Julian calendar year
+	unsigned int julianMonth;		///< Julian calendar month
+	unsigned int julianDay;			///< Julian calendar day
+	int chineseYear;				///< Chinese year (0 if out of range)
+	unsigned int chineseMonth;		///< Chinese month, +16 if intercalary
+	unsigned int chineseDay;		///< Chinese day (0 if out of range)
+	bool chineseLeap;				///< on an intercalary Chinese month?
+	enum Date::DayOfWeek dayOfWeek;	///< ISO day of week
+	unsigned int dayOfYear;			///< day of Gregorian year, 1 for NY
+};
+
+/**
+ * @brief precomputed calendar fields of one day, packed in 8 bytes
+ *
+ * Unless the program is built with NO_DAYINFO_TABLE, a table of these
+ * covering every day from Chinese New Year 1901 to the end of 2099 is built
+ * on first use (about 570kB), and the Date getters become a single load.
+ * Years are stored as offsets from 1900 to fit in a byte.  Solar terms are
+ * not kept: they come from the data files, see CalendarData.
+ */
+struct DayInfo {
+	unsigned int gregorianYear	: 8;	///< Gregorian year - 1900
+	unsigned int gregorianMonth	: 4;	///< Gregorian month
+	unsigned int gregorianDay	: 5;	///< Gregorian day
+	unsigned int dayOfWeek		: 3;	///< ISO day of week
+	unsigned int dayOfYear		: 9;	///< day of Gregorian year
+	unsigned int chineseYear	: 8;	///< Gregorian year of CNY - 1900
+	unsigned int chineseMonth	: 5;	///< Chinese month, +16 if intercalary
+	unsigned int chineseDay		: 5;	///< Chinese day
+};
+
 /* other related functions */
-bool isLeapYear(int const);
+constexpr bool isLeapYear(int const);
 enum Date::DayOfWeek dayOfWeek(Date const&);
-unsigned int daysInMonth(int, unsigned int);
+constexpr unsigned int daysInMonth(int, unsigned int);
 unsigned int daysInMonth(Date const&);
 bool isIntercalary(Date&); // chinese leap month
-bool operator==(Date const&, Date const&);
-bool operator<(Date const&, Date const&);
-bool operator!=(Date const&, Date const&);
-bool operator<=(Date const&, Date const&);
-bool operator>=(Date const&, Date const&);
-bool operator>(Date const&, Date const&);
-Date operator+(Date const&, int);
-Date operator-(Date const&, int);
+constexpr bool operator==(Date const&, Date const&);
+constexpr bool operator<(Date const&, Date const&);
+constexpr bool operator!=(Date const&, Date const&);
+constexpr bool operator<=(Date const&, Date const&);
+constexpr bool operator>=(Date const&, Date const&);
+constexpr bool operator>(Date const&, Date const&);
+constexpr Date operator+(Date const&, int);
+constexpr Date operator-(Date const&, int);
+constexpr int mjdFromGregorian(int, unsigned int, unsigned int);
+constexpr int mjdFromJulian(int, unsigned int, unsigned int);
+int mjdFromChinese(int, unsigned int, unsigned int);
 int chineseFromMJD(int, enum Date::DatePart);
 int gregorianFromMJD(int, enum Date::DatePart);
 int julianFromMJD(int, enum Date::DatePart);
+void chineseFromMJD(int, int&, unsigned int&, unsigned int&);
+void gregorianFromMJD(int, int&, unsigned int&, unsigned int&);
+void julianFromMJD(int, int&, unsigned int&, unsigned int&);
+DayInfo const* dayInfoFromMJD(int);
+	// batch conversions, in datebatch.cc
+void gregorianFromMJD(int const*, std::size_t, int*, unsigned int*, unsigned int*);
+void julianFromMJD(int const*, std::size_t, int*, unsigned int*, unsigned int*);
+void dayOfWeekFromMJD(int const*, std::size_t, int*);
 
 
 
@@ -180,6 +241,195 @@ int julianFromMJD(int, enum Date::DatePart);
 
 
 /* inline functions */
+/**
+ * @relatesalso Date
+ * @brief compute modified julian day number for Gregorian date
+ *
+ * MJD 0 starts at Gregorian 1858-11-17 0h (Wednesday).
+ *
+ * algorithm as follows
+ @verbatim
+ a = (14-month)/12
+ y = year+4800-a
+ m = month + 12*a - 3
+
+ For a date in the Gregorian calendar:
+ MJD = day + (153*m+2)/5 + y*365 + y/4 - y/100 + y/400 - 2432046
+ @endverbatim
+ *
+ * This is constexpr, so constant dates are worked out by the compiler.
+ *
+ * @param year Gregorian year of date
+ * @param month Gregorian month of date
+ * @param day Gregorian day of date
+ *
+ * @return modified julian day number
+ */
+inline constexpr
+int
+mjdFromGregorian(int year, unsigned int month, unsigned int day)
+{
+	unsigned int a=(14-month)/12;
+	unsigned int y=year+4800-a;
+	unsigned int m=month+12*a-3;
+	int jd=day+(153*m+2)/5+y*365+y/4-y/100+y/400-32045;
+	return jd-2400001;
+}
+
+/**
+ * @relatesalso Date
+ * @brief compute modified julian day number for Julian date
+ *
+ * JD 0 starts at noon 1 January 4713BC in the Julian calendar.
+ * MJD = JD - 2400000.5
+ *
+ * algorithm as follows
+ @verbatim
+ a = (14-month)/12
+ y = year+4800-a
+ m = month + 12*a - 3
+
+ JD = day + (153*m+2)/5 + y*365 + y/4 - 32083
+ @endverbatim
+ *
+ * @param year Julian calendar year of date
+ * @param month Julian calendar month of date
+ * @param day Julian calendar day of date
+ *
+ * @return modified julian day number
+ */
+inline constexpr
+int
+mjdFromJulian(int year, unsigned int month, unsigned int day)
+{
+	unsigned int a=(14-month)/12;
+	unsigned int y=year+4800-a;
+	unsigned int m=month+12*a-3;
+	int jd=day+(153*m+2)/5+y*365+y/4-32083;
+	return jd-2400001;
+}
+
+/**
+ * @brief helper function to decide a year is leap in Gregorian calendar.
+ *
+ * May rename this later to isGregorianLeapYear, if I decide to implement
+ * Julian calendar too, but since Julian leap year is easy it probably won't
+ * happen.
+ *
+ * @param y Gregorian year
+ *
+ * @retval true if y is a leap year in Gregorian calendar
+ * @retval false if y is not a leap year in Gregorian calendar
+ */
+inline constexpr
+bool
+isLeapYear(int const y)
+{
+	if (y % 4) return false;
+	if (y % 100) return true;
+	if (y % 400) return false;
+	return true;
+}
+
+/**
+ * @relatesalso Date
+ * @brief look up the number of days in a Gregorian month
+ *
+ * @param year Gregorian year
+ * @param month Gregorian month
+ *
+ * @return the number of days in the given month
+ */
+inline constexpr
+unsigned int
+daysInMonth(int year, unsigned int month)
+{
+	switch (month) {
+		case 1: case 3: case 5: case 7: case 8: case 10: case 12:
+			return 31;
+		case 2:
+				// can't use Date(year,2,xxx) otherwise infinite loop.
+			return (isLeapYear(year)?29:28);
+		case 4: case 6: case 9: case 11:
+			return 30;
+		default:
+		// shouldn't get here --- month is not a valid month, throwing
+			throw INVALID_PARAM(month);
+	}
+}
+
+/**
+ * @brief constructor
+ *
+ * @param d (Modified) Julian Day (default: MJD 55941 = Gregorian 2012-1-15)
+ * @param t Calendar to which day are measured MJD (default) or JD)
+ */
+inline constexpr
+Date::Date(int d,
+		   enum CalendarType t) : _mjd(0)
+{
+	switch(t){
+		case CALTYPE_MJD :
+			_mjd = d;
+			break;
+		case CALTYPE_JD :
+			_mjd = d-2400001;
+			break;
+		default :
+				// shouldn't be here
+			throw INVALID_PARAM(t);
+	}
+}
+
+/**
+ * @brief another constructor
+ *
+ * Gregorian and Julian dates can be constructed at compile time.
+ *
+ * @param year  year of desired date
+ * @param month month of desired date
+ * @param day   day of desired date
+ * @param t     Calendar to which year, month and day are measured
+ * (currently supported Gregorian, Julian, and Chinese (experimental).)
+ */
+inline constexpr
+Date::Date(int year,
+		   unsigned int month,
+		   unsigned int day,
+		   enum CalendarType t) : _mjd(0)
+{
+	switch(t){
+		case CALTYPE_GREGORIAN :
+			_mjd = mjdFromGregorian(year,month,day);
+			break;
+		case CALTYPE_JULIAN :
+			_mjd = mjdFromJulian(year,month,day);
+			break;
+		case CALTYPE_CHINESE :
+			_mjd = mjdFromChinese(year,month,day);
+			break;
+		default :
+			throw INVALID_PARAM(t);
+	}
+}
+
+/**
+ * @brief ISO day of week of this date object
+ *
+ * Epoch of modified Julian date is 1858-11-17 0h (Wednesday).
+ * So day of week is (MJD+3) mod 7.
+ *
+ * This function takes no argument.
+ *
+ * @return ISO day of week
+ */
+inline constexpr
+enum Date::DayOfWeek
+Date::getDayOfWeek() const
+{
+	return Date::DayOfWeek((_mjd+3)%7);
+}
+
 /**
  * @brief get the Gregorian year
  *
@@ -252,7 +502,7 @@ Date::getDay() const {
  *
  * @return Julian Day of this date at noon
  */
-inline
+inline constexpr
 int
 Date::getJD() const {
 	return _mjd+2400001;
@@ -267,7 +517,7 @@ Date::getJD() const {
  *
  * @return Modified Julian Day of this date at midnight
  */
-inline
+inline constexpr
 int
 Date::getMJD() const
 {
@@ -575,13 +825,10 @@ unsigned int daysInMonth(Date const& d) {
  * @retval true if two dates are equal (same year, same month, same day)
  * @retval false otherwise
  */
-inline
+inline constexpr
 bool
 operator==(Date const& d1, Date const& d2)
 {
-#ifdef DEBUG
-	MY_ERR << "*" << &d1 <<  " == *" << &d2 << " called." << std::endl;
-#endif	// DEBUG
 	return (d1.getMJD() == d2.getMJD());
 }
 
@@ -595,13 +842,10 @@ operator==(Date const& d1, Date const& d2)
  * @retval true if d1 is before d2
  * @retval false othwerwise
  */
-inline
+inline constexpr
 bool
 operator<(Date const& d1, Date const& d2)
 {
-#ifdef DEBUG
-	MY_ERR << "*" << &d1 <<  " < *" << &d2 << " called." << std::endl;
-#endif	// DEBUG
 	return (d1.getMJD() < d2.getMJD());
 }
 
@@ -616,12 +860,9 @@ operator<(Date const& d1, Date const& d2)
  *
  * @return true if and only if the two dates are different.
  */
-inline
+inline constexpr
 bool
 operator!=(Date const& d1, Date const& d2){
-#ifdef DEBUG
-	MY_ERR << "inline *" << &d1 << " != *" << &d2 << ") called." << std::endl;
-#endif	// DEBUG
 	return !(d1==d2);
 }
 
@@ -636,12 +877,9 @@ operator!=(Date const& d1, Date const& d2){
  *
  * @return true if and only if date d1 is on or before date d2.
  */
-inline
+inline constexpr
 bool
 operator<=(Date const& d1, Date const& d2){
-#ifdef DEBUG
-	MY_ERR << "inline *" << &d1 << " <= *" << &d2 << ") called." << std::endl;
-#endif	// DEBUG
 	return ((d1<d2)||(d1==d2));
 }
 
@@ -656,12 +894,9 @@ operator<=(Date const& d1, Date const& d2){
  *
  * @return true if and only if date d1 is after date d2.
  */
-inline
+inline constexpr
 bool
 operator>(Date const& d1, Date const& d2){
-#ifdef DEBUG
-	MY_ERR << "inline *" << &d1 << " > *" << &d2 << ") called." << std::endl;
-#endif	// DEBUG
 	return (d2<d1);
 }
 
@@ -676,12 +911,9 @@ operator>(Date const& d1, Date const& d2){
  *
  * @return true if and only if date d1 is on or after date d2.
  */
-inline
+inline constexpr
 bool
 operator>=(Date const& d1, Date const& d2){
-#ifdef DEBUG
-	MY_ERR << "inline *" << &d1 << " >= *" << &d2 << ") called." << std::endl;
-#endif	// DEBUG
 	return ((d1>d2)||(d1==d2));
 }
 
@@ -732,7 +964,7 @@ operator-=(Date & d, int n)
  * @retval true success!
  * @retval false shouldn't happen
  */
-inline
+inline constexpr
 Date
 operator+(Date const& d, int n)
 {
@@ -749,7 +981,7 @@ operator+(Date const& d, int n)
  * @retval true success!
  * @retval false shouldn't happen
  */
-inline
+inline constexpr
 Date
 operator-(Date const& d, int n)
 {
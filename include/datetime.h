@@ -0,0 +1,334 @@
+/**
+ * @file datetime.h
+ *
+ * Time-stamp: <2026-10-18 01:05:12 +0800 by kerwin>
+ *
+ * A Date with the time of day, to the minute
+ *
+ * @author kerwin\@localhost
+ */
+
+#ifndef KERWIN_DATETIME_H
+#define KERWIN_DATETIME_H
+
+#include "debug.h"
+#include "date.h"
+
+/**
+ * @brief an instant, to the minute
+ *
+ * Kept as the number of minutes since MJD 0 at 0h, so arithmetic and
+ * comparisons are on a single integer.  Like the data files, it carries
+ * no time zone; solar terms are in Chinese Standard Time.
+ */
+class DateTime {
+  public:
+	static const int MINUTES_PER_DAY=24*60;
+	///< minutes in a day
+	constexpr explicit DateTime(long long m=0);
+	constexpr DateTime(Date const&, unsigned int=0);
+	constexpr long long getMinutes() const;
+	constexpr Date getDate() const;
+	constexpr unsigned int getMinuteOfDay() const;
+	constexpr unsigned int getHour() const;
+	constexpr unsigned int getMinute() const;
+	DateTime& operator+=(long long);
+	DateTime& operator-=(long long);
+  private:
+	long long _minutes;	///< minutes since MJD 0 at 0h
+};
+
+/* inline functions */
+/**
+ * @brief constructor from a number of minutes
+ *
+ * This method should be inlined.
+ *
+ * @param m minutes since MJD 0 at 0h
+ */
+inline constexpr
+DateTime::DateTime(long long m) : _minutes(m)
+{
+}
+
+/**
+ * @brief constructor from a date and the time of day
+ *
+ * This method should be inlined.
+ *
+ * @param d date
+ * @param minute minutes after midnight, may be a day or more
+ */
+inline constexpr
+DateTime::DateTime(Date const& d, unsigned int minute) :
+	_minutes((long long)d.getMJD()*MINUTES_PER_DAY+minute)
+{
+}
+
+/**
+ * @brief minutes since MJD 0 at 0h
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return number of minutes, negative before MJD 0
+ */
+inline constexpr
+long long
+DateTime::getMinutes() const
+{
+	return _minutes;
+}
+
+/**
+ * @brief the date of the instant
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return the day the instant falls on
+ */
+inline constexpr
+Date
+DateTime::getDate() const
+{
+	return Date(int(_minutes>=0 ? _minutes/MINUTES_PER_DAY :
+					-((MINUTES_PER_DAY-1-_minutes)/MINUTES_PER_DAY)));
+}
+
+/**
+ * @brief the time of day of the instant
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return minutes after midnight, 0--1439
+ */
+inline constexpr
+unsigned int
+DateTime::getMinuteOfDay() const
+{
+	return (unsigned int)(_minutes-(long long)getDate().getMJD()*
+						  MINUTES_PER_DAY);
+}
+
+/**
+ * @brief the hour of the instant
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return hour, 0--23
+ */
+inline constexpr
+unsigned int
+DateTime::getHour() const
+{
+	return getMinuteOfDay()/60;
+}
+
+/**
+ * @brief the minute of the hour of the instant
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return minute, 0--59
+ */
+inline constexpr
+unsigned int
+DateTime::getMinute() const
+{
+	return getMinuteOfDay()%60;
+}
+
+/**
+ * @brief step forward by n minutes
+ *
+ * This method should be inlined.
+ *
+ * @param n number of minutes, may be negative
+ *
+ * @return this instant
+ */
+inline
+DateTime&
+DateTime::operator+=(long long n)
+{
+	_minutes+=n;
+	return *this;
+}
+
+/**
+ * @brief step backward by n minutes
+ *
+ * This method should be inlined.
+ *
+ * @param n number of minutes, may be negative
+ *
+ * @return this instant
+ */
+inline
+DateTime&
+DateTime::operator-=(long long n)
+{
+	_minutes-=n;
+	return *this;
+}
+
+/**
+ * @relatesalso DateTime
+ * @brief an instant n minutes later
+ *
+ * @param t an instant
+ * @param n number of minutes, may be negative
+ *
+ * @return new instant
+ */
+inline constexpr
+DateTime
+operator+(DateTime const& t, long long n)
+{
+	return DateTime(t.getMinutes()+n);
+}
+
+/**
+ * @relatesalso DateTime
+ * @brief an instant n minutes earlier
+ *
+ * @param t an instant
+ * @param n number of minutes, may be negative
+ *
+ * @return new instant
+ */
+inline constexpr
+DateTime
+operator-(DateTime const& t, long long n)
+{
+	return DateTime(t.getMinutes()-n);
+}
+
+/**
+ * @relatesalso DateTime
+ * @brief time between two instants
+ *
+ * @param t1 an instant
+ * @param t2 another instant
+ *
+ * @return minutes from t2 to t1, negative if t1 is before t2
+ */
+inline constexpr
+long long
+operator-(DateTime const& t1, DateTime const& t2)
+{
+	return t1.getMinutes()-t2.getMinutes();
+}
+
+/**
+ * @relatesalso DateTime
+ * @brief check if two instants are equal
+ *
+ * @param t1 an instant
+ * @param t2 another instant
+ *
+ * @retval true if the instants are the same minute
+ * @retval false otherwise
+ */
+inline constexpr
+bool
+operator==(DateTime const& t1, DateTime const& t2)
+{
+	return (t1.getMinutes() == t2.getMinutes());
+}
+
+/**
+ * @relatesalso DateTime
+ * @brief check if one instant is before another
+ *
+ * @param t1 an instant
+ * @param t2 another instant
+ *
+ * @retval true if t1 is before t2
+ * @retval false otherwise
+ */
+inline constexpr
+bool
+operator<(DateTime const& t1, DateTime const& t2)
+{
+	return (t1.getMinutes() < t2.getMinutes());
+}
+
+/**
+ * @relatesalso DateTime
+ * @brief compare two instants
+ *
+ * This function should be inlined.  Provided for convenience only.
+ *
+ * @param t1 first instant
+ * @param t2 another instant
+ *
+ * @return true if and only if the two instants are different.
+ */
+inline constexpr
+bool
+operator!=(DateTime const& t1, DateTime const& t2){
+	return !(t1==t2);
+}
+
+/**
+ * @relatesalso DateTime
+ * @brief compare two instants
+ *
+ * This function should be inlined.  Provided for convenience only.
+ *
+ * @param t1 first instant
+ * @param t2 another instant
+ *
+ * @return true if and only if t1 is at or before t2.
+ */
+inline constexpr
+bool
+operator<=(DateTime const& t1, DateTime const& t2){
+	return !(t2<t1);
+}
+
+/**
+ * @relatesalso DateTime
+ * @brief compare two instants
+ *
+ * This function should be inlined.  Provided for convenience only.
+ *
+ * @param t1 first instant
+ * @param t2 another instant
+ *
+ * @return true if and only if t1 is after t2.
+ */
+inline constexpr
+bool
+operator>(DateTime const& t1, DateTime const& t2){
+	return (t2<t1);
+}
+
+/**
+ * @relatesalso DateTime
+ * @brief compare two instants
+ *
+ * This function should be inlined.  Provided for convenience only.
+ *
+ * @param t1 first instant
+ * @param t2 another instant
+ *
+ * @return true if and only if t1 is at or after t2.
+ */
+inline constexpr
+bool
+operator>=(DateTime const& t1, DateTime const& t2){
+	return !(t1<t2);
+}
+
+#endif	// KERWIN_DATETIME_H
@@ -0,0 +1,130 @@
+/**
+ * @file daybitmap.h
+ *
+ * Time-stamp: <2026-10-17 11:02:18 +0800 by kerwin>
+ *
+ * One bit per day for every day of 1901--2099, with rank, count and scan.
+ *
+ * @author kerwin\@localhost
+ */
+
+#ifndef KERWIN_DAYBITMAP_H
+#define KERWIN_DAYBITMAP_H
+
+#include "debug.h"
+#include "date.h"
+#include <vector>
+
+/**
+ * @brief set of days, one bit per day
+ *
+ * Covers every day from 1901-01-01 to 2099-12-31 in about 9kB.  Membership
+ * is a single bit test; rank() and count() use per-word prefix counts and
+ * popcount.  select() guesses the word from the prefix counts as if the
+ * members were spread evenly, walks the prefix counts to the right word,
+ * which is a step or two for solar terms and holidays, then selects within
+ * the word with broadword popcounts.  findNext()/findPrevious() scan a word
+ * at a time.
+ *
+ * Days outside the range are never members.  rank() and count() need the
+ * prefix counts, which set() and reset() invalidate; call buildIndex() after
+ * a batch of updates.  insert() and erase() instead bring the counts after
+ * the day up to date, for the odd single update.
+ */
+class DayBitmap {
+  public:
+	DayBitmap();
+	bool test(Date const&) const;
+	void set(Date const&);
+	void reset(Date const&);
+	void insert(Date const&);
+	void erase(Date const&);
+	void clear();
+	void buildIndex();
+	unsigned int rank(Date const&) const;
+	unsigned int count() const;
+	unsigned int count(Date const&, Date const&) const;
+	bool findNext(Date&) const;
+	bool findPrevious(Date&) const;
+	bool select(unsigned int, Date&) const;
+	DayBitmap& operator-=(DayBitmap const&);
+	static DayBitmap daysOfWeek(unsigned int);
+	static int firstMJD();
+	static int lastMJD();
+	static bool covers(int);
+  private:
+	std::vector<unsigned long long> _word;
+	///< the bits, day firstMJD()+i is bit i%64 of word i/64
+	std::vector<unsigned int> _rank;
+	///< number of bits set in the words before each word
+	bool _indexed;
+	///< is _rank up to date?
+	unsigned int rankOf(int) const;
+};
+
+// inline function declaration
+/**
+ * @brief first day covered
+ *
+ * This function takes no argument.
+ *
+ * @return MJD of 1901-01-01
+ */
+inline
+int
+DayBitmap::firstMJD()
+{
+	return mjdFromGregorian(1901,1,1);
+}
+
+/**
+ * @brief last day covered
+ *
+ * This function takes no argument.
+ *
+ * @return MJD of 2099-12-31
+ */
+inline
+int
+DayBitmap::lastMJD()
+{
+	return mjdFromGregorian(2099,12,31);
+}
+
+/**
+ * @brief check if a day is in the range of a bitmap
+ *
+ * This method should be inlined.
+ *
+ * @param mjd MJD of the day
+ *
+ * @retval true if 1901-01-01 <= mjd <= 2099-12-31
+ * @retval false otherwise
+ */
+inline
+bool
+DayBitmap::covers(int mjd)
+{
+	return (mjd>=firstMJD()) && (mjd<=lastMJD());
+}
+
+/**
+ * @brief check if a day is in the set
+ *
+ * This method should be inlined.
+ *
+ * @param d the date we want to check
+ *
+ * @retval true d is in the set
+ * @retval false d is not in the set, or outside 1901--2099
+ */
+inline
+bool
+DayBitmap::test(Date const& d) const
+{
+	unsigned int i=d.getMJD()-firstMJD();
+	if (i>(unsigned int)(lastMJD()-firstMJD())) return false;
+	return (_word[i>>6]>>(i & 63)) & 1;
+}
+
+#endif	// KERWIN_DAYBITMAP_H
@@ -0,0 +1,210 @@
+/**
+ * @file fragmentcache.h
+ *
+ * Time-stamp: <2026-10-17 23:12:09 +0800 by kerwin>
+ *
+ * Directory of rendered TeX fragments, kept between runs
+ *
+ * @author kerwin\@localhost
+ */
+#include "debug.h"
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+#ifndef KERWIN_FRAGMENTCACHE_H
+#define KERWIN_FRAGMENTCACHE_H
+
+/**
+ * @brief 64-bit FNV-1a hash of everything a fragment depends on
+ *
+ * Feed it the program's output format version and every input of the
+ * fragment; two fragments with the same key are taken to be identical.
+ */
+class FragmentKey {
+  public:
+	FragmentKey();
+	FragmentKey& add(char const*, std::size_t);
+	FragmentKey& add(std::string const&);
+	FragmentKey& add(unsigned int);
+	unsigned long long getValue() const;
+  private:
+	unsigned long long _hash;
+	///< hash so far
+};
+
+/**
+ * @brief rendered TeX fragments kept as files in a directory
+ *
+ * Each fragment is a file named after its FragmentKey, so several
+ * processes may share the directory.  Files are written to a temporary
+ * name and renamed into place, so a reader never sees half a fragment.
+ * When the files add up to more than the size limit, the oldest written
+ * are removed until a quarter of the limit is free.
+ *
+ * All methods may be called from several threads.
+ */
+class FragmentCache {
+  public:
+	static const unsigned long long DEFAULT_SIZE=64ull<<20;
+	///< default size limit, 64MB
+	FragmentCache(std::string const&, unsigned long long=DEFAULT_SIZE);
+	bool find(FragmentKey const&, std::string&);
+	void insert(FragmentKey const&, std::string const&);
+	unsigned long getHits() const;
+	unsigned long getMisses() const;
+	unsigned long getEvictions() const;
+  private:
+	FragmentCache(FragmentCache const&);
+	FragmentCache& operator=(FragmentCache const&);
+	std::string _directory;
+	///< where the fragments are
+	unsigned long long _limit;
+	///< size limit in bytes
+	std::mutex _lock;
+	///< guards _size and eviction
+	unsigned long long _size;
+	///< bytes of fragments in the directory, as far as we know
+	std::atomic<unsigned long> _hits;
+	///< fragments found
+	std::atomic<unsigned long> _misses;
+	///< fragments not found
+	std::atomic<unsigned long> _evictions;
+	///< fragments removed to keep under the limit
+	std::atomic<unsigned long> _serial;
+	///< numbers the temporary files of this object
+	std::string path(FragmentKey const&) const;
+	void evict();
+};
+
+// inline function declaration
+/**
+ * @brief constructor, the hash of nothing
+ *
+ * This method should be inlined.
+ */
+inline
+FragmentKey::FragmentKey() : _hash(14695981039346656037ull)
+{
+}
+
+/**
+ * @brief add bytes to the hash
+ *
+ * This method should be inlined.
+ *
+ * @param s data
+ * @param n number of bytes
+ *
+ * @return this key
+ */
+inline
+FragmentKey&
+FragmentKey::add(char const* s, std::size_t n)
+{
+	for (std::size_t i=0; i<n; i++) {
+		_hash=(_hash^static_cast<unsigned char>(s[i]))*1099511628211ull;
+	}
+	return *this;
+}
+
+/**
+ * @brief add a string, and its length, to the hash
+ *
+ * This method should be inlined.
+ *
+ * @param s string
+ *
+ * @return this key
+ */
+inline
+FragmentKey&
+FragmentKey::add(std::string const& s)
+{
+	add(static_cast<unsigned int>(s.size()));
+	return add(s.data(),s.size());
+}
+
+/**
+ * @brief add a number to the hash
+ *
+ * This method should be inlined.
+ *
+ * @param n number
+ *
+ * @return this key
+ */
+inline
+FragmentKey&
+FragmentKey::add(unsigned int n)
+{
+	char s[4]={char(n), char(n>>8), char(n>>16), char(n>>24)};
+	return add(s,4);
+}
+
+/**
+ * @brief the hash
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return 64-bit hash
+ */
+inline
+unsigned long long
+FragmentKey::getValue() const
+{
+	return _hash;
+}
+
+/**
+ * @brief number of fragments found
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return cache hits so far
+ */
+inline
+unsigned long
+FragmentCache::getHits() const
+{
+	return _hits.load();
+}
+
+/**
+ * @brief number of fragments not found
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return cache misses so far
+ */
+inline
+unsigned long
+FragmentCache::getMisses() const
+{
+	return _misses.load();
+}
+
+/**
+ * @brief number of fragments removed to keep under the size limit
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return evictions so far
+ */
+inline
+unsigned long
+FragmentCache::getEvictions() const
+{
+	return _evictions.load();
+}
+
+#endif	// KERWIN_FRAGMENTCACHE_H
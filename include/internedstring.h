@@ -0,0 +1,127 @@
+/**
+ * @file internedstring.h
+ *
+ * Time-stamp: <2026-10-18 00:21:47 +0800 by kerwin>
+ *
+ * Process wide pool of strings, each kept once
+ *
+ * @author kerwin\@localhost
+ */
+#include "debug.h"
+#include <cstddef>
+#include <string>
+
+#ifndef KERWIN_INTERNEDSTRING_H
+#define KERWIN_INTERNEDSTRING_H
+
+/**
+ * @brief handle to a string kept once for the whole process
+ *
+ * Equal strings give handles to the same copy, so comparing two handles
+ * compares pointers.  The pool only grows and is never freed: a handle,
+ * and the references it hands out, stay valid until the process exits, so
+ * handles are cheap to copy and may be shared between threads freely.
+ * Meant for the small set of holiday descriptions and labels repeated year
+ * after year, not for arbitrary text.
+ */
+class InternedString {
+  public:
+	InternedString();
+	explicit InternedString(std::string const&);
+	InternedString(char const*, std::size_t);
+	std::string const& str() const;
+	char const* data() const;
+	std::size_t size() const;
+	bool operator==(InternedString const&) const;
+	bool operator!=(InternedString const&) const;
+	static std::size_t getPoolCount();
+	static std::size_t getPoolBytes();
+  private:
+	std::string const* _text;
+	///< the only copy of the string, in the pool
+};
+
+// inline function declaration
+/**
+ * @brief the string
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return reference valid until the process exits
+ */
+inline
+std::string const&
+InternedString::str() const
+{
+	return *_text;
+}
+
+/**
+ * @brief characters of the string, null terminated
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return pointer valid until the process exits
+ */
+inline
+char const*
+InternedString::data() const
+{
+	return _text->c_str();
+}
+
+/**
+ * @brief length of the string
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return number of bytes, without the terminating null
+ */
+inline
+std::size_t
+InternedString::size() const
+{
+	return _text->size();
+}
+
+/**
+ * @brief check if two handles give the same string
+ *
+ * This method should be inlined.
+ *
+ * @param s other handle
+ *
+ * @retval true if the strings are equal
+ * @retval false otherwise
+ */
+inline
+bool
+InternedString::operator==(InternedString const& s) const
+{
+	return _text==s._text;
+}
+
+/**
+ * @brief check if two handles give different strings
+ *
+ * This method should be inlined.
+ *
+ * @param s other handle
+ *
+ * @retval true if the strings differ
+ * @retval false otherwise
+ */
+inline
+bool
+InternedString::operator!=(InternedString const& s) const
+{
+	return _text!=s._text;
+}
+
+#endif	// KERWIN_INTERNEDSTRING_H
@@ -0,0 +1,52 @@
+/**
+ * @file lunation.h
+ *
+ * Time-stamp: <2026-10-18 03:02:51 +0800 by kerwin>
+ *
+ * New moons, and the Chinese calendar worked out from them
+ *
+ * @author kerwin\@localhost
+ */
+#include "debug.h"
+#include "date.h"
+
+#ifndef KERWIN_LUNATION_H
+#define KERWIN_LUNATION_H
+
+/**
+ * @brief computes new moons and the Chinese calendar of any year
+ *
+ * New moons come from the lunation series of Meeus (Astronomical
+ * Algorithms, chapter 49), solar terms from SolarTermEngine.  A Chinese
+ * year is then laid out by the rules in use since 1645: a month begins on
+ * the day of a new moon, the winter solstice falls in the 11th month, and
+ * when 13 months separate two 11th months the first of them without a
+ * principal term is intercalary.  Days are counted in Chinese Standard
+ * Time (UTC+8) from 1929, in Beijing mean time before.
+ *
+ * Date uses this for years outside its lunar table, 1901--2099, and keeps
+ * the results in the packed format of the table.  Nothing is kept here, so
+ * all methods may be called from several threads.
+ *
+ * Over 1901--2099 the engine agrees with the table but for six years, in
+ * each of which one month begins a day apart, so it and the month before
+ * differ in length:
+ *  - 1906, 1989, 2057, 2089 and 2097, where that new moon falls within 8
+ *    minutes of midnight and the table, from the almanac, is kept;
+ *  - 2025, where the new moon of the 4th month is at 03:31 on 28 April and
+ *    the table has the month begin on the 27th.
+ * bench/lunationcheck, run by make stress, fails on any other difference.
+ */
+class LunationEngine {
+  public:
+	static const int FIRST_YEAR=1645;
+	///< first Gregorian year supported, that of the Shixian calendar
+	static const int LAST_YEAR=2199;
+	///< last Gregorian year supported
+	static double getNewMoon(int);
+	static void getChineseYear(int, int&, unsigned int&, unsigned int&);
+  private:
+	LunationEngine();
+};
+
+#endif	// KERWIN_LUNATION_H
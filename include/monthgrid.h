@@ -0,0 +1,153 @@
+/**
+ * @file monthgrid.h
+ *
+ * Time-stamp: <2026-10-17 22:31:40 +0800 by kerwin>
+ *
+ * Layout of the month-to-view pages, worked out at compile time
+ *
+ * @author kerwin\@localhost
+ */
+#include "debug.h"
+#include "date.h"
+
+#ifndef KERWIN_MONTHGRID_H
+#define KERWIN_MONTHGRID_H
+
+/**
+ * @brief layout of one month-to-view page
+ *
+ * The page is a grid of cells, seven to a row, starting on weekday layout:
+ * Sunday, Monday for a 31-day month starting on Friday, or Saturday for a
+ * month other than February starting on Saturday.  The small last/next
+ * month cells go top left, or bottom right if the first row is short of
+ * room.  A non-leap February starting on Sunday fills exactly four rows,
+ * and gets an extra row of empty cells with the small months at its end.
+ *
+ * The grid is a list of slots, filled in order by an output format; a
+ * GRID_DAY slot takes the next day of the month.  The grid depends on the
+ * month, its first weekday and the leap year only, so every grid of
+ * 1901--2099, and of any other year, is one of the 14 year shapes * 12
+ * months built by makeMonthGrid() at compile time.
+ */
+struct MonthGrid {
+	/**
+	 * @brief kind of slot
+	 */
+	enum Slot {
+		GRID_DAY,			///< cell for the next day
+		GRID_EMPTY,			///< empty cell
+		GRID_BREAK,			///< end of a row
+		GRID_BREAK_SPACE,	///< end of a row in the short February
+		GRID_TOP,			///< small months, top left
+		GRID_BOTTOM			///< small months, bottom right
+	};
+	static const unsigned int MAX_SLOTS=64;
+	///< upper bound on the number of slots of a month
+	unsigned char layout;
+	///< weekday of the first column, Date::DayOfWeek
+	unsigned char size;
+	///< number of slots used
+	unsigned char slot[MAX_SLOTS];
+	///< the slots, MonthGrid::Slot
+};
+
+/**
+ * @brief grids of every year shape
+ *
+ * Indexed by 2*(weekday of 1 January)+(1 for a leap year), then by month-1.
+ */
+struct MonthGridTable {
+	MonthGrid grid[14][12];
+	///< the grids
+};
+
+constexpr MonthGrid makeMonthGrid(unsigned int, unsigned int, bool);
+constexpr MonthGridTable makeMonthGridTable();
+MonthGrid const& monthGrid(int, unsigned int);
+
+// inline function declaration
+/**
+ * @relatesalso MonthGrid
+ * @brief work out the grid of a month
+ *
+ * This function should be inlined.
+ *
+ * @param first weekday of the first of the month, Date::DayOfWeek
+ * @param days number of days in the month
+ * @param february true for February
+ *
+ * @return the grid
+ */
+inline constexpr
+MonthGrid
+makeMonthGrid(unsigned int first, unsigned int days, bool february)
+{
+	MonthGrid res{0,0,{0}};
+	unsigned int layout=0;
+	if ((first==Date::DOW_SATURDAY) && !february) layout=6;
+	else if ((first==Date::DOW_FRIDAY) && (days==31)) layout=1;
+	res.layout=layout;
+	unsigned int last=(first+days-1)%7;
+
+	if (february && (first==Date::DOW_SUNDAY) && (days==28)) {
+		for (unsigned int d=0; d<days; d++) {
+			if (d && ((first+d)%7==layout)) {
+				res.slot[res.size++]=MonthGrid::GRID_BREAK_SPACE;
+			}
+			res.slot[res.size++]=MonthGrid::GRID_DAY;
+		}
+		res.slot[res.size++]=MonthGrid::GRID_BREAK;
+		for (unsigned int i=0; i<7; i++) {
+			res.slot[res.size++]=MonthGrid::GRID_EMPTY;
+		}
+		res.slot[res.size++]=MonthGrid::GRID_BOTTOM;
+		return res;
+	}
+
+		// small months on top unless the first row is short of room
+	bool top=(first!=layout) && (first!=(layout+1)%7);
+	if (top) res.slot[res.size++]=MonthGrid::GRID_TOP;
+	for (unsigned int i=layout; i!=first; i=(i+1)%7) {
+		res.slot[res.size++]=MonthGrid::GRID_EMPTY;
+	}
+	for (unsigned int d=0; d<days; d++) {
+		if (d && ((first+d)%7==layout)) {
+			res.slot[res.size++]=MonthGrid::GRID_BREAK;
+		}
+		res.slot[res.size++]=MonthGrid::GRID_DAY;
+	}
+	for (unsigned int i=last; i!=(layout+6)%7; i=(i+1)%7) {
+		res.slot[res.size++]=MonthGrid::GRID_EMPTY;
+	}
+	if (!top) res.slot[res.size++]=MonthGrid::GRID_BOTTOM;
+	return res;
+}
+
+/**
+ * @relatesalso MonthGrid
+ * @brief work out the grids of every year shape
+ *
+ * This function should be inlined.
+ *
+ * This function takes no argument.
+ *
+ * @return grids of the 14 year shapes
+ */
+inline constexpr
+MonthGridTable
+makeMonthGridTable()
+{
+	MonthGridTable res{};
+	for (unsigned int shape=0; shape<14; shape++) {
+		int year=(shape & 1) ? 2000 : 2001;
+		unsigned int first=shape/2;
+		for (unsigned int month=1; month<=12; month++) {
+			unsigned int days=daysInMonth(year,month);
+			res.grid[shape][month-1]=makeMonthGrid(first,days,month==2);
+			first=(first+days)%7;
+		}
+	}
+	return res;
+}
+
+#endif	// KERWIN_MONTHGRID_H
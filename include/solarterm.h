@@ -0,0 +1,45 @@
+/**
+ * @file solarterm.h
+ *
+ * Time-stamp: <2026-10-18 02:14:36 +0800 by kerwin>
+ *
+ * Solar term instants worked out from the position of the Sun
+ *
+ * @author kerwin\@localhost
+ */
+#include "debug.h"
+#include "date.h"
+#include "datetime.h"
+#include "calendarfile.h"
+
+#ifndef KERWIN_SOLARTERM_H
+#define KERWIN_SOLARTERM_H
+
+/**
+ * @brief computes when the 24 solar terms begin
+ *
+ * Solar term k of a Gregorian year, 0=xiaohan, ..., 23=dongzhi, begins
+ * when the apparent longitude of the Sun reaches 285+15k degrees.  The
+ * longitude comes from the VSOP87 series for the Earth as truncated by
+ * Meeus (Astronomical Algorithms, appendix III), with nutation and
+ * aberration; the instant is found by Newton iteration and converted to
+ * Chinese Standard Time (UTC+8) with the Espenak-Meeus polynomials for
+ * Delta T.  Against the almanac the result is within a minute.
+ *
+ * Results are kept per year for the whole process; all methods may be
+ * called from several threads.
+ */
+class SolarTermEngine {
+  public:
+	static const unsigned int TERMS=24;
+	///< solar terms in a year
+	static DateTime getInstant(int, unsigned int);
+	static void getYear(int, DateTime (&)[TERMS]);
+	static unsigned int getTerm(int);
+	static unsigned long fill(SolarList&, int, int);
+	static double getDeltaT(double);
+  private:
+	SolarTermEngine();
+};
+
+#endif	// KERWIN_SOLARTERM_H
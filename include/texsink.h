@@ -0,0 +1,298 @@
+/**
+ * @file texsink.h
+ *
+ * Time-stamp: <2026-10-17 21:48:03 +0800 by kerwin>
+ *
+ * Destinations the TeX code is written to as it is rendered, and the buffer
+ * it is rendered into
+ *
+ * @author kerwin\@localhost
+ */
+#include "debug.h"
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifndef KERWIN_TEXSINK_H
+#define KERWIN_TEXSINK_H
+
+/**
+ * @brief where rendered TeX code goes
+ *
+ * Calendar writes each page to a sink as soon as it is rendered, so a
+ * document is never held in memory as a whole unless the sink keeps it.
+ * Write errors throw Exception.
+ */
+class TexSink {
+  public:
+	virtual ~TexSink();
+	virtual void write(char const*, std::size_t)=0;
+	virtual void flush();
+	void write(std::string const&);
+};
+
+/**
+ * @brief sink appending to a string
+ */
+class StringSink : public TexSink {
+  public:
+	StringSink(std::string&);
+	void write(char const*, std::size_t);
+	using TexSink::write;
+  private:
+	std::string& _res;
+	///< string appended to
+};
+
+/**
+ * @brief sink writing to a std::ostream
+ */
+class StreamSink : public TexSink {
+  public:
+	StreamSink(std::ostream&);
+	void write(char const*, std::size_t);
+	void flush();
+	using TexSink::write;
+  private:
+	std::ostream& _out;
+	///< stream written to
+};
+
+/**
+ * @brief sink writing to a file descriptor
+ *
+ * Small writes are gathered in a buffer; a write too large for it goes out
+ * together with the buffer in a single writev(), without being copied.
+ * The descriptor is not closed.
+ */
+class FdSink : public TexSink {
+  public:
+	FdSink(int);
+	~FdSink();
+	void write(char const*, std::size_t);
+	void flush();
+	using TexSink::write;
+  private:
+	FdSink(FdSink const&);
+	FdSink& operator=(FdSink const&);
+	int _fd;
+	///< file descriptor written to
+	std::vector<char> _buffer;
+	///< data not yet written
+	std::size_t _used;
+	///< bytes of _buffer in use
+	void writeAll(char const*, std::size_t, std::size_t);
+};
+
+/**
+ * @brief a string of known length, such as an entry of a name table
+ */
+struct TexFragment {
+	char const* text;
+	///< the characters, not necessarily NUL terminated
+	std::size_t size;
+	///< number of characters
+};
+
+/**
+ * @brief formats TeX code into a reusable string
+ *
+ * A lightweight replacement for std::ostringstream: appends string
+ * literals, fragments and numbers to a string that is cleared but not
+ * freed, so once the string has grown to the size of a page, rendering
+ * the next page allocates nothing.  Keep the string around, e.g. as a
+ * thread_local, and use one TexBuffer on it at a time.
+ */
+class TexBuffer {
+  public:
+	TexBuffer(std::string&);
+	TexBuffer& operator<<(TexFragment const&);
+	TexBuffer& operator<<(std::string const&);
+	TexBuffer& operator<<(char);
+	TexBuffer& operator<<(unsigned int);
+	TexBuffer& operator<<(int);
+	template <std::size_t N>
+	TexBuffer& operator<<(char const (&)[N]);
+	TexBuffer& appendNumber(unsigned int, unsigned int);
+	std::string const& str() const;
+  private:
+	std::string& _res;
+	///< string formatted into
+};
+
+// inline function declaration
+/**
+ * @brief write a string
+ *
+ * This method should be inlined.
+ *
+ * @param s string to write
+ */
+inline
+void
+TexSink::write(std::string const& s)
+{
+	write(s.data(),s.size());
+}
+
+/**
+ * @brief constructor, clears the string but keeps its storage
+ *
+ * This method should be inlined.
+ *
+ * @param res string the TeX code is formatted into
+ */
+inline
+TexBuffer::TexBuffer(std::string& res) : _res(res)
+{
+	_res.clear();
+}
+
+/**
+ * @brief append a fragment
+ *
+ * This method should be inlined.
+ *
+ * @param f fragment
+ *
+ * @return this buffer
+ */
+inline
+TexBuffer&
+TexBuffer::operator<<(TexFragment const& f)
+{
+	_res.append(f.text,f.size);
+	return *this;
+}
+
+/**
+ * @brief append a string
+ *
+ * This method should be inlined.
+ *
+ * @param s string
+ *
+ * @return this buffer
+ */
+inline
+TexBuffer&
+TexBuffer::operator<<(std::string const& s)
+{
+	_res.append(s);
+	return *this;
+}
+
+/**
+ * @brief append a character
+ *
+ * This method should be inlined.
+ *
+ * @param c character
+ *
+ * @return this buffer
+ */
+inline
+TexBuffer&
+TexBuffer::operator<<(char c)
+{
+	_res.push_back(c);
+	return *this;
+}
+
+/**
+ * @brief append a number in decimal
+ *
+ * This method should be inlined.
+ *
+ * @param n number
+ *
+ * @return this buffer
+ */
+inline
+TexBuffer&
+TexBuffer::operator<<(unsigned int n)
+{
+	return appendNumber(n,1);
+}
+
+/**
+ * @brief append a number in decimal
+ *
+ * This method should be inlined.
+ *
+ * @param n number
+ *
+ * @return this buffer
+ */
+inline
+TexBuffer&
+TexBuffer::operator<<(int n)
+{
+	if (n<0) {
+		_res.push_back('-');
+		return appendNumber(0u-n,1);
+	}
+	return appendNumber(n,1);
+}
+
+/**
+ * @brief append a string literal, whose length is known at compile time
+ *
+ * This method should be inlined.
+ *
+ * @param s string literal
+ *
+ * @return this buffer
+ */
+template <std::size_t N>
+inline
+TexBuffer&
+TexBuffer::operator<<(char const (&s)[N])
+{
+	_res.append(s,N-1);
+	return *this;
+}
+
+/**
+ * @brief append a number in decimal, right aligned with spaces
+ *
+ * This method should be inlined.
+ *
+ * @param n number
+ * @param width least number of characters
+ *
+ * @return this buffer
+ */
+inline
+TexBuffer&
+TexBuffer::appendNumber(unsigned int n, unsigned int width)
+{
+	char s[10];
+	unsigned int i=sizeof(s);
+	do {
+		s[--i]=char('0'+n%10);
+		n/=10;
+	} while (n);
+	for (unsigned int k=sizeof(s)-i; k<width; k++) _res.push_back(' ');
+	_res.append(s+i,sizeof(s)-i);
+	return *this;
+}
+
+/**
+ * @brief the TeX code formatted so far
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return the string formatted into
+ */
+inline
+std::string const&
+TexBuffer::str() const
+{
+	return _res;
+}
+
+#endif	// KERWIN_TEXSINK_H
@@ -0,0 +1,73 @@
+/**
+ * @file threadpool.h
+ *
+ * Time-stamp: <2026-10-17 21:06:18 +0800 by kerwin>
+ *
+ * Fixed size pool of worker threads
+ *
+ * @author kerwin\@localhost
+ */
+#include "debug.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef KERWIN_THREADPOOL_H
+#define KERWIN_THREADPOOL_H
+
+/**
+ * @brief fixed size pool of worker threads
+ *
+ * Tasks are run in the order submitted, each by whichever worker is free.
+ * A task should catch its own exceptions; one escaping a task is dropped so
+ * the worker carries on.  The destructor runs the tasks still queued, then
+ * joins the workers.
+ */
+class ThreadPool {
+  public:
+	ThreadPool(unsigned int=0);
+	~ThreadPool();
+	void submit(std::function<void()> const&);
+	void wait();
+	unsigned int getSize() const;
+  private:
+	ThreadPool(ThreadPool const&);
+	ThreadPool& operator=(ThreadPool const&);
+	std::mutex _lock;
+	///< guards every member below
+	std::condition_variable _work;
+	///< signalled when a task is queued or the pool stops
+	std::condition_variable _idle;
+	///< signalled when the last running task finishes
+	std::deque<std::function<void()> > _task;
+	///< tasks not yet started
+	unsigned int _busy;
+	///< number of tasks running
+	bool _stop;
+	///< set by the destructor
+	std::vector<std::thread> _thread;
+	///< the workers, running run()
+	void run();
+};
+
+// inline function declaration
+/**
+ * @brief number of worker threads
+ *
+ * This method should be inlined.
+ *
+ * This method has no argument
+ *
+ * @return number of workers
+ */
+inline
+unsigned int
+ThreadPool::getSize() const
+{
+	return _thread.size();
+}
+
+#endif	// KERWIN_THREADPOOL_H
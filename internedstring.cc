@@ -0,0 +1,123 @@
+/**
+ * @file internedstring.cc
+ *
+ * Time-stamp: <2026-10-18 00:21:47 +0800 by kerwin>
+ *
+ * Process wide pool of strings, each kept once
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "include/debug.h"
+#include "include/internedstring.h"
+#include <mutex>
+#include <unordered_set>
+
+namespace {
+	/**
+	 * @brief the strings handed out so far
+	 *
+	 * The elements of an unordered_set are never moved by later inserts,
+	 * so their addresses serve as handles.
+	 */
+	struct Pool {
+		std::mutex lock;
+		///< guards everything below
+		std::unordered_set<std::string> strings;
+		///< one copy of every string interned
+		std::size_t bytes;
+		///< total length of strings
+		Pool() : bytes(0) {}
+	};
+
+	/**
+	 * @brief the single pool, created on first use
+	 *
+	 * Never destroyed, so handles stay valid during static destruction.
+	 *
+	 * This function takes no argument.
+	 *
+	 * @return reference to the pool
+	 */
+	Pool&
+	pool()
+	{
+		static Pool* p=new Pool;
+		return *p;
+	}
+
+	/**
+	 * @brief the copy of a string in the pool, added if missing
+	 *
+	 * @param s string to look up
+	 *
+	 * @return pointer to the pooled copy
+	 */
+	std::string const*
+	intern(std::string const& s)
+	{
+		Pool& p=pool();
+		std::lock_guard<std::mutex> lock(p.lock);
+		std::pair<std::unordered_set<std::string>::const_iterator,bool> i=
+			p.strings.insert(s);
+		if (i.second) p.bytes+=s.size();
+		return &*i.first;
+	}
+}
+
+/**
+ * @brief constructor, gives the empty string
+ */
+InternedString::InternedString() : _text(intern(std::string()))
+{
+}
+
+/**
+ * @brief constructor, interns a string
+ *
+ * @param s string, copied into the pool unless already there
+ */
+InternedString::InternedString(std::string const& s) : _text(intern(s))
+{
+}
+
+/**
+ * @brief constructor, interns a string
+ *
+ * @param s characters, need not be null terminated
+ * @param n number of characters
+ */
+InternedString::InternedString(char const* s, std::size_t n) :
+	_text(intern(std::string(s,n)))
+{
+}
+
+/**
+ * @brief number of different strings interned so far
+ *
+ * This function takes no argument.
+ *
+ * @return size of the pool
+ */
+std::size_t
+InternedString::getPoolCount()
+{
+	Pool& p=pool();
+	std::lock_guard<std::mutex> lock(p.lock);
+	return p.strings.size();
+}
+
+/**
+ * @brief total length of the different strings interned so far
+ *
+ * This function takes no argument.
+ *
+ * @return bytes of text in the pool
+ */
+std::size_t
+InternedString::getPoolBytes()
+{
+	Pool& p=pool();
+	std::lock_guard<std::mutex> lock(p.lock);
+	return p.bytes;
+}
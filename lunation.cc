@@ -0,0 +1,320 @@
+/**
+ * @file lunation.cc
+ *
+ * Time-stamp: <2026-10-18 03:02:51 +0800 by kerwin>
+ *
+ * New moons, and the Chinese calendar worked out from them
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "include/debug.h"
+#include "include/lunation.h"
+#include "include/solarterm.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+	const double SYNODIC_MONTH=29.530588861;
+	///< mean synodic month in days
+	const double DEGREE=3.14159265358979323846/180;
+	///< a degree in radian
+	const double STANDARD_TIME_MINUTES=8*60;
+	///< Chinese Standard Time, UTC+8, used from 1929
+	const double BEIJING_TIME_MINUTES=(116+25/60.0)*4;
+	///< Beijing mean time, longitude 116 25'E, used before 1929
+	const unsigned int PRINCIPAL_TERM=1;
+	///< principal terms are the odd ones, 1=dahan, ..., 23=dongzhi
+	const unsigned int WINTER_SOLSTICE=23;
+	///< dongzhi, in the 11th month
+
+	/**
+	 * @brief periodic term of the new moon correction, in days
+	 */
+	struct PhaseTerm {
+		double a;		///< amplitude, days
+		int e;			///< power of E
+		int m;			///< multiple of M, mean anomaly of the Sun
+		int mm;			///< multiple of M', mean anomaly of the Moon
+		int f;			///< multiple of F, argument of latitude of the Moon
+	};
+
+	/// Meeus, table 49.A, new moon
+	const PhaseTerm NEW_MOON[]={
+		{-0.40720,0,0,1,0},
+		{0.17241,1,1,0,0},
+		{0.01608,0,0,2,0},
+		{0.01039,0,0,0,2},
+		{0.00739,1,-1,1,0},
+		{-0.00514,1,1,1,0},
+		{0.00208,2,2,0,0},
+		{-0.00111,0,0,1,-2},
+		{-0.00057,0,0,1,2},
+		{0.00056,1,1,2,0},
+		{-0.00042,0,0,3,0},
+		{0.00042,1,1,0,2},
+		{0.00038,1,1,0,-2},
+		{-0.00024,1,-1,2,0},
+		{-0.00007,0,2,1,0},
+		{0.00004,0,0,2,-2},
+		{0.00004,0,3,0,0},
+		{0.00003,0,1,1,-2},
+		{0.00003,0,0,2,2},
+		{-0.00003,0,1,1,2},
+		{0.00003,0,-1,1,2},
+		{-0.00002,0,-1,1,-2},
+		{-0.00002,0,1,3,0},
+		{0.00002,0,0,4,0}
+	};
+
+	/**
+	 * @brief planetary argument of the new moon correction
+	 */
+	struct PlanetTerm {
+		double a;		///< amplitude, days
+		double phase;	///< degree
+		double rate;	///< degree per lunation
+	};
+
+	/// Meeus, chapter 49, additional corrections A1--A14
+	const PlanetTerm PLANET[]={
+		{0.000325,299.77,0.107408},
+		{0.000165,251.88,0.016321},
+		{0.000164,251.83,26.651886},
+		{0.000126,349.42,36.412478},
+		{0.000110,84.66,18.206239},
+		{0.000062,141.74,53.303771},
+		{0.000060,207.14,2.453732},
+		{0.000056,154.84,7.306860},
+		{0.000047,34.52,27.261239},
+		{0.000042,207.19,0.121824},
+		{0.000040,291.34,1.844379},
+		{0.000037,161.72,24.198154},
+		{0.000035,239.56,25.513099},
+		{0.000023,331.55,3.592518}
+	};
+
+	/**
+	 * @brief minutes the civil time of a year is ahead of UT
+	 *
+	 * @param year Gregorian year
+	 *
+	 * @return offset in minutes
+	 */
+	double
+	zoneMinutes(int year)
+	{
+		return (year<1929) ? BEIJING_TIME_MINUTES : STANDARD_TIME_MINUTES;
+	}
+
+	/**
+	 * @brief the civil day of a new moon
+	 *
+	 * @param k lunation number, 0 for the new moon of 6 January 2000
+	 *
+	 * @return MJD of the day the new moon falls on
+	 */
+	int
+	newMoonDay(int k)
+	{
+		double const jde=LunationEngine::getNewMoon(k);
+		double const year=2000+(jde-2451545)/365.25;
+		double const ut=jde-SolarTermEngine::getDeltaT(year)/86400;
+		return (int)std::floor(ut-2400000.5+
+							   zoneMinutes((int)std::floor(year))/1440);
+	}
+
+	/**
+	 * @brief the civil day a solar term begins on
+	 *
+	 * SolarTermEngine gives the minute begun in Chinese Standard Time.
+	 *
+	 * @param t the instant, Chinese Standard Time
+	 * @param year Gregorian year of the term
+	 *
+	 * @return MJD of the day
+	 */
+	int
+	termDay(DateTime const& t, int year)
+	{
+		double const m=t.getMinutes()+0.5-STANDARD_TIME_MINUTES+
+			zoneMinutes(year);
+		return (int)std::floor(m/DateTime::MINUTES_PER_DAY);
+	}
+
+	/**
+	 * @brief a month of the Chinese calendar
+	 */
+	struct LunarMonth {
+		int start;			///< MJD of the first day
+		unsigned int month;	///< month number, plus 16 if intercalary
+	};
+
+	/**
+	 * @brief lay out the months from one 11th month to the next
+	 *
+	 * @param newMoon new moon days, ascending
+	 * @param first index in newMoon of the 11th month
+	 * @param next index in newMoon of the next 11th month
+	 * @param principal days of the principal terms, ascending
+	 * @param[out] res months appended
+	 */
+	void
+	layOutSui(std::vector<int> const& newMoon, std::size_t first,
+			  std::size_t next, std::vector<int> const& principal,
+			  std::vector<LunarMonth>& res)
+	{
+		bool leap=(next-first==13);
+		unsigned int month=10;
+		std::size_t p=0;
+		for (std::size_t i=first; i<next; i++) {
+			while ((p<principal.size()) && (principal[p]<newMoon[i])) p++;
+			bool hasPrincipal=(p<principal.size()) &&
+				(principal[p]<newMoon[i+1]);
+			LunarMonth m={newMoon[i],0};
+			if (leap && !hasPrincipal) {
+				m.month=month+16;
+				leap=false;
+			}
+			else {
+				month=month%12+1;
+				m.month=month;
+			}
+			res.push_back(m);
+		}
+	}
+
+	/**
+	 * @brief a Chinese year laid out
+	 */
+	struct ChineseYear {
+		int newYear;			///< MJD of the first day of the 1st month
+		unsigned int leap;		///< month followed by an intercalary month
+		unsigned int longMonths;///< bit 12 set if the 1st month has 30 days,
+								///< bit 11 for the 2nd, ..., in order
+	};
+
+	/**
+	 * @brief work out the Chinese year starting in a Gregorian year
+	 *
+	 * @param year Gregorian year
+	 *
+	 * @return the year laid out
+	 */
+	ChineseYear
+	computeChineseYear(int year)
+	{
+		int solstice[3];
+		std::vector<int> principal;
+		for (int y=year-1; y<=year+1; y++) {
+			DateTime t[SolarTermEngine::TERMS];
+			SolarTermEngine::getYear(y,t);
+			for (unsigned int k=PRINCIPAL_TERM; k<SolarTermEngine::TERMS;
+				 k+=2) {
+				principal.push_back(termDay(t[k],y));
+			}
+			solstice[y-year+1]=termDay(t[WINTER_SOLSTICE],y);
+		}
+			// new moons from before the first 11th month to after the last
+		std::vector<int> newMoon;
+		int k=(int)std::floor((solstice[0]-45-51549.6)/SYNODIC_MONTH);
+		do {
+			newMoon.push_back(newMoonDay(k++));
+		} while (newMoon.back()<=solstice[2]+45);
+			// the 11th months, which hold the winter solstices
+		std::size_t eleventh[3];
+		for (unsigned int s=0; s<3; s++) {
+			std::size_t i=0;
+			while (newMoon[i+1]<=solstice[s]) i++;
+			eleventh[s]=i;
+		}
+		std::vector<LunarMonth> months;
+		layOutSui(newMoon,eleventh[0],eleventh[1],principal,months);
+		layOutSui(newMoon,eleventh[1],eleventh[2],principal,months);
+		LunarMonth end={newMoon[eleventh[2]],0};
+		months.push_back(end);
+
+		ChineseYear res={0,0,0};
+		std::size_t i=0;
+		while (months[i].month!=1) i++;
+		res.newYear=months[i].start;
+		for (unsigned int j=0; ; j++, i++) {
+			if (j && (months[i].month==1)) break;
+			if (months[i].month>16) res.leap=months[i].month-16;
+			if (months[i+1].start-months[i].start==30) {
+				res.longMonths|=(1u<<12)>>j;
+			}
+		}
+		return res;
+	}
+}
+
+/**
+ * @brief when a new moon occurs
+ *
+ * @param k lunation number, 0 for the new moon of 6 January 2000, negative
+ * before
+ *
+ * @return Julian Ephemeris Day of the new moon
+ */
+double
+LunationEngine::getNewMoon(int k)
+{
+	double const t=k/1236.85;	// Julian centuries from J2000
+	double const t2=t*t;
+	double jde=2451550.09766+SYNODIC_MONTH*k+
+		t2*(0.00015437+t*(-0.000000150+t*0.00000000073));
+	double const e=1-t*(0.002516+t*0.0000074);
+	double const m=(2.5534+29.10535670*k+t2*(-0.0000014-t*0.00000011))*DEGREE;
+	double const mm=(201.5643+385.81693528*k+
+					 t2*(0.0107582+t*(0.00001238-t*0.000000058)))*DEGREE;
+	double const f=(160.7108+390.67050284*k+
+					t2*(-0.0016118+t*(-0.00000227+t*0.000000011)))*DEGREE;
+	double const omega=(124.7746-1.56375588*k+t2*(0.0020672+t*0.00000215))
+		*DEGREE;
+	for (std::size_t i=0; i<sizeof(NEW_MOON)/sizeof(NEW_MOON[0]); i++) {
+		PhaseTerm const& p=NEW_MOON[i];
+		double a=p.a;
+		for (int j=0; j<p.e; j++) a*=e;
+		jde+=a*std::sin(p.m*m+p.mm*mm+p.f*f);
+	}
+	jde-=0.00017*std::sin(omega);
+	for (std::size_t i=0; i<sizeof(PLANET)/sizeof(PLANET[0]); i++) {
+		PlanetTerm const& p=PLANET[i];
+		double arg=p.phase+p.rate*k;
+		if (!i) arg-=0.009173*t2;
+		jde+=p.a*std::sin(arg*DEGREE);
+	}
+	return jde;
+}
+
+/**
+ * @brief the Chinese year beginning in a Gregorian year
+ *
+ * Worked out afresh on every call, from the solar terms of the year before
+ * to the year after; Date keeps the results.  Throws INVALID_PARAM if year
+ * is outside FIRST_YEAR-1 to LAST_YEAR.
+ *
+ * @param year Gregorian year
+ * @param[out] newYear MJD of Chinese New Year
+ * @param[out] leap month followed by an intercalary month, 0 for none
+ * @param[out] longMonths which months have 30 days, bit 12 for the 1st
+ * month, bit 11 for the 2nd, and so on in order, the intercalary month
+ * included
+ */
+void
+LunationEngine::getChineseYear(int year, int& newYear, unsigned int& leap,
+							   unsigned int& longMonths)
+{
+#ifdef DEBUG
+	MY_ERR << "LunationEngine::getChineseYear(" << year << ") called."
+		   << std::endl;
+#endif
+	if ((year<FIRST_YEAR-1) || (year>LAST_YEAR)) {
+		throw INVALID_PARAM(year);
+	}
+	ChineseYear const y=computeChineseYear(year);
+	newYear=y.newYear;
+	leap=y.leap;
+	longMonths=y.longMonths;
+}
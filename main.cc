@@ -1,21 +1,232 @@
 /**
  * @file main.cc
  *
- * Time-stamp: <2012-12-04 01:02:01 +0800 by kerwin>
+ * Time-stamp: <2026-10-17 21:06:18 +0800 by kerwin>
  *
- * command line program to generate TeX, and output to std::cout.
+ * command line program to generate TeX, and output to std::cout, or for a
+ * range of years to one file per year.
  *
  * @author kerwin\@localhost
  */
 #include "include/debug.h"
 #include "include/date.h"
 #include "include/calendar.h"
+#include "include/calendardata.h"
+#include "include/fragmentcache.h"
+#include "include/lunation.h"
+#include "include/texsink.h"
+#include "include/threadpool.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 #ifdef DEBUG
-#include <fstream>
 std::ofstream MY_ERR;
 #endif
 
+namespace {
+	/**
+	 * @brief time and outcome of rendering one year
+	 */
+	struct YearResult {
+		double milliseconds;
+		///< wall time to render and write the year
+		bool ok;
+		///< false if the year could not be rendered or written
+		std::string error;
+		///< why the year failed, empty if ok
+	};
+
+	/**
+	 * @brief parse a decimal number
+	 *
+	 * @param s string holding nothing but the number
+	 * @param[out] res the number
+	 *
+	 * @retval true if s is a number
+	 * @retval false otherwise
+	 */
+	bool
+	parseNumber(char const* s, unsigned int& res)
+	{
+		char* end;
+		if ((*s<'0') || (*s>'9')) return false;
+		unsigned long n=std::strtoul(s,&end,10);
+		if (*end || (n>~0u)) return false;
+		res=n;
+		return true;
+	}
+
+	/**
+	 * @brief parse a year range
+	 *
+	 * Throws Exception unless both years are within the years LunationEngine
+	 * supports.
+	 *
+	 * @param s either "A-B" or a single year "A"
+	 * @param[out] first first year A
+	 * @param[out] last last year B, A for a single year
+	 */
+	void
+	parseYears(char const* s, unsigned int& first, unsigned int& last)
+	{
+		std::string a(s), b(s);
+		std::string::size_type dash=a.find('-');
+		if (dash!=std::string::npos) {
+			a.erase(dash);
+			b.erase(0,dash+1);
+		}
+		if (!parseNumber(a.c_str(),first) || !parseNumber(b.c_str(),last) ||
+			(first<(unsigned int)LunationEngine::FIRST_YEAR) ||
+			(last>(unsigned int)LunationEngine::LAST_YEAR) || (first>last)) {
+			throw Exception("Invalid parameter passed to --years");
+		}
+	}
+
+	/**
+	 * @brief render one year to DIR/YEAR.tex
+	 *
+	 * Never throws: any failure, including std::bad_alloc, is recorded in
+	 * res and the file is closed on every path.
+	 *
+	 * @param year year to render
+	 * @param directory where the file goes
+	 * @param pool threads the months are rendered on
+	 * @param cache month pages rendered before, may be null
+	 * @param[out] res time taken and outcome
+	 */
+	void
+	renderYear(unsigned int year, std::string const& directory,
+			   ThreadPool& pool, std::shared_ptr<FragmentCache> const& cache,
+			   YearResult& res)
+	{
+		std::chrono::steady_clock::time_point start=
+			std::chrono::steady_clock::now();
+		res.ok=false;
+		std::ostringstream path;
+		path << directory << "/" << year << ".tex";
+		int fd=open(path.str().c_str(),O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+					0666);
+		if (fd<0) {
+			res.error=std::strerror(errno);
+		}
+		else {
+			try {
+				FdSink out(fd);
+				Calendar calendar(year);
+				calendar.setFragmentCache(cache);
+				calendar.writeFullYearTex(out,pool);
+				out.flush();
+				res.ok=true;
+			}
+			catch (Exception& e) {
+				res.error=e.message();
+			}
+			catch (std::exception const& e) {
+				res.error=e.what();
+			}
+			catch (...) {
+				res.error="unknown exception";
+			}
+			if ((::close(fd)<0) && res.ok) {
+				res.ok=false;
+				res.error=std::strerror(errno);
+			}
+		}
+		res.milliseconds=std::chrono::duration<double,std::milli>(
+			std::chrono::steady_clock::now()-start).count();
+	}
+
+	/**
+	 * @brief render a range of years on a thread pool
+	 *
+	 * All years share the default CalendarData, loaded once up front.  The
+	 * months of each year are spread over the pool too, so a range shorter
+	 * than the number of threads still uses them all.
+	 * Reports the time of each year and the total to std::cerr.
+	 *
+	 * @param first first year
+	 * @param last last year, inclusive
+	 * @param jobs number of threads, 0 for one per hardware thread
+	 * @param directory where DIR/YEAR.tex files go; must exist
+	 * @param cache month pages rendered before, may be null
+	 *
+	 * @return number of years that failed
+	 */
+	unsigned int
+	renderYears(unsigned int first, unsigned int last, unsigned int jobs,
+				std::string const& directory,
+				std::shared_ptr<FragmentCache> const& cache)
+	{
+		std::chrono::steady_clock::time_point start=
+			std::chrono::steady_clock::now();
+		CalendarData::getDefault();
+		std::vector<YearResult> result(last-first+1);
+		unsigned int threads;
+		{
+			ThreadPool pool(jobs);
+			threads=pool.getSize();
+			for (unsigned int year=first; year<=last; year++) {
+				YearResult& r=result[year-first];
+				pool.submit([year,&directory,&pool,&cache,&r]() {
+						renderYear(year,directory,pool,cache,r);
+					});
+			}
+			pool.wait();
+		}
+		double total=std::chrono::duration<double,std::milli>(
+			std::chrono::steady_clock::now()-start).count();
+
+		unsigned int failed=0;
+		double busy=0;
+		std::cerr << std::fixed << std::setprecision(3);
+		for (unsigned int year=first; year<=last; year++) {
+			YearResult const& r=result[year-first];
+			busy+=r.milliseconds;
+			std::cerr << directory << "/" << year << ".tex: ";
+			if (r.ok) {
+				std::cerr << r.milliseconds << " ms" << std::endl;
+			}
+			else {
+				std::cerr << "failed: " << r.error << std::endl;
+				failed++;
+			}
+		}
+		std::cerr << result.size() << " year(s) in " << total << " ms on "
+				  << threads << " thread(s), " << busy
+				  << " ms of rendering" << std::endl;
+		if (cache) {
+			std::cerr << "cache: " << cache->getHits() << " hit(s), "
+					  << cache->getMisses() << " miss(es), "
+					  << cache->getEvictions() << " eviction(s)" << std::endl;
+		}
+		return failed;
+	}
+
+	/**
+	 * @brief print how to invoke the program
+	 *
+	 * @param name program name, argv[0]
+	 */
+	void
+	usage(char const* name)
+	{
+		std::cerr << "usage: " << name << " [year]" << std::endl
+				  << "       " << name
+				  << " --years <first>-<last> [--jobs <n>] [--out-dir <dir>]"
+				  << " [--cache-dir <dir>]" << std::endl;
+	}
+}
+
 /**
  * @brief Our main function
  *
@@ -25,7 +236,13 @@ std::ofstream MY_ERR;
  * Spits out the TeX code for calendar for year to std::cout.  Redirect them
  * if wished.
  *
- * @return 0 if command executed successfully.
+ * With --years first-last, renders each year of the range to
+ * <dir>/<year>.tex instead, on --jobs threads (default one per hardware
+ * thread), with <dir> given by --out-dir (default the current directory).
+ * --cache-dir keeps the month pages in a directory for the next run.
+ *
+ * @return 0 if command executed successfully, 1 if some year failed or the
+ * arguments are wrong.
  */
 int
 main(int argc, char** argv)
@@ -35,18 +252,58 @@ main(int argc, char** argv)
 	MY_ERR << "main() called with " << argc << " argument(s)." << std::endl;
 #endif
 	unsigned int year=2012;
+	int res=0;
 	try {
-		if (argc > 1) {
-			std::string s(argv[1]);
-			std::stringstream ss;
-			ss << s;
-			ss >> year;
-			if ((year<=1900) || (year>=2100)) {
-				throw Exception("Invalid parameter passed");
+		if ((argc > 1) && !std::strncmp(argv[1],"--",2)) {
+			unsigned int first=0, last=0, jobs=0;
+			std::string directory(".");
+			std::shared_ptr<FragmentCache> cache;
+			for (int i=1; i<argc; i++) {
+				if (i+1>=argc) {
+					usage(argv[0]);
+					return 1;
+				}
+				if (!std::strcmp(argv[i],"--years")) {
+					parseYears(argv[++i],first,last);
+				}
+				else if (!std::strcmp(argv[i],"--jobs")) {
+					if (!parseNumber(argv[++i],jobs)) {
+						throw Exception("Invalid parameter passed to --jobs");
+					}
+				}
+				else if (!std::strcmp(argv[i],"--out-dir")) {
+					directory=argv[++i];
+				}
+				else if (!std::strcmp(argv[i],"--cache-dir")) {
+					cache=std::make_shared<FragmentCache>(argv[++i]);
+				}
+				else {
+					usage(argv[0]);
+					return 1;
+				}
+			}
+			if (!first) {
+				usage(argv[0]);
+				return 1;
 			}
+			if (renderYears(first,last,jobs,directory,cache)) res=1;
+		}
+		else {
+			if (argc > 1) {
+				std::string s(argv[1]);
+				std::stringstream ss;
+				ss << s;
+				ss >> year;
+				if ((year<(unsigned int)LunationEngine::FIRST_YEAR) ||
+					(year>(unsigned int)LunationEngine::LAST_YEAR)) {
+					throw Exception("Invalid parameter passed");
+				}
+			}
+			Calendar c(year);
+			FdSink out(STDOUT_FILENO);
+			c.writeFullYearTex(out);
+			out.flush();
 		}
-		Calendar c(year);
-		std::cout << c.getFullYearTex();
 #ifdef DEBUG
 		MY_ERR << "Closing debugging log." << std::endl;
 		MY_ERR.close();
@@ -60,7 +317,11 @@ main(int argc, char** argv)
 		std::cerr << h.message() << std::endl
 				  << "See debug log for more details." << std::endl;
 	}
-	return 0;
+	catch (std::exception const& e) {
+		std::cerr << e.what() << std::endl;
+		res=1;
+	}
+	return res;
 }
 
 // now documentation
@@ -81,6 +342,11 @@ main(int argc, char** argv)
  *
  * The default is output to cout(stdout).  Redirect if desired.
  *
+ * To render many years at once, sharing one copy of the data files, run
+ *     @verbatim ./calendar --years 1901-2099 --jobs 8 --out-dir tex @endverbatim
+ * which writes tex/1901.tex to tex/2099.tex on 8 threads and reports the
+ * time taken by each year.
+ *
  * @section warning_sec Warning
  *
  * No warranty implied.  Use at your own risk.
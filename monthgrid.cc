@@ -0,0 +1,41 @@
+/**
+ * @file monthgrid.cc
+ *
+ * Time-stamp: <2026-10-17 22:31:40 +0800 by kerwin>
+ *
+ * Layout of the month-to-view pages, worked out at compile time
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "include/debug.h"
+#include "include/monthgrid.h"
+
+namespace {
+	constexpr MonthGridTable MONTH_GRID=makeMonthGridTable();
+	///< grids of every year shape, built by the compiler
+
+	static_assert(MONTH_GRID.grid[2*Date::DOW_THURSDAY][1].size==28+4+7+1,
+				  "a non-leap February starting on Sunday has its own grid");
+}
+
+/**
+ * @relatesalso MonthGrid
+ * @brief the grid of a month
+ *
+ * @param year Gregorian year
+ * @param month 1=January, ..., 12=December
+ *
+ * @return grid of the month-to-view page
+ */
+MonthGrid const&
+monthGrid(int year, unsigned int month)
+{
+	if ((month<1) || (month>12)) {
+		throw INVALID_PARAM(month);
+	}
+		// weekday of 1 January, Gauss
+	int y=year-1;
+	unsigned int first=(1+5*(y%4)+4*(y%100)+6*(y%400))%7;
+	return MONTH_GRID.grid[2*first+(isLeapYear(year) ? 1 : 0)][month-1];
+}
@@ -0,0 +1,529 @@
+/**
+ * @file solarterm.cc
+ *
+ * Time-stamp: <2026-10-18 02:14:36 +0800 by kerwin>
+ *
+ * Solar term instants worked out from the position of the Sun
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "include/debug.h"
+#include "include/solarterm.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <mutex>
+
+namespace {
+	/**
+	 * @brief one periodic term of a VSOP87 series, A cos(B+C tau)
+	 */
+	struct VsopTerm {
+		double a;	///< amplitude, 1e-8 radian
+		double b;	///< phase, radian
+		double c;	///< frequency, radian per millennium
+	};
+
+	/// heliocentric longitude of the Earth, tau^0
+	const VsopTerm EARTH_L0[]={
+		{175347046,0,0},
+		{3341656,4.6692568,6283.0758500},
+		{34894,4.62610,12566.15170},
+		{3497,2.7441,5753.3849},
+		{3418,2.8289,3.5231},
+		{3136,3.6277,77713.7715},
+		{2676,4.4181,7860.4194},
+		{2343,6.1352,3930.2097},
+		{1324,0.7425,11506.7698},
+		{1273,2.0371,529.6910},
+		{1199,1.1096,1577.3435},
+		{990,5.233,5884.927},
+		{902,2.045,26.298},
+		{857,3.508,398.149},
+		{780,1.179,5223.694},
+		{753,2.533,5507.553},
+		{505,4.583,18849.228},
+		{492,4.205,775.523},
+		{357,2.920,0.067},
+		{317,5.849,11790.629},
+		{284,1.899,796.298},
+		{271,0.315,10977.079},
+		{243,0.345,5486.778},
+		{206,4.806,2544.314},
+		{205,1.869,5573.143},
+		{202,2.458,6069.777},
+		{156,0.833,213.299},
+		{132,3.411,2942.463},
+		{126,1.083,20.775},
+		{115,0.645,0.980},
+		{103,0.636,4694.003},
+		{102,0.976,15720.839},
+		{102,4.267,7.114},
+		{99,6.21,2146.17},
+		{98,0.68,155.42},
+		{86,5.98,161000.69},
+		{85,1.30,6275.96},
+		{85,3.67,71430.70},
+		{80,1.81,17260.15},
+		{79,3.04,12036.46},
+		{75,1.76,5088.63},
+		{74,3.50,3154.69},
+		{74,4.68,801.82},
+		{70,0.83,9437.76},
+		{62,3.98,8827.39},
+		{61,1.82,7084.90},
+		{57,2.78,6286.60},
+		{56,4.39,14143.50},
+		{56,3.47,6279.55},
+		{52,0.19,12139.55},
+		{52,1.33,1748.02},
+		{51,0.28,5856.48},
+		{49,0.49,1194.45},
+		{41,5.37,8429.24},
+		{41,2.40,19651.05},
+		{39,6.17,10447.39},
+		{37,6.04,10213.29},
+		{37,2.57,1059.38},
+		{36,1.71,2352.87},
+		{36,1.78,6812.77},
+		{33,0.59,17789.85},
+		{30,0.44,83996.85},
+		{30,2.74,1349.87},
+		{25,3.16,4690.48}
+	};
+
+	/// heliocentric longitude of the Earth, tau^1
+	const VsopTerm EARTH_L1[]={
+		{628331966747.0,0,0},
+		{206059,2.678235,6283.075850},
+		{4303,2.6351,12566.1517},
+		{425,1.590,3.523},
+		{119,5.796,26.298},
+		{109,2.966,1577.344},
+		{93,2.59,18849.23},
+		{72,1.14,529.69},
+		{68,1.87,398.15},
+		{67,4.41,5507.55},
+		{59,2.89,5223.69},
+		{56,2.17,155.42},
+		{45,0.40,796.30},
+		{36,0.47,775.52},
+		{29,2.65,7.11},
+		{21,5.34,0.98},
+		{19,1.85,5486.78},
+		{19,4.97,213.30},
+		{17,2.99,6275.96},
+		{16,0.03,2544.31},
+		{16,1.43,2146.17},
+		{15,1.21,10977.08},
+		{12,2.83,1748.02},
+		{12,3.26,5088.63},
+		{12,5.27,1194.45},
+		{12,2.08,4694.00},
+		{11,0.77,553.57},
+		{10,1.30,6286.60},
+		{10,4.24,1349.87},
+		{9,2.70,242.73},
+		{9,5.64,951.72},
+		{8,5.30,2352.87},
+		{6,2.65,9437.76},
+		{6,4.67,4690.48}
+	};
+
+	/// heliocentric longitude of the Earth, tau^2
+	const VsopTerm EARTH_L2[]={
+		{52919,0,0},
+		{8720,1.0721,6283.0758},
+		{309,0.867,12566.152},
+		{27,0.05,3.52},
+		{16,5.19,26.30},
+		{16,3.68,155.42},
+		{10,0.76,18849.23},
+		{9,2.06,77713.77},
+		{7,0.83,775.52},
+		{5,4.66,1577.34},
+		{4,1.03,7.11},
+		{4,3.44,5573.14},
+		{3,5.14,796.30},
+		{3,6.05,5507.55},
+		{3,1.19,242.73},
+		{3,6.12,529.69},
+		{3,0.31,398.15},
+		{3,2.28,553.57},
+		{2,4.38,5223.69},
+		{2,3.75,0.98}
+	};
+
+	/// heliocentric longitude of the Earth, tau^3
+	const VsopTerm EARTH_L3[]={
+		{289,5.844,6283.076},
+		{35,0,0},
+		{17,5.49,12566.15},
+		{3,5.20,155.42},
+		{1,4.72,3.52},
+		{1,5.30,18849.23},
+		{1,5.97,242.73}
+	};
+
+	/// heliocentric longitude of the Earth, tau^4
+	const VsopTerm EARTH_L4[]={
+		{114,3.142,0},
+		{8,4.13,6283.08},
+		{1,3.84,12566.15}
+	};
+
+	/// heliocentric longitude of the Earth, tau^5
+	const VsopTerm EARTH_L5[]={
+		{1,3.14,0}
+	};
+
+	const double J2000=2451545.0;
+	///< Julian Ephemeris Day of 2000-01-01 12h TT
+	const double DAYS_PER_MILLENNIUM=365250.0;
+	///< Julian millennium in days
+	const double TROPICAL_YEAR=365.2422;
+	///< mean tropical year in days
+	const double MARCH_EQUINOX_2000=2451623.80984;
+	///< Julian Ephemeris Day of the March equinox 2000
+	const double PI=3.14159265358979323846;
+	///< pi
+	const double DEGREE=PI/180;
+	///< a degree in radian
+	const double ARCSECOND=DEGREE/3600;
+	///< an arc second in radian
+
+	/**
+	 * @brief sum of a VSOP87 series
+	 *
+	 * @param t the terms
+	 * @param tau Julian millennia from J2000
+	 *
+	 * @return sum, 1e-8 radian
+	 */
+	template <std::size_t N>
+	double
+	sumSeries(VsopTerm const (&t)[N], double tau)
+	{
+		double res=0;
+		for (std::size_t i=0; i<N; i++) {
+			res+=t[i].a*std::cos(t[i].b+t[i].c*tau);
+		}
+		return res;
+	}
+
+	/**
+	 * @brief apparent geocentric longitude of the Sun
+	 *
+	 * @param jde Julian Ephemeris Day
+	 *
+	 * @return longitude, radian, not reduced to a turn
+	 */
+	double
+	sunLongitude(double jde)
+	{
+		double const tau=(jde-J2000)/DAYS_PER_MILLENNIUM;
+		double const t=10*tau;	// Julian centuries
+		double l=sumSeries(EARTH_L5,tau);
+		l=l*tau+sumSeries(EARTH_L4,tau);
+		l=l*tau+sumSeries(EARTH_L3,tau);
+		l=l*tau+sumSeries(EARTH_L2,tau);
+		l=l*tau+sumSeries(EARTH_L1,tau);
+		l=l*tau+sumSeries(EARTH_L0,tau);
+		l=l*1e-8+PI;		// geocentric
+		l-=0.09033*ARCSECOND;	// to FK5
+			// nutation in longitude
+		double const omega=(125.04452-1934.136261*t)*DEGREE;
+		double const sun=(280.4665+36000.7698*t)*DEGREE;
+		double const moon=(218.3165+481267.8813*t)*DEGREE;
+		l+=(-17.20*std::sin(omega)-1.32*std::sin(2*sun)-
+			0.23*std::sin(2*moon)+0.21*std::sin(2*omega))*ARCSECOND;
+			// aberration, with the distance to the Sun
+		double const m=(357.52911+35999.05029*t)*DEGREE;
+		double const r=1.000140-0.016708*std::cos(m)-0.000139*std::cos(2*m);
+		l-=20.4898*ARCSECOND/r;
+		return l;
+	}
+
+	/**
+	 * @brief rate of change of the longitude of the Sun
+	 *
+	 * Only the largest terms, enough for Newton's method to converge.
+	 *
+	 * @param jde Julian Ephemeris Day
+	 *
+	 * @return radian per day
+	 */
+	double
+	sunLongitudeRate(double jde)
+	{
+		double const tau=(jde-J2000)/DAYS_PER_MILLENNIUM;
+		double res=EARTH_L1[0].a;
+		for (std::size_t i=1; i<3; i++) {
+			res-=EARTH_L0[i].a*EARTH_L0[i].c*
+				std::sin(EARTH_L0[i].b+EARTH_L0[i].c*tau);
+		}
+		return res*1e-8/DAYS_PER_MILLENNIUM;
+	}
+
+	/**
+	 * @brief when a solar term begins
+	 *
+	 * @param year Gregorian year
+	 * @param term 0=xiaohan, ..., 23=dongzhi
+	 *
+	 * @return instant, Chinese Standard Time, to the minute begun
+	 */
+	DateTime
+	computeTerm(int year, unsigned int term)
+	{
+			// terms before the March equinox belong to the previous turn
+		int const degree=(term<5) ? 15*(int)term-75 : 15*((int)term-5);
+		double const target=degree*DEGREE;
+		double jde=MARCH_EQUINOX_2000+TROPICAL_YEAR*(year-2000+degree/360.0);
+		for (unsigned int i=0; i<8; i++) {
+			double diff=std::remainder(target-sunLongitude(jde),2*PI);
+			double step=diff/sunLongitudeRate(jde);
+			jde+=step;
+			if (std::fabs(step)<1e-5) break;	// under a second
+		}
+		double const dt=SolarTermEngine::getDeltaT(2000+(jde-J2000)/365.25);
+		double const minutes=(jde-dt/86400-2400000.5)*DateTime::MINUTES_PER_DAY
+			+8*60;
+		return DateTime((long long)std::floor(minutes));
+	}
+
+	/**
+	 * @brief the solar terms of a year
+	 */
+	struct YearTerms {
+		DateTime instant[SolarTermEngine::TERMS];
+		///< when each term begins
+	};
+
+	/**
+	 * @brief years worked out so far
+	 */
+	struct YearCache {
+		std::mutex lock;
+		///< guards year
+		std::map<int,YearTerms> year;
+		///< solar terms keyed by Gregorian year
+	};
+
+	/**
+	 * @brief the single cache, created on first use
+	 *
+	 * This function takes no argument.
+	 *
+	 * @return reference to the cache
+	 */
+	YearCache&
+	yearCache()
+	{
+		static YearCache c;
+		return c;
+	}
+}
+
+/**
+ * @brief Delta T = TT-UT
+ *
+ * The polynomials of Espenak and Meeus for 1600--2150, their long term
+ * parabola elsewhere.
+ *
+ * @param y Gregorian year, with fraction
+ *
+ * @return Delta T in seconds
+ */
+double
+SolarTermEngine::getDeltaT(double y)
+{
+	double t;
+	if (y<1600 || y>=2150) {
+		t=(y-1820)/100;
+		return -20+32*t*t;
+	}
+	if (y<1700) {
+		t=y-1600;
+		return 120+t*(-0.9808+t*(-0.01532+t/7129));
+	}
+	if (y<1800) {
+		t=y-1700;
+		return 8.83+t*(0.1603+t*(-0.0059285+t*(0.00013336-t/1174000)));
+	}
+	if (y<1860) {
+		t=y-1800;
+		return 13.72+t*(-0.332447+t*(0.0068612+t*(0.0041116+t*(-0.00037436+
+				t*(0.0000121272+t*(-0.0000001699+t*0.000000000875))))));
+	}
+	if (y<1900) {
+		t=y-1860;
+		return 7.62+t*(0.5737+t*(-0.251754+t*(0.01680668+
+				t*(-0.0004473624+t/233174))));
+	}
+	if (y<1920) {
+		t=y-1900;
+		return -2.79+t*(1.494119+t*(-0.0598939+t*(0.0061966-t*0.000197)));
+	}
+	if (y<1941) {
+		t=y-1920;
+		return 21.20+t*(0.84493+t*(-0.076100+t*0.0020936));
+	}
+	if (y<1961) {
+		t=y-1950;
+		return 29.07+t*(0.407+t*(-1/233.0+t/2547.0));
+	}
+	if (y<1986) {
+		t=y-1975;
+		return 45.45+t*(1.067+t*(-1/260.0-t/718.0));
+	}
+	if (y<2005) {
+		t=y-2000;
+		return 63.86+t*(0.3345+t*(-0.060374+t*(0.0017275+
+				t*(0.000651814+t*0.00002373599))));
+	}
+	if (y<2050) {
+		t=y-2000;
+		return 62.92+t*(0.32217+t*0.005589);
+	}
+	t=(y-1820)/100;
+	return -20+32*t*t-0.5628*(2150-y);
+}
+
+/**
+ * @brief when a solar term begins
+ *
+ * Throws INVALID_PARAM if term is not a solar term.
+ *
+ * @param year Gregorian year
+ * @param term 0=xiaohan, ..., 23=dongzhi
+ *
+ * @return instant, Chinese Standard Time
+ */
+DateTime
+SolarTermEngine::getInstant(int year, unsigned int term)
+{
+	if (term>=TERMS) throw INVALID_PARAM(term);
+	DateTime res[TERMS];
+	getYear(year,res);
+	return res[term];
+}
+
+/**
+ * @brief when each solar term of a year begins
+ *
+ * Worked out on first call for a year, from the cache after.
+ *
+ * @param year Gregorian year
+ * @param[out] res instants indexed by term, 0=xiaohan, ..., 23=dongzhi,
+ * in Chinese Standard Time and ascending
+ */
+void
+SolarTermEngine::getYear(int year, DateTime (&res)[TERMS])
+{
+#ifdef DEBUG
+	MY_ERR << "SolarTermEngine::getYear(" << year << ") called." << std::endl;
+#endif
+	YearCache& c=yearCache();
+	{
+		std::lock_guard<std::mutex> lock(c.lock);
+		std::map<int,YearTerms>::const_iterator i=c.year.find(year);
+		if (i!=c.year.end()) {
+			std::copy(i->second.instant,i->second.instant+TERMS,res);
+			return;
+		}
+	}
+	YearTerms y;
+	for (unsigned int k=0; k<TERMS; k++) {
+		y.instant[k]=computeTerm(year,k);
+	}
+	std::copy(y.instant,y.instant+TERMS,res);
+	std::lock_guard<std::mutex> lock(c.lock);
+	c.year.insert(std::make_pair(year,y));
+}
+
+/**
+ * @brief which solar term begins on or near a date
+ *
+ * Used to number a solar term known only by its date, e.g. read from
+ * CSV; the date may be up to a week off the one worked out.
+ *
+ * @param mjd MJD of a solar term date
+ *
+ * @return 0=xiaohan, ..., 23=dongzhi, the term of the same Gregorian year
+ * worked out nearest to mjd
+ */
+unsigned int
+SolarTermEngine::getTerm(int mjd)
+{
+	int year;
+	unsigned int month, day;
+	gregorianFromMJD(mjd,year,month,day);
+	DateTime t[TERMS];
+	getYear(year,t);
+	unsigned int res=0;
+	int best=std::abs(t[0].getDate().getMJD()-mjd);
+	for (unsigned int k=1; k<TERMS; k++) {
+		int const away=std::abs(t[k].getDate().getMJD()-mjd);
+		if (away<best) {
+			best=away;
+			res=k;
+		}
+	}
+	return res;
+}
+
+/**
+ * @brief add the solar terms missing from a list, and number them
+ *
+ * A term already in the list, on the day worked out or up to a week
+ * away, keeps its date and time; the list is authoritative.  It takes the
+ * number of the term worked out, as does every term added.  Terms of the
+ * list outside first--last are left as they are.
+ *
+ * @param[in,out] solar solar terms, ascending and unique in MJD, as from
+ * readSolarCSV()
+ * @param first first Gregorian year to fill in
+ * @param last last Gregorian year to fill in
+ *
+ * @return number of terms added
+ */
+unsigned long
+SolarTermEngine::fill(SolarList& solar, int first, int last)
+{
+#ifdef DEBUG
+	MY_ERR << "SolarTermEngine::fill(" << solar.size() << " entries,"
+		   << first << "," << last << ") called." << std::endl;
+#endif
+	SolarList added;
+	for (int year=first; year<=last; year++) {
+		DateTime t[TERMS];
+		getYear(year,t);
+		for (unsigned int k=0; k<TERMS; k++) {
+			int const mjd=t[k].getDate().getMJD();
+			SolarList::iterator i=std::lower_bound(
+				solar.begin(),solar.end(),mjd-7,
+				[](SolarList::value_type const& s, int m)
+				{ return s.first<m; });
+			if ((i!=solar.end()) && (i->first<=mjd+7)) {
+				i->second.term=k;
+				continue;
+			}
+			SolarTime const time={t[k].getMinuteOfDay(),k};
+			added.push_back(std::make_pair(mjd,time));
+		}
+	}
+	if (added.empty()) return 0;
+	SolarList res;
+	res.reserve(solar.size()+added.size());
+	std::merge(solar.begin(),solar.end(),added.begin(),added.end(),
+			   std::back_inserter(res),
+			   [](SolarList::value_type const& a,
+				  SolarList::value_type const& b)
+			   { return a.first<b.first; });
+	solar.swap(res);
+	return added.size();
+}
@@ -0,0 +1,197 @@
+/**
+ * @file texsink.cc
+ *
+ * Time-stamp: <2026-10-17 21:48:03 +0800 by kerwin>
+ *
+ * Destinations the TeX code is written to as it is rendered
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "include/debug.h"
+#include "include/texsink.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+	const std::size_t FD_BUFFER_SIZE=1<<13;
+	///< bytes FdSink gathers before writing
+}
+
+/**
+ * @brief destructor
+ */
+TexSink::~TexSink()
+{
+}
+
+/**
+ * @brief write out anything buffered
+ *
+ * Does nothing unless the sink buffers.
+ *
+ * This function takes no argument.
+ */
+void
+TexSink::flush()
+{
+}
+
+/**
+ * @brief constructor
+ *
+ * @param res string the TeX code is appended to
+ */
+StringSink::StringSink(std::string& res) : _res(res)
+{
+}
+
+/**
+ * @brief append to the string
+ *
+ * @param s data
+ * @param n number of bytes
+ */
+void
+StringSink::write(char const* s, std::size_t n)
+{
+	_res.append(s,n);
+}
+
+/**
+ * @brief constructor
+ *
+ * @param out stream the TeX code is written to
+ */
+StreamSink::StreamSink(std::ostream& out) : _out(out)
+{
+}
+
+/**
+ * @brief write to the stream
+ *
+ * Throws Exception if the stream fails.
+ *
+ * @param s data
+ * @param n number of bytes
+ */
+void
+StreamSink::write(char const* s, std::size_t n)
+{
+	if (!_out.write(s,n)) {
+		throw Exception("Cannot write output stream");
+	}
+}
+
+/**
+ * @brief flush the stream
+ *
+ * Throws Exception if the stream fails.
+ *
+ * This function takes no argument.
+ */
+void
+StreamSink::flush()
+{
+	if (!_out.flush()) {
+		throw Exception("Cannot write output stream");
+	}
+}
+
+/**
+ * @brief constructor
+ *
+ * @param fd open file descriptor the TeX code is written to
+ */
+FdSink::FdSink(int fd) : _fd(fd), _buffer(FD_BUFFER_SIZE), _used(0)
+{
+}
+
+/**
+ * @brief destructor, writes out the buffer
+ *
+ * Errors are lost; call flush() first to see them.
+ */
+FdSink::~FdSink()
+{
+	try {
+		flush();
+	}
+	catch (Exception&) {
+	}
+}
+
+/**
+ * @brief write, through the buffer
+ *
+ * Throws Exception on a write error.
+ *
+ * @param s data
+ * @param n number of bytes
+ */
+void
+FdSink::write(char const* s, std::size_t n)
+{
+	if (_used+n<=_buffer.size()) {
+		std::memcpy(&_buffer[_used],s,n);
+		_used+=n;
+		return;
+	}
+	std::size_t used=_used;
+	_used=0;
+	writeAll(s,n,used);
+}
+
+/**
+ * @brief write out the buffer
+ *
+ * Throws Exception on a write error.
+ *
+ * This function takes no argument.
+ */
+void
+FdSink::flush()
+{
+	std::size_t used=_used;
+	_used=0;
+	writeAll(0,0,used);
+}
+
+/**
+ * @brief write the start of the buffer, then more data, to the descriptor
+ *
+ * A single writev(), repeated over short writes.  Throws Exception on a
+ * write error.
+ *
+ * @param s data following the buffer
+ * @param n number of bytes of s
+ * @param used number of bytes of the buffer
+ */
+void
+FdSink::writeAll(char const* s, std::size_t n, std::size_t used)
+{
+	struct iovec v[2]={{&_buffer[0],used},{const_cast<char*>(s),n}};
+	struct iovec* p=v;
+	int count=2;
+	while (count) {
+		if (!p->iov_len) {
+			p++;
+			count--;
+			continue;
+		}
+		ssize_t k=writev(_fd,p,count);
+		if (k<0) {
+			if (errno==EINTR) continue;
+			throw Exception("Cannot write output file");
+		}
+		for (; count && (std::size_t(k)>=p->iov_len); p++, count--) {
+			k-=p->iov_len;
+		}
+		if (count) {
+			p->iov_base=static_cast<char*>(p->iov_base)+k;
+			p->iov_len-=k;
+		}
+	}
+}
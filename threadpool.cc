@@ -0,0 +1,106 @@
+/**
+ * @file threadpool.cc
+ *
+ * Time-stamp: <2026-10-17 21:06:18 +0800 by kerwin>
+ *
+ * Fixed size pool of worker threads
+ *
+ * @author kerwin\@localhost
+ */
+
+#include "include/debug.h"
+#include "include/threadpool.h"
+
+/**
+ * @brief constructor, starts the workers
+ *
+ * @param size number of workers; 0, the default, for one per hardware
+ * thread
+ */
+ThreadPool::ThreadPool(unsigned int size) : _busy(0), _stop(false)
+{
+#ifdef DEBUG
+	MY_ERR << this << "->ThreadPool::ThreadPool(" << size << ") called."
+		   << std::endl;
+#endif
+	if (!size) size=std::thread::hardware_concurrency();
+	if (!size) size=1;
+	_thread.reserve(size);
+	for (unsigned int i=0; i<size; i++) {
+		_thread.push_back(std::thread(&ThreadPool::run,this));
+	}
+}
+
+/**
+ * @brief destructor, finishes the queued tasks and joins the workers
+ */
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_stop=true;
+	}
+	_work.notify_all();
+	for (std::size_t i=0; i<_thread.size(); i++) {
+		_thread[i].join();
+	}
+}
+
+/**
+ * @brief queue a task
+ *
+ * @param task function to run on a worker
+ */
+void
+ThreadPool::submit(std::function<void()> const& task)
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_task.push_back(task);
+	}
+	_work.notify_one();
+}
+
+/**
+ * @brief wait until every task submitted so far has finished
+ *
+ * Must not be called from a task.
+ *
+ * This function takes no argument.
+ */
+void
+ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	while (!_task.empty() || _busy) _idle.wait(lock);
+}
+
+/**
+ * @brief body of a worker
+ *
+ * Runs queued tasks until the pool stops and the queue is empty.
+ *
+ * This function takes no argument.
+ */
+void
+ThreadPool::run()
+{
+	std::unique_lock<std::mutex> lock(_lock);
+	for (;;) {
+		while (_task.empty() && !_stop) _work.wait(lock);
+		if (_task.empty()) return;
+		std::function<void()> task=std::move(_task.front());
+		_task.pop_front();
+		_busy++;
+		lock.unlock();
+		try {
+			task();
+		}
+		catch (...) {
+			// the task should have dealt with it
+		}
+		lock.lock();
+		_busy--;
+		if (_task.empty() && !_busy) _idle.notify_all();
+	}
+}